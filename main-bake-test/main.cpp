@@ -0,0 +1,82 @@
+// Checks for the mesh optimizations in main-bake. Exits with a non-zero
+// status if any check fails.
+
+#include <vector>
+#include <typeinfo>
+#include <algorithm>
+#include <exception>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <glm/glm.hpp>
+
+#include "../main-bake/optimize_mesh.hpp"
+
+namespace
+{
+	// Sorted list of the triangles; compares index buffers up to the order
+	// of their triangles.
+	std::vector<std::vector<std::uint32_t>> triangle_set_( std::vector<std::uint32_t> const& aIndices )
+	{
+		std::vector<std::vector<std::uint32_t>> ret;
+		for( std::size_t i = 0; i+2 < aIndices.size(); i += 3 )
+			ret.push_back( { aIndices[i+0], aIndices[i+1], aIndices[i+2] } );
+
+		std::sort( ret.begin(), ret.end() );
+		return ret;
+	}
+
+	// optimize_overdraw() must keep all triangles when the first triangle
+	// is degenerate (and thus does not miss the cache three times).
+	bool overdraw_keeps_degenerate_leading_triangle_()
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<std::uint32_t> indices{ 0, 0, 1 };
+
+		positions.emplace_back( 0.f, 0.f, 0.f );
+		positions.emplace_back( 1.f, 0.f, 0.f );
+
+		// Disjoint triangles around the origin, facing different ways, so
+		// that each starts a cluster and the clusters are reordered.
+		for( std::uint32_t t = 0; t < 20; ++t )
+		{
+			float const a = float(t) * 0.3f;
+			glm::vec3 const c( 5.f*std::cos(a), float(t%3), 5.f*std::sin(a) );
+
+			auto const base = std::uint32_t(positions.size());
+			positions.emplace_back( c );
+			positions.emplace_back( c + glm::vec3( 0.f, 1.f, 0.f ) );
+			positions.emplace_back( c + glm::vec3( std::sin(a), 0.f, -std::cos(a) ) );
+
+			indices.insert( indices.end(), { base, base+1, base+2 } );
+		}
+
+		auto const expected = triangle_set_( indices );
+
+		optimize_overdraw( indices, positions, 16, 1.05f );
+
+		if( triangle_set_( indices ) != expected )
+		{
+			std::fprintf( stderr, "optimize_overdraw(): %zu triangles in, %zu out (or changed)\n", expected.size(), indices.size()/3 );
+			return false;
+		}
+
+		return true;
+	}
+}
+
+int main() try
+{
+	bool ok = true;
+	ok = overdraw_keeps_degenerate_leading_triangle_() && ok;
+
+	std::printf( "%s\n", ok ? "All checks passed" : "Some checks FAILED" );
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+catch( std::exception const& eErr )
+{
+	std::fprintf( stderr, "Top-level exception [%s]:\n%s\nBye.\n", typeid(eErr).name(), eErr.what() );
+	return EXIT_FAILURE;
+}
@@ -1,6 +1,8 @@
 #include "index_mesh.hpp"
 
+#include <chrono>
 #include <numeric>
+#include <algorithm>
 #include <unordered_map>
 
 #include <cstddef>
@@ -31,12 +33,46 @@ namespace
 		float scale;
 	};
 
-	// hash discretized mesh positions
-	using VicinityKey_ = std::size_t;
-	inline VicinityKey_ hash_discretized_position_( DiscretizedPosition_ const& aPos );
+	// Vicinity grid: vertex indices sorted by their discretized cell. Cells
+	// are packed into a single 64-bit key with x in the lowest bits, so the
+	// three cells (x-1,y,z), (x,y,z) and (x+1,y,z) form one contiguous range
+	// of keys. A 27-neighbour probe thus becomes nine range lookups.
+	constexpr unsigned kCellBits = 21;
+	constexpr std::uint64_t kCellMask = (std::uint64_t(1) << kCellBits) - 1;
+
+	static_assert( kSparseGridMaxSize < kCellMask, "Cell coordinates must fit into kCellBits" );
+
+	using VicinityKey_ = std::uint64_t;
+	inline VicinityKey_ pack_discretized_position_( std::uint64_t aX, std::uint64_t aY, std::uint64_t aZ );
+
+	struct VicinityGrid_
+	{
+		std::vector<VicinityKey_> keys; // sorted
+		std::vector<std::uint32_t> indices; // vertex index for each key
+
+		template< typename tVisitor >
+		void for_each_near( DiscretizedPosition_ const&, tVisitor&& ) const;
+	};
+
+	void build_vicinity_grid_( 
+		VicinityGrid_&, 
+		Discretizer_ const&,
+		std::vector<glm::vec3> const&
+	);
+
+	// Previous vicinity map (hashed cells in a std::unordered_multimap). This
+	// is only kept around to benchmark against VicinityGrid_.
+	using VicinityHash_ = std::size_t;
+	inline VicinityHash_ hash_discretized_position_( DiscretizedPosition_ const& aPos );
+
+	struct VicinityMap_
+	{
+		std::unordered_multimap<VicinityHash_,std::size_t> map;
+
+		template< typename tVisitor >
+		void for_each_near( DiscretizedPosition_ const&, tVisitor&& ) const;
+	};
 
-	// generate vicinity map 
-	using VicinityMap_ = std::unordered_multimap<VicinityKey_,std::size_t>;
 	void build_vicinity_map_( 
 		VicinityMap_&, 
 		Discretizer_ const&,
@@ -55,58 +91,43 @@ namespace
 	using VertexMapping_ = std::vector<std::size_t>;
 	using IndexBuffer_ = std::vector<std::uint32_t>;
 
+	template< class tVicinity >
 	std::size_t collapse_vertices_( 
 		IndexBuffer_&, 
 		VertexMapping_&, 
-		VicinityMap_ const&, 
+		tVicinity const&, 
 		Discretizer_ const&, 
 		TriangleSoup const&, 
 		float
 	);
 
+	// discretization parameters for a soup
+	Discretizer_ make_discretizer_( TriangleSoup const&, float, glm::vec3& aMin, glm::vec3& aMax );
+
 }
 
 //--    IndexedMesh                     ///{{{2///////////////////////////////
 IndexedMesh::IndexedMesh()
 	: aabbMin( std::numeric_limits<float>::max() )
-	, aabbMax( std::numeric_limits<float>::min() )
+	, aabbMax( std::numeric_limits<float>::lowest() )
 {}
 
 //--    make_indexed_mesh()             ///{{{2///////////////////////////////
 IndexedMesh make_indexed_mesh( TriangleSoup const& aSoup, float aErrorTolerance )
 {
-	// compute bounding volume
-	glm::vec3 bmin( std::numeric_limits<float>::max() );
-	glm::vec3 bmax( std::numeric_limits<float>::min() );
-
-	for( std::size_t vert = 0; vert < aSoup.vert.size(); ++vert )
-	{
-		bmin = min( bmin, aSoup.vert[vert] );
-		bmax = max( bmax, aSoup.vert[vert] );
-	}
-
-	auto const fmin = bmin - glm::vec3( kAABBMarginFactor * aErrorTolerance );
-	auto const fmax = bmax + glm::vec3( kAABBMarginFactor * aErrorTolerance );
-
-	// Compute grid size
-	auto const side = fmax - fmin;
-	float const maxSide = std::max( side.x, std::max( side.y, side.z ) );
-
-	float const numCells = maxSide / (2.f*aErrorTolerance);
-	std::size_t subdiv = std::min( kSparseGridMaxSize, std::size_t(numCells+.5f) );
-
 	// parameters for discretization
-	Discretizer_ dis( std::uint32_t(subdiv), fmin, maxSide );
+	glm::vec3 bmin, bmax;
+	Discretizer_ const dis = make_discretizer_( aSoup, aErrorTolerance, bmin, bmax );
 
-	// build the vincinity map
-	VicinityMap_ vincinityMap;
-	build_vicinity_map_( vincinityMap, dis, aSoup.vert );
+	// build the vincinity grid
+	VicinityGrid_ vincinityGrid;
+	build_vicinity_grid_( vincinityGrid, dis, aSoup.vert );
 
 	// collapse vertices
 	IndexBuffer_ indices;
 	VertexMapping_ vertexMapping;
 
-	size_t verts = collapse_vertices_( indices, vertexMapping, vincinityMap, dis, aSoup, aErrorTolerance );
+	size_t verts = collapse_vertices_( indices, vertexMapping, vincinityGrid, dis, aSoup, aErrorTolerance );
 
 	assert( indices.size() == aSoup.vert.size() );
 	assert( verts == vertexMapping.size() );
@@ -227,6 +248,57 @@ IndexedMesh make_indexed_mesh( TriangleSoup const& aSoup, float aErrorTolerance
 	return ret;
 }
 
+//--    benchmark_vicinity()            ///{{{2///////////////////////////////
+VicinityBenchmark benchmark_vicinity( TriangleSoup const& aSoup, float aErrorTolerance )
+{
+	using Clock_ = std::chrono::steady_clock;
+	using Secs_ = std::chrono::duration<double>;
+
+	VicinityBenchmark ret{};
+
+	glm::vec3 bmin, bmax;
+	Discretizer_ const dis = make_discretizer_( aSoup, aErrorTolerance, bmin, bmax );
+
+	IndexBuffer_ indices;
+	VertexMapping_ vertexMapping;
+
+	// std::unordered_multimap
+	{
+		auto const t0 = Clock_::now();
+
+		VicinityMap_ map;
+		build_vicinity_map_( map, dis, aSoup.vert );
+
+		auto const t1 = Clock_::now();
+
+		ret.mapVertices = collapse_vertices_( indices, vertexMapping, map, dis, aSoup, aErrorTolerance );
+
+		auto const t2 = Clock_::now();
+
+		ret.mapBuildSeconds = Secs_( t1-t0 ).count();
+		ret.mapCollapseSeconds = Secs_( t2-t1 ).count();
+	}
+
+	// sorted grid
+	{
+		auto const t0 = Clock_::now();
+
+		VicinityGrid_ grid;
+		build_vicinity_grid_( grid, dis, aSoup.vert );
+
+		auto const t1 = Clock_::now();
+
+		ret.gridVertices = collapse_vertices_( indices, vertexMapping, grid, dis, aSoup, aErrorTolerance );
+
+		auto const t2 = Clock_::now();
+
+		ret.gridBuildSeconds = Secs_( t1-t0 ).count();
+		ret.gridCollapseSeconds = Secs_( t2-t1 ).count();
+	}
+
+	return ret;
+}
+
 #if 0
 //--    ensure_normals()                ///{{{2///////////////////////////////
 void ensure_normals( IndexedMesh& aMesh )
@@ -274,6 +346,34 @@ void ensure_normals( IndexedMesh& aMesh )
 //--    $ local functions               ///{{{2///////////////////////////////
 namespace
 {
+	Discretizer_ make_discretizer_( TriangleSoup const& aSoup, float aErrorTolerance, glm::vec3& aMin, glm::vec3& aMax )
+	{
+		// compute bounding volume
+		glm::vec3 bmin( std::numeric_limits<float>::max() );
+		glm::vec3 bmax( std::numeric_limits<float>::lowest() );
+
+		for( std::size_t vert = 0; vert < aSoup.vert.size(); ++vert )
+		{
+			bmin = min( bmin, aSoup.vert[vert] );
+			bmax = max( bmax, aSoup.vert[vert] );
+		}
+
+		auto const fmin = bmin - glm::vec3( kAABBMarginFactor * aErrorTolerance );
+		auto const fmax = bmax + glm::vec3( kAABBMarginFactor * aErrorTolerance );
+
+		// Compute grid size
+		auto const side = fmax - fmin;
+		float const maxSide = std::max( side.x, std::max( side.y, side.z ) );
+
+		float const numCells = maxSide / (2.f*aErrorTolerance);
+		std::size_t subdiv = std::min( kSparseGridMaxSize, std::size_t(numCells+.5f) );
+
+		aMin = bmin;
+		aMax = bmax;
+
+		return Discretizer_( std::uint32_t(subdiv), fmin, maxSide );
+	}
+
 	Discretizer_::Discretizer_( std::uint32_t aFactor, glm::vec3 aMin, float aSide )
 	{
 		min = aMin;
@@ -293,9 +393,69 @@ namespace
 
 namespace
 {
-	std::hash<VicinityKey_> gHash_;
+	inline VicinityKey_ pack_discretized_position_( std::uint64_t aX, std::uint64_t aY, std::uint64_t aZ )
+	{
+		return (aZ << (2*kCellBits)) | (aY << kCellBits) | aX;
+	}
+
+	void build_vicinity_grid_( VicinityGrid_& aGrid, Discretizer_ const& aD, std::vector<glm::vec3> const& aPositions )
+	{
+		// Sort (key,index) pairs. The index is part of the sort key, which
+		// keeps the order deterministic and vertices in soup order within
+		// each cell.
+		std::vector<std::pair<VicinityKey_,std::uint32_t>> entries( aPositions.size() );
+		for( std::size_t index = 0; index < aPositions.size(); ++index )
+		{
+			DiscretizedPosition_ const dp = aD.discretize( aPositions[index] );
+			assert( dp.x >= 0 && std::uint64_t(dp.x) <= kCellMask );
+			assert( dp.y >= 0 && std::uint64_t(dp.y) <= kCellMask );
+			assert( dp.z >= 0 && std::uint64_t(dp.z) <= kCellMask );
+
+			entries[index] = std::make_pair( pack_discretized_position_( dp.x, dp.y, dp.z ), std::uint32_t(index) );
+		}
+
+		std::sort( entries.begin(), entries.end() );
+
+		aGrid.keys.resize( entries.size() );
+		aGrid.indices.resize( entries.size() );
+		for( std::size_t i = 0; i < entries.size(); ++i )
+		{
+			aGrid.keys[i] = entries[i].first;
+			aGrid.indices[i] = entries[i].second;
+		}
+	}
 
-	inline VicinityKey_ hash_discretized_position_( DiscretizedPosition_ const& aDP )
+	template< typename tVisitor > inline
+	void VicinityGrid_::for_each_near( DiscretizedPosition_ const& aDP, tVisitor&& aVisitor ) const
+	{
+		std::int64_t const x = aDP.x;
+		std::uint64_t const xlo = std::uint64_t(std::max<std::int64_t>( x-1, 0 ));
+		std::uint64_t const xhi = std::uint64_t(std::min<std::int64_t>( x+1, kCellMask ));
+
+		for( std::int64_t z = std::int64_t(aDP.z)-1; z <= std::int64_t(aDP.z)+1; ++z )
+		{
+			if( z < 0 || std::uint64_t(z) > kCellMask ) continue;
+
+			for( std::int64_t y = std::int64_t(aDP.y)-1; y <= std::int64_t(aDP.y)+1; ++y )
+			{
+				if( y < 0 || std::uint64_t(y) > kCellMask ) continue;
+
+				VicinityKey_ const first = pack_discretized_position_( xlo, y, z );
+				VicinityKey_ const last = pack_discretized_position_( xhi, y, z );
+
+				auto it = std::lower_bound( keys.begin(), keys.end(), first );
+				for( ; it != keys.end() && *it <= last; ++it )
+					aVisitor( std::size_t(indices[it - keys.begin()]) );
+			}
+		}
+	}
+}
+
+namespace
+{
+	std::hash<VicinityHash_> gHash_;
+
+	inline VicinityHash_ hash_discretized_position_( DiscretizedPosition_ const& aDP )
 	{
 		// Based on boost::hash_combine.
 		std::size_t hash = gHash_(aDP.x);
@@ -303,18 +463,56 @@ namespace
 		hash ^= gHash_(aDP.z) + 0x9e3779b9 + (hash<<6) + (hash>>2);
 		return hash;
 	}
-}
 
-namespace
-{
 	void build_vicinity_map_( VicinityMap_& aMap, Discretizer_ const& aD, std::vector<glm::vec3> const& aPositions )
 	{
 		for( std::size_t index = 0; index < aPositions.size(); ++index )
 		{
 			DiscretizedPosition_ dp = aD.discretize( aPositions[index] );
-			VicinityKey_ vk = hash_discretized_position_( dp );
+			VicinityHash_ vk = hash_discretized_position_( dp );
+
+			aMap.map.insert( std::make_pair(vk, index) );
+		}
+	}
+
+	// neighbours
+	const size_t kNeighbourCount_ = 27;
+
+	DiscretizedPosition_ neighbour_( DiscretizedPosition_ const& aDP, std::size_t aJ )
+	{
+		static constexpr std::int32_t offset[kNeighbourCount_][3] = {
+			{ 0, 0, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+			{ 0, 1, 0 }, { 0, 1, 1 }, { 0, 1, -1 },
+			{ 0, -1, 0 }, { 0, -1, 1 }, { 0, -1, -1 },
+
+			{ 1, 0, 0 }, { 1, 0, 1 }, { 1, 0, -1 },
+			{ 1, 1, 0 }, { 1, 1, 1 }, { 1, 1, -1 },
+			{ 1, -1, 0 }, { 1, -1, 1 }, { 1, -1, -1 },
+
+			{ -1, 0, 0 }, { -1, 0, 1 }, { -1, 0, -1 },
+			{ -1, 1, 0 }, { -1, 1, 1 }, { -1, 1, -1 },
+			{ -1, -1, 0 }, { -1, -1, 1 }, { -1, -1, -1 },
+		};
+
+		assert( aJ < kNeighbourCount_ );
+		
+		DiscretizedPosition_ ret = aDP;
+		ret.x += offset[aJ][0];
+		ret.y += offset[aJ][1];
+		ret.z += offset[aJ][2];
+		return ret;
+	}
 
-			aMap.insert( std::make_pair(vk, index) );
+	template< typename tVisitor > inline
+	void VicinityMap_::for_each_near( DiscretizedPosition_ const& aDP, tVisitor&& aVisitor ) const
+	{
+		for( std::size_t j = 0; j < kNeighbourCount_; ++j )
+		{
+			DiscretizedPosition_ const dq = neighbour_( aDP, j );
+			VicinityHash_ const vk = hash_discretized_position_( dq );
+
+			for( auto [it, jt] = map.equal_range( vk ); it != jt; ++it )
+				aVisitor( it->second );
 		}
 	}
 }
@@ -358,36 +556,9 @@ namespace
 
 namespace
 {
-	// neighbours
-	const size_t kNeighbourCount_ = 27;
-
-	DiscretizedPosition_ neighbour_( DiscretizedPosition_ const& aDP, std::size_t aJ )
-	{
-		static constexpr std::int32_t offset[kNeighbourCount_][3] = {
-			{ 0, 0, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
-			{ 0, 1, 0 }, { 0, 1, 1 }, { 0, 1, -1 },
-			{ 0, -1, 0 }, { 0, -1, 1 }, { 0, -1, -1 },
-
-			{ 1, 0, 0 }, { 1, 0, 1 }, { 1, 0, -1 },
-			{ 1, 1, 0 }, { 1, 1, 1 }, { 1, 1, -1 },
-			{ 1, -1, 0 }, { 1, -1, 1 }, { 1, -1, -1 },
-
-			{ -1, 0, 0 }, { -1, 0, 1 }, { -1, 0, -1 },
-			{ -1, 1, 0 }, { -1, 1, 1 }, { -1, 1, -1 },
-			{ -1, -1, 0 }, { -1, -1, 1 }, { -1, -1, -1 },
-		};
-
-		assert( aJ < kNeighbourCount_ );
-		
-		DiscretizedPosition_ ret = aDP;
-		ret.x += offset[aJ][0];
-		ret.y += offset[aJ][1];
-		ret.z += offset[aJ][2];
-		return ret;
-	}
-
 	// Merge vertices
-	size_t collapse_vertices_( IndexBuffer_& aIndices, VertexMapping_& aVertices, VicinityMap_ const& aVM, Discretizer_ const& aD, TriangleSoup const& aSoup, float aMaxError )
+	template< class tVicinity >
+	size_t collapse_vertices_( IndexBuffer_& aIndices, VertexMapping_& aVertices, tVicinity const& aVM, Discretizer_ const& aD, TriangleSoup const& aSoup, float aMaxError )
 	{
 		aVertices.clear();
 		aVertices.reserve( aSoup.vert.size() );
@@ -418,44 +589,34 @@ namespace
 			bool merged = false;
 			std::size_t target = ~std::size_t(0);
 
-			for( std::size_t j = 0; j < kNeighbourCount_; ++j )
-			{
-				DiscretizedPosition_ const dq = neighbour_( dp, j );
-				VicinityKey_ const vk = hash_discretized_position_( dq );
+			aVM.for_each_near( dp, [&] (std::size_t aIdx) {
+				if( aIdx == i ) return; // don't try to merge with self
+				if( ~std::size_t(0) != collapseMap[aIdx] ) return; // don't remerge
 
-				// get vertices in this bucket
-				for( auto [it, jt] = aVM.equal_range( vk ); it != jt; ++it )
+				auto const other = aSoup.vert[aIdx];
+				if( mergable_( aSoup, i, aIdx, self, other, aMaxError ) )
 				{
-					std::size_t const idx =  it->second;
-
-					if( idx == i ) continue; // don't try to merge with self
-					if( ~std::size_t(0) != collapseMap[idx] ) continue; // don't remerge
-
-					auto const other = aSoup.vert[idx];
-					if( mergable_( aSoup, i, idx, self, other, aMaxError ) )
+					std::size_t toWhere;
+					
+					if( merged )
 					{
-						std::size_t toWhere;
-						
-						if( merged )
-						{
-							toWhere = target;
-						}
-						else
-						{
-							toWhere = nextVertex++;
-							aVertices.push_back( i );
-
-							collapseMap[i] = toWhere;
-							aIndices.push_back( std::uint32_t(toWhere) );
-						}
-
-						collapseMap[idx] = toWhere;
-						
-						target = toWhere;
-						merged = true;
+						toWhere = target;
 					}
+					else
+					{
+						toWhere = nextVertex++;
+						aVertices.push_back( i );
+
+						collapseMap[i] = toWhere;
+						aIndices.push_back( std::uint32_t(toWhere) );
+					}
+
+					collapseMap[aIdx] = toWhere;
+					
+					target = toWhere;
+					merged = true;
 				}
-			}
+			} );
 
 			if( !merged )
 			{
@@ -6,6 +6,7 @@
 
 #include <vector>
 
+#include <cstddef>
 #include <cstdint>
 
 #include <glm/vec2.hpp>
@@ -20,6 +21,15 @@ struct TriangleSoup
 	std::vector<glm::vec3> norm;
 	std::vector<glm::vec2> text;
 };
+struct MeshLod
+{
+	// Range in IndexedMesh::indices
+	std::uint32_t firstIndex;
+	std::uint32_t indexCount;
+
+	// Simplification error in model units (zero for the full detail level)
+	float error;
+};
 struct IndexedMesh
 {
 	std::vector<glm::vec3> vert;
@@ -31,11 +41,24 @@ struct IndexedMesh
 
 	std::vector<std::uint32_t> indices;
 
+	// Level of detail chain. All levels share the vertex data above; level
+	// zero is the full detail mesh and always comes first in indices. Empty
+	// until LODs are generated.
+	std::vector<MeshLod> lods;
+
 	glm::vec3 aabbMin, aabbMax;
 
 	IndexedMesh();
 };
 
+struct VicinityBenchmark
+{
+	double mapBuildSeconds, mapCollapseSeconds;
+	double gridBuildSeconds, gridCollapseSeconds;
+
+	std::size_t mapVertices, gridVertices;
+};
+
 //--    functions                               ///{{{1///////////////////////
 
 IndexedMesh make_indexed_mesh(
@@ -45,4 +68,11 @@ IndexedMesh make_indexed_mesh(
 
 void ensure_normals( IndexedMesh& );
 
+// Compare the sorted vicinity grid used by make_indexed_mesh() against the
+// previous std::unordered_multimap based approach on the same soup.
+VicinityBenchmark benchmark_vicinity(
+	TriangleSoup const&,
+	float aErrorTol = 1e-6f
+);
+
 #endif // INDEX_MESH_HPP_8617BC10_313B_4397_9E27_33AA16A4C308
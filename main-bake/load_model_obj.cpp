@@ -1,10 +1,27 @@
 #include "load_model_obj.hpp"
 
-#include <unordered_set>
-
+#include <chrono>
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+#include <cerrno>
 #include <cassert>
 #include <cstring>
 
+#if defined(_WIN32)
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <windows.h>
+#else // !_WIN32
+#	include <unistd.h>
+#	include <stdlib.h>
+#endif // ~ _WIN32
+
 #include <rapidobj/rapidobj.hpp>
 
 #include "input_model.hpp"
@@ -13,24 +30,105 @@
 #include "../utils/error.hpp"
 namespace lut = labutils;
 
-InputModel load_compressed_wavefront_obj( char const* aPath )
+namespace
+{
+	using Clock_ = std::chrono::steady_clock;
+
+	// Tweakables
+	// In ObjParseMode::automatic, inputs of at least this (compressed) size
+	// are decompressed to a temporary file and parsed with rapidobj's
+	// multi-threaded ParseFile(), if there is more than one hardware thread.
+	// The temporary file costs an extra pass over the decompressed OBJ, so
+	// this sits well above rapidobj's own 1 MB single-thread cutoff (OBJ
+	// compresses roughly 10:1).
+	constexpr std::uintmax_t kParseFileMinInputBytes = 1024*1024;
+
+	// Temporary file that is deleted with the object. The file is created
+	// with a unique name "<dir>/<stem>-XXXXXX", and creation fails rather
+	// than opening a file that already exists. On POSIX, the file is only
+	// accessible to the current user (mode 0600).
+	class TempFile_
+	{
+		public:
+			TempFile_( std::filesystem::path const& aDir, std::string const& aStem );
+			~TempFile_();
+
+			TempFile_( TempFile_ const& ) = delete;
+			TempFile_& operator= (TempFile_ const&) = delete;
+
+			std::filesystem::path const& path() const noexcept;
+
+			void write( void const* aData, std::size_t aBytes );
+			void close();
+
+		private:
+#			if defined(_WIN32)
+			HANDLE mHandle;
+#			else
+			int mFd;
+#			endif
+
+			std::filesystem::path mPath;
+	};
+
+	ObjParseMode select_mode_( char const* aPath, ObjParseMode );
+
+	// Directory for the decompressed OBJ. Prefers /dev/shm (tmpfs) where it
+	// exists, so that the file never hits the disk.
+	std::filesystem::path temp_obj_dir_();
+
+	void decompress_to_( TempFile_&, char const* aPath, ZStdStreamConfig const& );
+}
+
+InputModel load_compressed_wavefront_obj( char const* aPath, ObjLoadTimings* aTimings, ObjLoadOptions const& aOptions )
 {
 	assert( aPath );
 	
 	// Ask rapidobj to load the requested file
 	rapidobj::MaterialLibrary const mlib = rapidobj::MaterialLibrary::SearchPath( std::filesystem::absolute(std::filesystem::path(aPath).remove_filename()) );
 
-	ZStdIStream ins( aPath );
-	auto result = rapidobj::ParseStream( ins, mlib );
+	auto const mode = select_mode_( aPath, aOptions.mode );
+
+	auto parseStart = Clock_::now();
+
+	rapidobj::Result result;
+	if( ObjParseMode::file == mode )
+	{
+		// The stem of .obj-zstd is the OBJ's name.
+		TempFile_ temp( temp_obj_dir_(), std::filesystem::path(aPath).stem().string() );
+		decompress_to_( temp, aPath, aOptions.stream );
+
+		auto const decompressEnd = Clock_::now();
+		if( aTimings )
+			aTimings->decompress = std::chrono::duration<double>( decompressEnd - parseStart ).count();
+
+		parseStart = decompressEnd;
+		result = rapidobj::ParseFile( temp.path(), mlib );
+	}
+	else
+	{
+		ZStdIStream ins( aPath, aOptions.stream );
+		result = rapidobj::ParseStream( ins, mlib );
+	}
+
 	if( result.error )
 		throw lut::Error( "Unable to load OBJ file '%s': %s", aPath, result.error.code.message().c_str() );
 
+	auto const triangulateStart = Clock_::now();
+
 	// OBJ files can define faces that are not triangles. However, Vulkan will
 	// only render triangles (or lines and points), so we must triangulate any
 	// faces that are not already triangles. Fortunately, rapidobj can do this
 	// for us.
 	rapidobj::Triangulate( result );
 
+	if( aTimings )
+	{
+		aTimings->mode = mode;
+		aTimings->parse = std::chrono::duration<double>( triangulateStart - parseStart ).count();
+		aTimings->triangulate = std::chrono::duration<double>( Clock_::now() - triangulateStart ).count();
+	}
+
 	// Find the path to the OBJ file
 	char const* pathBeg = aPath;
 	char const* pathEnd = std::strrchr( pathBeg, '/' );
@@ -91,83 +189,247 @@ InputModel load_compressed_wavefront_obj( char const* aPath )
 	//
 	// Unfortunately, RapidOBJ exposes a per-face material index.
 
-	std::unordered_set<std::size_t> activeMaterials;
+	// Faces are bucketed by material with a counting sort: one pass counts
+	// the faces of each material, a prefix sum over the counts gives each
+	// material's range in the output, and a second pass scatters the faces'
+	// vertices into these ranges. Faces keep their relative order within a
+	// material. Meshes are emitted in order of increasing material index.
+	//
+	// Note: we still keep different "shapes" separate. For static meshes,
+	// one could merge all vertices with the same material for a bit more
+	// efficient rendering.
+	auto const convertStart = Clock_::now();
+
+	auto const materialCount = ret.materials.size();
+	std::vector<std::size_t> faceCounts( materialCount );
+	std::vector<std::size_t> faceOffsets( materialCount );
+
 	for( auto const& shape : result.shapes )
 	{
 		auto const& shapeName = shape.name;
+		auto const& indices = shape.mesh.indices;
 
-		// Scan shape for materials
-		activeMaterials.clear();
+		auto const faceCount = indices.size() / 3; // Always triangles; see Triangulate() above
+		assert( faceCount <= shape.mesh.material_ids.size() );
 
-		for( std::size_t i = 0; i < shape.mesh.indices.size(); ++i )
-		{
-			auto const faceId = i/3; // Always triangles; see Triangulate() above
+		// Count faces per material
+		std::fill( faceCounts.begin(), faceCounts.end(), 0 );
 
-			assert( faceId < shape.mesh.material_ids.size() );
+		for( std::size_t faceId = 0; faceId < faceCount; ++faceId )
+		{
 			auto const matId = shape.mesh.material_ids[faceId];
 
-			assert( matId < int(ret.materials.size()) );
-			activeMaterials.emplace( matId );
+			assert( matId >= 0 && matId < int(materialCount) );
+			++faceCounts[matId];
 		}
 
-		// Process vertices for active material
-		// This does multiple passes over the vertex data, which is less than
-		// optimal...
-		//
-		// Note: we still keep different "shapes" separate. For static meshes,
-		// one could merge all vertices with the same material for a bit more
-		// efficient rendering.
-		for( auto const matId : activeMaterials )
+		// Prefix sum => first vertex of each material's range
+		auto const firstVertex = ret.positions.size();
+
+		std::size_t activeMaterials = 0;
+		std::size_t offset = firstVertex;
+		for( std::size_t matId = 0; matId < materialCount; ++matId )
 		{
-			// Keep track of mesh names; this can be useful for debugging.
-			std::string meshName;
-			if( 1 == activeMaterials.size() )
-				meshName = shapeName;
-			else
-				meshName = shapeName + "::" + ret.materials[matId].materialName;
+			faceOffsets[matId] = offset;
+			offset += faceCounts[matId] * 3;
 
-			// Extract this material's vertices.
-			auto const firstVertex = ret.positions.size();
-			
-			for( std::size_t i = 0; i < shape.mesh.indices.size(); ++i )
-			{
-				auto const faceId = i/3; // Always triangles; see Triangulate() above
-				auto const faceMat = std::size_t(shape.mesh.material_ids[faceId]);
+			if( faceCounts[matId] )
+				++activeMaterials;
+		}
 
-				if( faceMat != matId )
-					continue;
+		// Scatter
+		ret.positions.resize( offset );
+		ret.texcoords.resize( offset );
+		ret.normals.resize( offset );
 
-				auto const& idx = shape.mesh.indices[i];
+		for( std::size_t faceId = 0; faceId < faceCount; ++faceId )
+		{
+			auto const matId = shape.mesh.material_ids[faceId];
+			auto const out = faceOffsets[matId];
+			faceOffsets[matId] += 3;
 
-				ret.positions.emplace_back( glm::vec3{
+			for( std::size_t i = 0; i < 3; ++i )
+			{
+				auto const& idx = indices[faceId*3+i];
+
+				ret.positions[out+i] = glm::vec3{
 					result.attributes.positions[idx.position_index*3+0],
 					result.attributes.positions[idx.position_index*3+1],
 					result.attributes.positions[idx.position_index*3+2]
-				} );
+				};
 
-				ret.texcoords.emplace_back( glm::vec2{
+				ret.texcoords[out+i] = glm::vec2{
 					result.attributes.texcoords[idx.texcoord_index*2+0],
 					result.attributes.texcoords[idx.texcoord_index*2+1]
-				} );
+				};
 
-				ret.normals.emplace_back( glm::vec3{
+				ret.normals[out+i] = glm::vec3{
 					result.attributes.normals[idx.normal_index*3+0],
 					result.attributes.normals[idx.normal_index*3+1],
 					result.attributes.normals[idx.normal_index*3+2]
-				} );
+				};
 			}
+		}
+
+		// One mesh per active material
+		std::size_t meshVertex = firstVertex;
+		for( std::size_t matId = 0; matId < materialCount; ++matId )
+		{
+			if( 0 == faceCounts[matId] )
+				continue;
+
+			// Keep track of mesh names; this can be useful for debugging.
+			std::string meshName;
+			if( 1 == activeMaterials )
+				meshName = shapeName;
+			else
+				meshName = shapeName + "::" + ret.materials[matId].materialName;
 
-			auto const vertexCount = ret.positions.size() - firstVertex;
+			auto const vertexCount = faceCounts[matId] * 3;
 
 			ret.meshes.emplace_back( InputMeshInfo{
 				std::move(meshName),
 				matId,
-				firstVertex,
+				meshVertex,
 				vertexCount
 			} );
+
+			meshVertex += vertexCount;
 		}
 	}
 
+	if( aTimings )
+		aTimings->convert = std::chrono::duration<double>( Clock_::now() - convertStart ).count();
+
 	return ret;
 }
 
+namespace
+{
+	TempFile_::TempFile_( std::filesystem::path const& aDir, std::string const& aStem )
+	{
+#		if defined(_WIN32)
+		// CREATE_NEW fails if the file exists; retry with a different name.
+		// The stamp and counter keep concurrent bakes apart.
+		auto const stamp = Clock_::now().time_since_epoch().count();
+		for( unsigned attempt = 0; ; ++attempt )
+		{
+			mPath = aDir / (aStem + "-" + std::to_string(stamp) + "-" + std::to_string(attempt));
+			mHandle = CreateFileW( mPath.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_NEW, FILE_ATTRIBUTE_TEMPORARY, nullptr );
+			if( INVALID_HANDLE_VALUE != mHandle )
+				break;
+
+			if( ERROR_FILE_EXISTS != GetLastError() || attempt >= 100 )
+				throw lut::Error( "Unable to create temporary file '%s'", mPath.string().c_str() );
+		}
+#		else // !_WIN32
+		// mkstemp() opens with O_CREAT|O_EXCL and mode 0600.
+		std::string name = (aDir / (aStem + "-XXXXXX")).string();
+		mFd = mkstemp( name.data() );
+		if( -1 == mFd )
+			throw lut::Error( "Unable to create temporary file '%s': %s", name.c_str(), std::strerror(errno) );
+
+		mPath = std::move(name);
+#		endif // ~ _WIN32
+	}
+
+	TempFile_::~TempFile_()
+	{
+		close();
+
+		std::error_code ec;
+		std::filesystem::remove( mPath, ec );
+	}
+
+	std::filesystem::path const& TempFile_::path() const noexcept
+	{
+		return mPath;
+	}
+
+	void TempFile_::write( void const* aData, std::size_t aBytes )
+	{
+		auto const* bytes = static_cast<char const*>(aData);
+		while( aBytes )
+		{
+#			if defined(_WIN32)
+			DWORD const chunk = DWORD(std::min<std::size_t>( aBytes, 1u<<30 ));
+			DWORD written = 0;
+			if( INVALID_HANDLE_VALUE == mHandle || !WriteFile( mHandle, bytes, chunk, &written, nullptr ) )
+				throw lut::Error( "Unable to write '%s'", mPath.string().c_str() );
+#			else // !_WIN32
+			ssize_t const written = ::write( mFd, bytes, aBytes );
+			if( -1 == written )
+			{
+				if( EINTR == errno )
+					continue;
+
+				throw lut::Error( "Unable to write '%s': %s", mPath.string().c_str(), std::strerror(errno) );
+			}
+#			endif // ~ _WIN32
+
+			bytes += written;
+			aBytes -= std::size_t(written);
+		}
+	}
+
+	void TempFile_::close()
+	{
+#		if defined(_WIN32)
+		if( INVALID_HANDLE_VALUE != mHandle )
+		{
+			CloseHandle( mHandle );
+			mHandle = INVALID_HANDLE_VALUE;
+		}
+#		else // !_WIN32
+		if( -1 != mFd )
+		{
+			::close( mFd );
+			mFd = -1;
+		}
+#		endif // ~ _WIN32
+	}
+
+
+	ObjParseMode select_mode_( char const* aPath, ObjParseMode aMode )
+	{
+		if( ObjParseMode::automatic != aMode )
+			return aMode;
+
+		if( std::thread::hardware_concurrency() < 2 )
+			return ObjParseMode::stream;
+
+		std::error_code ec;
+		auto const inputBytes = std::filesystem::file_size( aPath, ec );
+		if( ec || inputBytes < kParseFileMinInputBytes )
+			return ObjParseMode::stream;
+
+		return ObjParseMode::file;
+	}
+
+	std::filesystem::path temp_obj_dir_()
+	{
+		std::error_code ec;
+
+		std::filesystem::path dir( "/dev/shm" );
+		if( !std::filesystem::is_directory( dir, ec ) )
+		{
+			dir = std::filesystem::temp_directory_path( ec );
+			if( ec )
+				throw lut::Error( "Unable to find a directory for temporary files: %s", ec.message().c_str() );
+		}
+
+		return dir;
+	}
+
+	void decompress_to_( TempFile_& aOut, char const* aPath, ZStdStreamConfig const& aStream )
+	{
+		ZStdIStream ins( aPath, aStream );
+
+		std::vector<char> buffer( 1024*1024 );
+		while( ins.read( buffer.data(), std::streamsize(buffer.size()) ) || ins.gcount() > 0 )
+			aOut.write( buffer.data(), std::size_t(ins.gcount()) );
+
+		// rapidobj opens the file by name
+		aOut.close();
+	}
+}
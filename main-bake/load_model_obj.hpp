@@ -2,9 +2,38 @@
 #define LOAD_MODEL_OBJ_HPP_7FB6DF28_3D89_48DD_9FD8_4E53FB04723C
 
 #include "input_model.hpp"
+#include "zstdistream.hpp"
+
+// How rapidobj gets to see the decompressed OBJ
+enum class ObjParseMode
+{
+	automatic, // file if the input is large and there are spare cores
+	stream,    // rapidobj::ParseStream() on a ZStdIStream (single thread)
+	file       // decompress to a temporary file, then rapidobj::ParseFile()
+};
+
+struct ObjLoadOptions
+{
+	ObjParseMode mode = ObjParseMode::automatic;
+
+	// Decompression of the input. Used for both modes.
+	ZStdStreamConfig stream;
+};
+
+// Time spent in the different stages of loading (in seconds)
+struct ObjLoadTimings
+{
+	ObjParseMode mode = ObjParseMode::stream; // the mode that was used
+
+	double decompress = 0.;   // decompression to the temporary file (file mode)
+	double parse = 0.;        // rapidobj::ParseFile() / ParseStream() (the
+	                          // latter includes decompression)
+	double triangulate = 0.;  // rapidobj::Triangulate()
+	double convert = 0.;      // material bucketing into the InputModel
+};
 
 // Load a Wavefront OBJ model
-InputModel load_compressed_wavefront_obj( char const* aPath );
+InputModel load_compressed_wavefront_obj( char const* aPath, ObjLoadTimings* aTimings = nullptr, ObjLoadOptions const& = {} );
 
 #endif // LOAD_MODEL_OBJ_HPP_7FB6DF28_3D89_48DD_9FD8_4E53FB04723C
 
@@ -1,4 +1,11 @@
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <limits>
+#include <numeric>
 #include <iterator>
+#include <algorithm>
 #include <vector>
 #include <typeinfo>
 #include <exception>
@@ -7,14 +14,22 @@
 #include <unordered_map>
 
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 
 #include <tgen.h>
+#include <zstd.h>
 #include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/type_precision.hpp>
 
 #include "index_mesh.hpp"
+#include "optimize_mesh.hpp"
+#include "meshlets.hpp"
+#include "simplify_mesh.hpp"
 #include "input_model.hpp"
 #include "load_model_obj.hpp"
+#include "zstdistream.hpp"
 
 #include "../utils/error.hpp"
 namespace lut = labutils;
@@ -36,8 +51,27 @@ namespace
 	 constexpr char kFileMagic[16] = "\0\0COMP5892Mmesh";
 
 	/* Note: change the file variant if you change the file format! 
+	 *
+	 * "28-toc" has the same layout as "27-toc". The renderer culls with the
+	 * position bias and scale (the mesh AABB), which could be too large in
+	 * earlier bakes; the loader notes those files, but still reads them.
+	 */
+	constexpr char kFileVariant[16] = "28-toc";
+
+	/* Alignment of the payloads listed in the table of contents (in bytes,
+	 * relative to the start of the file), and of the arrays within a mesh
+	 * payload. 64 bytes matches a cache line and is a multiple of any
+	 * alignment Vulkan asks for when copying buffers; 16 bytes is enough
+	 * for every element type and for SSE loads.
+	 */
+	constexpr std::size_t kPayloadAlignment = 64;
+	constexpr std::size_t kArrayAlignment = 16;
+
+	/* Header flags. Readers reject files with flags they don't know.
+	 *  - kFileFlagZstdMeshes: mesh payloads are byte-shuffled and zstd
+	 *    compressed, one frame per mesh (see write_model_data_()).
 	 */
-	constexpr char kFileVariant[16] = "21-tan";
+	constexpr std::uint32_t kFileFlagZstdMeshes = 1u << 0;
 
 	/* Fallback texture for RGBA 1111 and Grayscale 1
 	 */
@@ -45,7 +79,94 @@ namespace
 	constexpr char kTextureFallbackRGBA1111[] = "assets-src/main/rgba1111.png";
 	constexpr char kTextureFallbackRGB000[] = "assets-src/main/rgb000.png";
 
+	/* Size of the (simulated) FIFO post-transform vertex cache. Used both to
+	 * optimize the triangle order and to report ACMR/ATVR. Real hardware
+	 * varies; 16 is a reasonable middle ground.
+	 */
+	constexpr std::size_t kVertexCacheSize = 16;
+
+	/* Meshlet limits. These match common mesh shader limits (e.g. as
+	 * recommended for NVIDIA hardware); 124 triangles leaves room for the
+	 * primitive count in a 128-byte aligned index block.
+	 */
+	constexpr std::size_t kMeshletMaxVertices = 64;
+	constexpr std::size_t kMeshletMaxTriangles = 124;
+
+	/* Level of detail chain. Each level targets kLodIndexRatio times the
+	 * indices of the previous one, but stops early when the simplification
+	 * error would exceed the level's threshold (relative to the diagonal of
+	 * the mesh's AABB). Levels that do not remove at least kLodMinReduction
+	 * of the previous level's indices are dropped, and end the chain.
+	 */
+	constexpr std::size_t kLodMaxLevels = 4; // including the full detail mesh
+	constexpr float kLodIndexRatio = 0.5f;
+	constexpr float kLodMaxErrors[kLodMaxLevels] = { 0.f, 0.005f, 0.02f, 0.05f };
+	constexpr float kLodMinReduction = 0.1f;
+
 	// types
+	struct BakeOptions_
+	{
+		/* Number of threads used to index meshes. Zero selects the number
+		 * of hardware threads reported by std::thread.
+		 */
+		std::size_t threadCount = 0;
+
+		/* Benchmark the vertex vicinity structures used during indexing
+		 * instead of baking the model.
+		 */
+		bool benchVicinity = false;
+
+		/* Measure the OBJ decompression and parsing throughput with a few
+		 * stream configurations instead of baking the model.
+		 */
+		bool benchObjParse = false;
+
+		/* Decompression and parsing of the input OBJ. See ObjLoadOptions.
+		 */
+		ObjLoadOptions objLoad;
+
+		/* Reorder triangles for post-transform vertex cache locality and 
+		 * vertices for fetch locality after indexing.
+		 */
+		bool optimizeVertexCache = true;
+
+		/* Reorder triangle clusters after the vertex cache optimization to
+		 * reduce overdraw. Clusters may have an ACMR up to this factor 
+		 * worse than the cache-optimized order. Zero disables the pass.
+		 */
+		float overdrawThreshold = 1.05f;
+
+		/* Generate a simplified level of detail chain for each mesh.
+		 */
+		bool generateLods = true;
+
+		/* Compress each mesh payload as a separate zstd frame at this
+		 * level. Zero writes uncompressed payloads.
+		 */
+		int zstdLevel = 0;
+	};
+
+	struct ShuffleRange_
+	{
+		std::size_t offset, size, lane;
+	};
+
+	struct WriteStats_
+	{
+		std::uint64_t meshBytes = 0;       // uncompressed mesh payloads
+		std::uint64_t storedMeshBytes = 0; // as stored in the file
+	};
+
+	struct IndexingStats_
+	{
+		VertexCacheStats cacheBefore;
+		VertexCacheStats cacheAfter;
+
+		std::size_t lodMeshes[kLodMaxLevels] = {};
+		std::size_t lodIndices[kLodMaxLevels] = {};
+		double lodRelativeError[kLodMaxLevels] = {};
+	};
+
 	struct TextureInfo_
 	{
 		std::uint32_t uniqueId;
@@ -55,28 +176,71 @@ namespace
 	};
 
 	// local functions:
+	BakeOptions_ parse_options_( int, char* [] );
+
 	void process_model_(
 		char const* aOutput,
 		char const* aInputOBJ,
+		BakeOptions_ const&,
 		glm::mat4x4 const& aStaticTransform = glm::mat4x4( 1.f ) //TODO
 	);
 
 
 	InputModel normalize_( InputModel );
 
+	// Size of the mesh's indices in the file: 16 bits if all vertices can
+	// be addressed with them, 32 bits otherwise.
+	std::uint32_t index_size_( IndexedMesh const& );
+
+	// Transpose aBytes bytes, viewed as elements of aLane bytes, so that the
+	// first bytes of all elements come first, then all second bytes, etc.
+	// Trailing bytes that do not form a whole element are left in place.
+	void byte_shuffle_( std::byte*, std::size_t aBytes, std::size_t aLane );
+
+	// zstd compression (level 1..22)
+	std::size_t compress_bound_( std::size_t );
+	std::size_t compress_( void*, std::size_t, void const*, std::size_t, int aLevel );
+
 
 	void write_model_data_(
 		FILE*,
+		BakeOptions_ const&,
 		InputModel const&,
 		std::vector<IndexedMesh> const&,
-		std::unordered_map<std::string,TextureInfo_> const&
+		std::vector<MeshletData> const&,
+		std::unordered_map<std::string,TextureInfo_> const&,
+		WriteStats_&
 	);
 
 	std::vector<IndexedMesh> index_meshes_(
+		InputModel const&,
+		BakeOptions_ const&,
+		IndexingStats_&,
+		std::vector<MeshletData>&,
+		float aErrorTolerance = 1e-5f
+	);
+
+	TriangleSoup make_triangle_soup_(
+		InputModel const&,
+		InputMeshInfo const&
+	);
+
+	void generate_lods_(
+		IndexedMesh&,
+		BakeOptions_ const&,
+		IndexingStats_&
+	);
+
+	void benchmark_vicinity_(
 		InputModel const&,
 		float aErrorTolerance = 1e-5f
 	);
 
+	void benchmark_obj_parse_(
+		char const* aInputOBJ,
+		ObjLoadOptions const& aConfigured
+	);
+
 	std::unordered_map<std::string,TextureInfo_> find_unique_textures_(
 		InputModel const&
 	);
@@ -89,8 +253,10 @@ namespace
 }
 
 
-int main() try
+int main( int aArgc, char* aArgv[] ) try
 {
+	auto const options = parse_options_( aArgc, aArgv );
+
 #	if !defined(NDEBUG)
 	std::printf( "Suggest running this in release mode (it appears to be running in debug)\n" );
 	std::printf( "Especially under VisualStudio/MSVC, the debug build seems very slow.\n" );
@@ -126,7 +292,8 @@ int main() try
 #	endif
 	process_model_(
 		"assets/main/suntemple.comp5892mesh",
-		"assets-src/main/suntemple.obj-zstd"
+		"assets-src/main/suntemple.obj-zstd",
+		options
 	);
 
 	return 0;
@@ -139,9 +306,137 @@ catch( std::exception const& eErr )
 
 namespace
 {
-	void process_model_( char const* aOutput, char const* aInputOBJ, glm::mat4x4 const& aStaticTransform )
+	BakeOptions_ parse_options_( int aArgc, char* aArgv[] )
+	{
+		BakeOptions_ ret;
+
+		for( int i = 1; i < aArgc; ++i )
+		{
+			if( 0 == std::strcmp( aArgv[i], "--threads" ) || 0 == std::strcmp( aArgv[i], "-j" ) )
+			{
+				if( i+1 >= aArgc )
+					throw lut::Error( "Option '%s' requires an argument", aArgv[i] );
+
+				char* end = nullptr;
+				auto const count = std::strtoul( aArgv[i+1], &end, 10 );
+				if( end == aArgv[i+1] || '\0' != *end )
+					throw lut::Error( "Option '%s': expected a thread count, got '%s'", aArgv[i], aArgv[i+1] );
+
+				ret.threadCount = std::size_t(count);
+				++i;
+			}
+			else if( 0 == std::strcmp( aArgv[i], "--overdraw-threshold" ) )
+			{
+				if( i+1 >= aArgc )
+					throw lut::Error( "Option '%s' requires an argument", aArgv[i] );
+
+				char* end = nullptr;
+				auto const threshold = std::strtof( aArgv[i+1], &end );
+				if( end == aArgv[i+1] || '\0' != *end || threshold < 0.f || (threshold > 0.f && threshold < 1.f) )
+					throw lut::Error( "Option '%s': expected 0 or a factor >= 1, got '%s'", aArgv[i], aArgv[i+1] );
+
+				ret.overdrawThreshold = threshold;
+				++i;
+			}
+			else if( 0 == std::strcmp( aArgv[i], "--zstd" ) )
+			{
+				if( i+1 >= aArgc )
+					throw lut::Error( "Option '%s' requires an argument", aArgv[i] );
+
+				char* end = nullptr;
+				auto const level = std::strtol( aArgv[i+1], &end, 10 );
+				if( end == aArgv[i+1] || '\0' != *end || level < 0 || level > 22 )
+					throw lut::Error( "Option '%s': expected a compression level in 0..22, got '%s'", aArgv[i], aArgv[i+1] );
+
+				ret.zstdLevel = int(level);
+				++i;
+			}
+			else if( 0 == std::strcmp( aArgv[i], "--no-vertex-cache" ) )
+			{
+				ret.optimizeVertexCache = false;
+			}
+			else if( 0 == std::strcmp( aArgv[i], "--no-lods" ) )
+			{
+				ret.generateLods = false;
+			}
+			else if( 0 == std::strcmp( aArgv[i], "--obj-block-size" ) || 0 == std::strcmp( aArgv[i], "--obj-blocks" ) )
+			{
+				if( i+1 >= aArgc )
+					throw lut::Error( "Option '%s' requires an argument", aArgv[i] );
+
+				bool const isSize = 0 == std::strcmp( aArgv[i], "--obj-block-size" );
+
+				char* end = nullptr;
+				auto const value = std::strtoul( aArgv[i+1], &end, 10 );
+				if( end == aArgv[i+1] || '\0' != *end || (isSize && 0 == value) )
+					throw lut::Error( "Option '%s': expected a %s, got '%s'", aArgv[i], isSize ? "size in kB" : "block count", aArgv[i+1] );
+
+				if( isSize )
+					ret.objLoad.stream.blockSize = std::size_t(value) * 1024;
+				else
+					ret.objLoad.stream.blockCount = std::size_t(value);
+
+				++i;
+			}
+			else if( 0 == std::strcmp( aArgv[i], "--obj-parse" ) )
+			{
+				if( i+1 >= aArgc )
+					throw lut::Error( "Option '%s' requires an argument", aArgv[i] );
+
+				if( 0 == std::strcmp( aArgv[i+1], "auto" ) )
+					ret.objLoad.mode = ObjParseMode::automatic;
+				else if( 0 == std::strcmp( aArgv[i+1], "stream" ) )
+					ret.objLoad.mode = ObjParseMode::stream;
+				else if( 0 == std::strcmp( aArgv[i+1], "file" ) )
+					ret.objLoad.mode = ObjParseMode::file;
+				else
+					throw lut::Error( "Option '%s': expected 'auto', 'stream' or 'file', got '%s'", aArgv[i], aArgv[i+1] );
+
+				++i;
+			}
+			else if( 0 == std::strcmp( aArgv[i], "--bench-vicinity" ) )
+			{
+				ret.benchVicinity = true;
+			}
+			else if( 0 == std::strcmp( aArgv[i], "--bench-obj" ) )
+			{
+				ret.benchObjParse = true;
+			}
+			else if( 0 == std::strcmp( aArgv[i], "--help" ) || 0 == std::strcmp( aArgv[i], "-h" ) )
+			{
+				std::printf( "Usage: %s [options]\n", aArgv[0] );
+				std::printf( "  -j, --threads N     index meshes using N threads (0 = hardware threads, default)\n" );
+				std::printf( "  --no-vertex-cache   skip vertex cache, overdraw and vertex fetch optimization\n" );
+				std::printf( "  --overdraw-threshold T\n" );
+				std::printf( "                      max. ACMR factor for overdraw optimization (0 = off, default 1.05)\n" );
+				std::printf( "  --no-lods           only store the full detail mesh\n" );
+				std::printf( "  --zstd L            compress mesh payloads with zstd level L (0 = off, default)\n" );
+				std::printf( "  --obj-block-size K  decompress the input OBJ in blocks of K kB (default 128)\n" );
+				std::printf( "  --obj-blocks N      number of decompressed blocks; 2+ decompress ahead on a\n" );
+				std::printf( "                      background thread, 1 on demand (default 3)\n" );
+				std::printf( "  --obj-parse M       'stream': parse while decompressing (one thread), 'file':\n" );
+				std::printf( "                      decompress to a temporary file and parse that with multiple\n" );
+				std::printf( "                      threads, 'auto': pick by input size and core count (default)\n" );
+				std::printf( "  --bench-vicinity    compare vertex vicinity structures instead of baking\n" );
+				std::printf( "  --bench-obj         measure OBJ decompression/parse throughput instead of baking\n" );
+				std::exit( 0 );
+			}
+			else
+			{
+				throw lut::Error( "Unknown option '%s' (try --help)", aArgv[i] );
+			}
+		}
+
+		return ret;
+	}
+}
+
+namespace
+{
+	void process_model_( char const* aOutput, char const* aInputOBJ, BakeOptions_ const& aOptions, glm::mat4x4 const& aStaticTransform )
 	{
 		static constexpr std::size_t vertexSize = sizeof(float)*(3+3+2);
+		static constexpr std::size_t bakedVertexSize = sizeof(glm::u16vec4) + sizeof(glm::u16vec2) + sizeof(std::uint32_t);
 
 		// Figure out output paths
 		std::filesystem::path const outname( aOutput );
@@ -149,8 +444,15 @@ namespace
 		std::filesystem::path const basename = outname.stem();
 		std::filesystem::path const texdir = basename.string() + "-tex";
 
+		if( aOptions.benchObjParse )
+		{
+			benchmark_obj_parse_( aInputOBJ, aOptions.objLoad );
+			return;
+		}
+
 		// Load input model
-		auto const model = normalize_( load_compressed_wavefront_obj( aInputOBJ ) );
+		ObjLoadTimings loadTimes;
+		auto const model = normalize_( load_compressed_wavefront_obj( aInputOBJ, &loadTimes, aOptions.objLoad ) );
 
 		std::size_t inputVerts = 0;
 		for( auto const& imesh : model.meshes )
@@ -158,18 +460,81 @@ namespace
 
 		std::printf( "%s: %zu meshes, %zu materials\n", aInputOBJ, model.meshes.size(), model.materials.size() );
 		std::printf( " - triangle soup vertices: %zu => %zu kB\n", inputVerts, inputVerts*vertexSize/1024 );
+		std::printf( " - loading took %.2f s\n", loadTimes.decompress+loadTimes.parse+loadTimes.triangulate+loadTimes.convert );
+		if( ObjParseMode::file == loadTimes.mode )
+			std::printf( "   - decompress to temporary file %.2f s, parse (%u thread(s)) %.2f s\n", loadTimes.decompress, std::thread::hardware_concurrency(), loadTimes.parse );
+		else
+			std::printf( "   - decompress + parse stream (1 thread) %.2f s\n", loadTimes.parse );
+		std::printf( "   - triangulate %.2f s, material bucketing %.3f s\n", loadTimes.triangulate, loadTimes.convert );
+
+		if( aOptions.benchVicinity )
+		{
+			benchmark_vicinity_( model );
+			return;
+		}
 
 		// Index meshes
-		auto const indexed = index_meshes_( model );
+		auto options = aOptions;
+		if( 0 == options.threadCount )
+			options.threadCount = std::max( 1u, std::thread::hardware_concurrency() );
+
+		IndexingStats_ stats;
+		std::vector<MeshletData> meshlets;
 
-		std::size_t outputVerts = 0, outputIndices = 0;
+		auto const indexStart = std::chrono::steady_clock::now();
+		auto const indexed = index_meshes_( model, options, stats, meshlets );
+		auto const indexTime = std::chrono::duration<double>( std::chrono::steady_clock::now() - indexStart ).count();
+
+		std::size_t outputVerts = 0, outputIndices = 0, outputIndexBytes = 0, shortIndexMeshes = 0;
 		for( auto const& mesh : indexed )
 		{
 			outputVerts += mesh.vert.size();
 			outputIndices += mesh.indices.size();
+
+			auto const indexSize = index_size_( mesh );
+			outputIndexBytes += mesh.indices.size() * indexSize;
+			if( sizeof(std::uint16_t) == indexSize )
+				++shortIndexMeshes;
 		}
 
 		std::printf( " - indexed vertices: %zu with %zu indices => %zu kB\n", outputVerts, outputIndices, (outputVerts*vertexSize + outputIndices*sizeof(std::uint32_t))/1024 );
+		std::printf( " - baked vertex data: %zu bytes/vertex => %zu kB\n", bakedVertexSize, outputVerts*bakedVertexSize/1024 );
+		std::printf( " - indexing took %.2f s using %zu thread(s)\n", indexTime, options.threadCount );
+		std::printf( " - 16-bit indices: %zu of %zu meshes => %zu kB of indices (%zu kB as 32-bit)\n", shortIndexMeshes, indexed.size(), outputIndexBytes/1024, outputIndices*sizeof(std::uint32_t)/1024 );
+
+		if( options.optimizeVertexCache )
+		{
+			std::printf( " - vertex cache (FIFO %zu): ACMR %.3f => %.3f, ATVR %.3f => %.3f\n", kVertexCacheSize, stats.cacheBefore.acmr(), stats.cacheAfter.acmr(), stats.cacheBefore.atvr(), stats.cacheAfter.atvr() );
+			if( options.overdrawThreshold > 0.f )
+				std::printf( " - overdraw optimization: threshold %.2f\n", options.overdrawThreshold );
+		}
+		else
+		{
+			std::printf( " - vertex cache (FIFO %zu): ACMR %.3f, ATVR %.3f (not optimized)\n", kVertexCacheSize, stats.cacheBefore.acmr(), stats.cacheBefore.atvr() );
+		}
+
+		std::size_t meshletCount = 0, meshletVerts = 0, meshletCones = 0;
+		for( auto const& data : meshlets )
+		{
+			meshletCount += data.meshlets.size();
+			meshletVerts += data.vertices.size();
+
+			for( auto const& meshlet : data.meshlets )
+			{
+				if( meshlet.coneCutoff < 1.f )
+					++meshletCones;
+			}
+		}
+
+		std::printf( " - meshlets: %zu (max %zu verts, %zu tris), %.1f verts/meshlet avg, %zu with usable normal cone\n", meshletCount, kMeshletMaxVertices, kMeshletMaxTriangles, meshletCount ? double(meshletVerts)/meshletCount : 0., meshletCones );
+
+		for( std::size_t i = 0; i < kLodMaxLevels; ++i )
+		{
+			if( 0 == stats.lodMeshes[i] )
+				break;
+
+			std::printf( " - LOD %zu: %zu meshes, %zu indices (%.1f%% of LOD 0), avg. error %.3f%% of mesh size\n", i, stats.lodMeshes[i], stats.lodIndices[i], 100. * stats.lodIndices[i] / stats.lodIndices[0], 100. * stats.lodRelativeError[i] / stats.lodMeshes[i] );
+		}
 
 		// Find list of unique textures
 		auto const textures = new_paths_( find_unique_textures_( model ), texdir );
@@ -187,9 +552,11 @@ namespace
 		if( !fof )
 			throw lut::Error( "Unable to open '%s' for writing", mainpath.string().c_str() );
 
+		WriteStats_ writeStats;
+
 		try
 		{
-			write_model_data_( fof, model, indexed, textures );
+			write_model_data_( fof, aOptions, model, indexed, meshlets, textures, writeStats );
 		}
 		catch( ... )
 		{
@@ -199,6 +566,11 @@ namespace
 
 		std::fclose( fof );
 
+		if( aOptions.zstdLevel )
+			std::printf( " - mesh payloads: %llu kB => %llu kB with zstd level %d (%.2fx)\n", (unsigned long long)(writeStats.meshBytes/1024), (unsigned long long)(writeStats.storedMeshBytes/1024), aOptions.zstdLevel, double(writeStats.meshBytes) / double(writeStats.storedMeshBytes) );
+		else
+			std::printf( " - mesh payloads: %llu kB (uncompressed)\n", (unsigned long long)(writeStats.meshBytes/1024) );
+
 		// Copy textures
 		std::filesystem::create_directories( rootdir / texdir );
 
@@ -261,34 +633,114 @@ namespace
 			throw lut::Error( "fwrite() failed: %zu instead of %zu", ret, aBytes );
 	}
 
-	void write_string_( FILE* aOut, char const* aString )
+	void byte_shuffle_( std::byte* aData, std::size_t aBytes, std::size_t aLane )
 	{
-		// Write a string
-		// Format:
-		//  - uint32_t : N = length of string in bytes, including terminating '\0'
-		//  - N x char : string
-		std::uint32_t const length = std::uint32_t(std::strlen(aString)+1);
-		checked_write_( aOut, sizeof(std::uint32_t), &length );
+		if( aLane <= 1 )
+			return;
 
-		checked_write_( aOut, length, aString );
+		auto const count = aBytes / aLane;
+		std::vector<std::byte> const source( aData, aData + count*aLane );
+
+		for( std::size_t i = 0; i < count; ++i )
+		{
+			for( std::size_t b = 0; b < aLane; ++b )
+				aData[b*count + i] = source[i*aLane + b];
+		}
 	}
 
-	void write_model_data_( FILE* aOut, InputModel const& aModel, std::vector<IndexedMesh> const& aIndexedMeshes, std::unordered_map<std::string,TextureInfo_> const& aTextures )
+	std::size_t compress_bound_( std::size_t aBytes )
 	{
-		// Write header
-		// Format:
-		//   - char[16] : file magic
-		//   - char[16] : file variant ID
-		checked_write_( aOut, sizeof(char)*16, kFileMagic );
-		checked_write_( aOut, sizeof(char)*16, kFileVariant );
-		
-		// Write list of unique textures
-		// Format:
-		//  - unit32_t : U = number of unique textures
-		//  - repeat U times:
-		//    - string : path to texture 
-		//    - uint8_t : texture color space (0 = unorm, 1 = srgb)
-		//    - uint8_t : number of channels in texture
+		return ZSTD_COMPRESSBOUND( aBytes );
+	}
+
+	std::size_t compress_( void* aDst, std::size_t aDstBytes, void const* aSrc, std::size_t aSrcBytes, int aLevel )
+	{
+		auto const ret = ZSTD_compress( aDst, aDstBytes, aSrc, aSrcBytes, aLevel );
+		if( ZSTD_isError( ret ) )
+			throw lut::Error( "ZSTD_compress() failed: %s", ZSTD_getErrorName( ret ) );
+
+		return ret;
+	}
+
+	std::uint32_t index_size_( IndexedMesh const& aMesh )
+	{
+		return aMesh.vert.size() <= std::size_t(std::numeric_limits<std::uint16_t>::max())+1
+			? sizeof(std::uint16_t)
+			: sizeof(std::uint32_t)
+		;
+	}
+
+	std::vector<glm::u16vec4> quantize_positions_( IndexedMesh const& aMesh, glm::vec3& aScale, glm::vec3& aBias )
+	{
+		// 16-bit unorm relative to the mesh's AABB. The fourth component is
+		// padding: three-component 16-bit formats are not required to be
+		// supported for vertex buffers, but R16G16B16A16_UNORM is.
+		aBias = aMesh.aabbMin;
+		aScale = aMesh.aabbMax - aMesh.aabbMin;
+
+		glm::vec3 invScale( 0.f );
+		for( int i = 0; i < 3; ++i )
+		{
+			if( aScale[i] > 0.f )
+				invScale[i] = 65535.f / aScale[i];
+		}
+
+		std::vector<glm::u16vec4> ret;
+		ret.reserve( aMesh.vert.size() );
+
+		for( auto const& p : aMesh.vert )
+		{
+			auto const q = glm::clamp( glm::round( (p - aBias) * invScale ), glm::vec3( 0.f ), glm::vec3( 65535.f ) );
+			ret.emplace_back( glm::u16vec4( q, 0 ) );
+		}
+
+		return ret;
+	}
+
+	std::vector<glm::u16vec2> pack_texcoords_( IndexedMesh const& aMesh )
+	{
+		std::vector<glm::u16vec2> ret;
+		ret.reserve( aMesh.text.size() );
+
+		for( auto const& t : aMesh.text )
+			ret.emplace_back( glm::packHalf1x16( t.x ), glm::packHalf1x16( t.y ) );
+
+		return ret;
+	}
+
+	void write_model_data_( FILE* aOut, BakeOptions_ const& aOptions, InputModel const& aModel, std::vector<IndexedMesh> const& aIndexedMeshes, std::vector<MeshletData> const& aMeshlets, std::unordered_map<std::string,TextureInfo_> const& aTextures, WriteStats_& aStats )
+	{
+		assert( aModel.meshes.size() == aIndexedMeshes.size() );
+		assert( aModel.meshes.size() == aMeshlets.size() );
+
+		// Everything is written through write_(), which keeps track of the
+		// current offset in the file, so that payload offsets for the table
+		// of contents are known without seeking.
+		std::uint64_t offset = 0;
+
+		auto const write_ = [&] (std::size_t aBytes, void const* aData) {
+			checked_write_( aOut, aBytes, aData );
+			offset += aBytes;
+		};
+		auto const write_u32_ = [&] (std::size_t aValue) {
+			assert( aValue <= std::numeric_limits<std::uint32_t>::max() );
+			std::uint32_t const value = std::uint32_t(aValue);
+			write_( sizeof(value), &value );
+		};
+		auto const write_string_ = [&] (std::string const& aString) {
+			// Format:
+			//  - uint32_t : N = length of string in bytes, including terminating '\0'
+			//  - N x char : string
+			write_u32_( aString.size()+1 );
+			write_( aString.size()+1, aString.c_str() );
+		};
+		auto const align_ = [&] (std::size_t aAlignment) {
+			static constexpr std::uint8_t zeros[kPayloadAlignment] = {};
+			assert( aAlignment <= kPayloadAlignment );
+			write_( std::size_t((aAlignment - offset % aAlignment) % aAlignment), zeros );
+		};
+
+		// Order textures by their unique ID
 		std::vector<TextureInfo_ const*> orderedUnqiue( aTextures.size() );
 		for( auto const& tex : aTextures )
 		{
@@ -296,24 +748,71 @@ namespace
 			orderedUnqiue[tex.second.uniqueId] = &tex.second;
 		}
 
-		std::uint32_t const textureCount = std::uint32_t(orderedUnqiue.size());
-		checked_write_( aOut, sizeof(textureCount), &textureCount );
+		// Write header
+		// Format:
+		//   - char[16] : file magic
+		//   - char[16] : file variant ID
+		//   - uint32_t : T = number of unique textures
+		//   - uint32_t : M = number of materials
+		//   - uint32_t : N = number of meshes
+		//   - uint32_t : flags (kFileFlag*)
+		write_( sizeof(char)*16, kFileMagic );
+		write_( sizeof(char)*16, kFileVariant );
+
+		write_u32_( orderedUnqiue.size() );
+		write_u32_( aModel.materials.size() );
+		write_u32_( aModel.meshes.size() );
+		write_u32_( aOptions.zstdLevel ? kFileFlagZstdMeshes : 0 );
+
+		// Write table of contents
+		// Format:
+		//  - repeat T + 1 + N times (textures, material block, meshes):
+		//    - uint64_t : offset of the payload from the start of the file
+		//    - uint64_t : size of the payload in bytes
+		// The entries are not known yet; they are filled in at the end.
+		struct TocEntry_
+		{
+			std::uint64_t offset, size;
+		};
+
+		std::vector<TocEntry_> toc( orderedUnqiue.size() + 1 + aModel.meshes.size() );
+
+		auto const tocOffset = offset;
+		write_( sizeof(TocEntry_)*toc.size(), toc.data() );
 
+		std::size_t tocIndex = 0;
+		auto const begin_payload_ = [&] {
+			align_( kPayloadAlignment );
+			toc[tocIndex].offset = offset;
+		};
+		auto const end_payload_ = [&] {
+			toc[tocIndex].size = offset - toc[tocIndex].offset;
+			++tocIndex;
+		};
+
+		// Write textures; one payload per texture
+		// Format:
+		//  - string : path to texture 
+		//  - uint8_t : texture color space (0 = unorm, 1 = srgb)
+		//  - uint8_t : number of channels in texture
 		for( auto const& tex : orderedUnqiue )
 		{
 			assert( tex );
-			write_string_( aOut, tex->newPath.c_str() );
+			begin_payload_();
+
+			write_string_( tex->newPath );
 
 			std::uint8_t space = tex->space;
-			checked_write_( aOut, sizeof(space), &space );
+			write_( sizeof(space), &space );
 
 			std::uint8_t channels = tex->channels;
-			checked_write_( aOut, sizeof(channels), &channels );
+			write_( sizeof(channels), &channels );
+
+			end_payload_();
 		}
 
-		// Write material information
+		// Write material information; one payload for all materials
 		// Format:
-		//  - uint32_t : M = number of materials
 		//  - repeat M times:
 		//    - uin32_t : base color texture index
 		//    - uin32_t : roughness texture index
@@ -321,8 +820,7 @@ namespace
 		//    - uin32_t : alphaMask texture index (or 0xffffffff if none)
 		//    - uin32_t : normalMap texture index (or 0xffffffff if none)
 		//    - uin32_t : emissive texture index
-		std::uint32_t const materialCount = std::uint32_t(aModel.materials.size());
-		checked_write_( aOut, sizeof(materialCount), &materialCount );
+		begin_payload_();
 
 		for( auto const& mat : aModel.materials )
 		{
@@ -330,14 +828,14 @@ namespace
 				if( aTexturePath.empty() )
 				{
 					static constexpr std::uint32_t sentinel = ~std::uint32_t(0);
-					checked_write_( aOut, sizeof(std::uint32_t), &sentinel );
+					write_( sizeof(std::uint32_t), &sentinel );
 					return;
 				}
 
 				auto const it = aTextures.find( aTexturePath );
 				assert( aTextures.end() != it );
 
-				checked_write_( aOut, sizeof(std::uint32_t), &it->second.uniqueId );
+				write_( sizeof(std::uint32_t), &it->second.uniqueId );
 			};
 
 			write_tex_( mat.baseColorTexturePath );
@@ -348,77 +846,442 @@ namespace
 			write_tex_( mat.emissiveTexturePath );
 		}
 
-		// Write mesh data
+		end_payload_();
+
+		// Write mesh data; one payload per mesh, including its meshlets
 		// Format:
-		//  - uint32_t : M = number of meshes
-		//  - repeat M times:
-		//    - uint32_t : material index
-		//    - uint32_t : V = number of vertices
-		//    - uint32_t : I = number of indices
-		//    - repeat V times: vec3 position
-		//    - repeat V times: vec3 normal
-		//    - repeat V times: vec2 texture coordinate
-		//    - repeat V times: vec4 tangent
-		//    - repeat I times: uint32_t index
-		std::uint32_t const meshCount = std::uint32_t(aModel.meshes.size());
-		checked_write_( aOut, sizeof(meshCount), &meshCount );
+		//  - uint32_t : material index
+		//  - uint32_t : V = number of vertices
+		//  - uint32_t : I = number of indices
+		//  - uint32_t : S = size of an index in bytes (2 or 4)
+		//  - uint32_t : L = number of levels of detail
+		//  - uint32_t : K = number of meshlets
+		//  - uint32_t : MV = number of meshlet vertex indices
+		//  - uint32_t : MT = number of meshlet triangles
+		//  - vec3 : position scale (extent of the mesh's AABB)
+		//  - vec3 : position bias (minimum of the mesh's AABB)
+		//  - 2x uint32_t : reserved (zero)
+		//  Followed by these arrays, each starting at a multiple of
+		//  kArrayAlignment bytes:
+		//  - repeat V times: 4x uint16_t position, unorm relative to the
+		//                    AABB (fourth component is padding)
+		//  - repeat V times: 2x uint16_t texture coordinate (half float)
+		//  - repeat V times: uint32_t packed TBN quaternion (A2R10G10B10)
+		//  - repeat I times: uint16_t (S = 2) or uint32_t (S = 4) index
+		//  - repeat L times:
+		//    - uint32_t : first index, index count (into the indices)
+		//    - float : simplification error in model units
+		//  - repeat K times:
+		//    - uint32_t : vertex offset, vertex count (into meshlet vertices)
+		//    - uint32_t : triangle offset, triangle count (into meshlet
+		//                 triangles, and equivalently into the mesh's indices)
+		//    - vec3 center, float radius : bounding sphere
+		//    - vec3 cone apex, vec3 cone axis, float cone cutoff
+		//  - repeat MV times: uint32_t mesh vertex index
+		//  - repeat MT times: 3x uint8_t meshlet-local vertex index
+		//
+		// Mesh payloads are assembled in memory, since they may be compressed
+		// before writing. With kFileFlagZstdMeshes, each mesh payload is a
+		// single zstd frame. Before compression, each array is byte-shuffled
+		// (see byte_shuffle_()) with its element's component size as the lane
+		// size; the header and padding are left as is.
+		std::vector<std::byte> payload, compressed;
+		std::vector<ShuffleRange_> arrays;
+
+		auto const put_ = [&] (std::size_t aBytes, void const* aData) {
+			auto const* bytes = static_cast<std::byte const*>(aData);
+			payload.insert( payload.end(), bytes, bytes+aBytes );
+		};
+		auto const put_u32_ = [&] (std::size_t aValue) {
+			assert( aValue <= std::numeric_limits<std::uint32_t>::max() );
+			std::uint32_t const value = std::uint32_t(aValue);
+			put_( sizeof(value), &value );
+		};
+		auto const begin_array_ = [&] (std::size_t aLane) {
+			// Payloads start at a multiple of kPayloadAlignment, so alignment
+			// relative to the payload is the same as within the file.
+			payload.resize( (payload.size() + kArrayAlignment-1) / kArrayAlignment * kArrayAlignment );
+			arrays.emplace_back( ShuffleRange_{ payload.size(), 0, aLane } );
+		};
+		auto const end_array_ = [&] {
+			arrays.back().size = payload.size() - arrays.back().offset;
+		};
 
-		assert( aModel.meshes.size() == aIndexedMeshes.size() );
 		for( std::size_t i = 0; i < aModel.meshes.size(); ++i )
 		{
 			auto const& mmesh = aModel.meshes[i];
+			auto const& imesh = aIndexedMeshes[i];
+			auto const& mdata = aMeshlets[i];
+
+			auto const vertexCount = imesh.vert.size();
+			auto const indexCount = imesh.indices.size();
+			auto const indexSize = index_size_( imesh );
+			auto const triangleCount = mdata.triangles.size() / 3;
+
+			glm::vec3 scale, bias;
+			auto const positions = quantize_positions_( imesh, scale, bias );
+			auto const texcoords = pack_texcoords_( imesh );
+
+			payload.clear();
+			arrays.clear();
+
+			put_u32_( mmesh.materialIndex );
+			put_u32_( vertexCount );
+			put_u32_( indexCount );
+			put_u32_( indexSize );
+			put_u32_( imesh.lods.size() );
+			put_u32_( mdata.meshlets.size() );
+			put_u32_( mdata.vertices.size() );
+			put_u32_( triangleCount );
+
+			put_( sizeof(glm::vec3), &scale );
+			put_( sizeof(glm::vec3), &bias );
+			put_u32_( 0 );
+			put_u32_( 0 );
+
+			begin_array_( sizeof(std::uint16_t) );
+			put_( sizeof(glm::u16vec4)*vertexCount, positions.data() );
+			end_array_();
+			begin_array_( sizeof(std::uint16_t) );
+			put_( sizeof(glm::u16vec2)*vertexCount, texcoords.data() );
+			end_array_();
+			begin_array_( sizeof(std::uint32_t) );
+			put_( sizeof(std::uint32_t)*vertexCount, imesh.tangentComp.data() );
+			end_array_();
+
+			begin_array_( indexSize );
+			if( sizeof(std::uint16_t) == indexSize )
+			{
+				std::vector<std::uint16_t> indices( imesh.indices.begin(), imesh.indices.end() );
+				put_( sizeof(std::uint16_t)*indices.size(), indices.data() );
+			}
+			else
+			{
+				put_( sizeof(std::uint32_t)*indexCount, imesh.indices.data() );
+			}
+			end_array_();
 
-			std::uint32_t materialIndex = std::uint32_t(mmesh.materialIndex);
-			checked_write_( aOut, sizeof(materialIndex), &materialIndex );
+			begin_array_( sizeof(std::uint32_t) );
+			for( auto const& lod : imesh.lods )
+			{
+				put_( sizeof(std::uint32_t), &lod.firstIndex );
+				put_( sizeof(std::uint32_t), &lod.indexCount );
+				put_( sizeof(float), &lod.error );
+			}
+			end_array_();
 
-			auto const& imesh = aIndexedMeshes[i];
+			begin_array_( sizeof(std::uint32_t) );
+			for( auto const& meshlet : mdata.meshlets )
+			{
+				put_( sizeof(std::uint32_t), &meshlet.vertexOffset );
+				put_( sizeof(std::uint32_t), &meshlet.vertexCount );
+				put_( sizeof(std::uint32_t), &meshlet.triangleOffset );
+				put_( sizeof(std::uint32_t), &meshlet.triangleCount );
+
+				put_( sizeof(glm::vec3), &meshlet.center );
+				put_( sizeof(float), &meshlet.radius );
+
+				put_( sizeof(glm::vec3), &meshlet.coneApex );
+				put_( sizeof(glm::vec3), &meshlet.coneAxis );
+				put_( sizeof(float), &meshlet.coneCutoff );
+			}
+			end_array_();
+
+			begin_array_( sizeof(std::uint32_t) );
+			put_( sizeof(std::uint32_t)*mdata.vertices.size(), mdata.vertices.data() );
+			end_array_();
+			begin_array_( sizeof(std::uint8_t) );
+			put_( sizeof(std::uint8_t)*3*triangleCount, mdata.triangles.data() );
+			end_array_();
+
+			begin_payload_();
 
-			std::uint32_t vertexCount = std::uint32_t(imesh.vert.size());
-			checked_write_( aOut, sizeof(vertexCount), &vertexCount );
-			std::uint32_t indexCount = std::uint32_t(imesh.indices.size());
-			checked_write_( aOut, sizeof(indexCount), &indexCount );
+			aStats.meshBytes += payload.size();
+			if( aOptions.zstdLevel )
+			{
+				for( auto const& range : arrays )
+					byte_shuffle_( payload.data() + range.offset, range.size, range.lane );
+
+				compressed.resize( compress_bound_( payload.size() ) );
+				compressed.resize( compress_( compressed.data(), compressed.size(), payload.data(), payload.size(), aOptions.zstdLevel ) );
 
-			checked_write_( aOut, sizeof(glm::vec3)*vertexCount, imesh.vert.data() );
-			checked_write_( aOut, sizeof(glm::vec3)*vertexCount, imesh.norm.data() );
-			checked_write_( aOut, sizeof(glm::vec2)*vertexCount, imesh.text.data() );
-			checked_write_( aOut, sizeof(glm::vec4)*vertexCount, imesh.tangent.data() ); // imesh.tangent populated in index_mesh.cpp
-			checked_write_( aOut, sizeof(std::uint32_t)*vertexCount, imesh.tangentComp.data() );
+				write_( compressed.size(), compressed.data() );
+				aStats.storedMeshBytes += compressed.size();
+			}
+			else
+			{
+				write_( payload.size(), payload.data() );
+				aStats.storedMeshBytes += payload.size();
+			}
 
-			checked_write_( aOut, sizeof(std::uint32_t)*indexCount, imesh.indices.data() );
+			end_payload_();
 		}
+
+		assert( toc.size() == tocIndex );
+
+		// Fill in the table of contents
+		if( 0 != std::fseek( aOut, long(tocOffset), SEEK_SET ) )
+			throw lut::Error( "fseek() failed" );
+
+		checked_write_( aOut, sizeof(TocEntry_)*toc.size(), toc.data() );
 	}
 }
 
 namespace
 {
-	std::vector<IndexedMesh> index_meshes_( InputModel const& aModel, float aErrorTolerance )
+	std::vector<IndexedMesh> index_meshes_( InputModel const& aModel, BakeOptions_ const& aOptions, IndexingStats_& aStats, std::vector<MeshletData>& aMeshlets, float aErrorTolerance )
 	{
-		std::vector<IndexedMesh> indexed;
+		// Each mesh is indexed independently, so meshes can be distributed
+		// across a set of worker threads. Results are stored at the mesh's
+		// original position, which keeps the output identical to the
+		// sequential version regardless of the number of threads.
+		std::vector<IndexedMesh> indexed( aModel.meshes.size() );
+		std::vector<IndexingStats_> stats( aModel.meshes.size() );
+
+		aMeshlets.clear();
+		aMeshlets.resize( aModel.meshes.size() );
+
+		// Hand out the largest meshes first. The cost of indexing a mesh
+		// grows with its vertex count; starting with the large ones avoids
+		// a single big mesh being picked up last and keeping one thread
+		// busy while all others are idle.
+		std::vector<std::size_t> order( aModel.meshes.size() );
+		std::iota( order.begin(), order.end(), std::size_t(0) );
+		std::stable_sort( order.begin(), order.end(), [&] (std::size_t aI, std::size_t aJ) {
+			return aModel.meshes[aI].vertexCount > aModel.meshes[aJ].vertexCount;
+		} );
+
+		std::atomic<std::size_t> next{ 0 };
+
+		std::mutex errorMutex;
+		std::exception_ptr error;
+
+		auto const worker_ = [&] {
+			for( std::size_t i; (i = next.fetch_add( 1 )) < order.size(); )
+			{
+				auto const meshIndex = order[i];
 
-		for( auto const& imesh : aModel.meshes )
+				try
+				{
+					auto const soup = make_triangle_soup_( aModel, aModel.meshes[meshIndex] );
+
+					auto& mesh = indexed[meshIndex];
+					mesh = make_indexed_mesh( soup, aErrorTolerance );
+
+					auto& meshStats = stats[meshIndex];
+					meshStats.cacheBefore = analyze_vertex_cache( mesh.indices, mesh.vert.size(), kVertexCacheSize );
+
+					if( aOptions.optimizeVertexCache )
+					{
+						optimize_vertex_cache( mesh.indices, mesh.vert.size(), kVertexCacheSize );
+
+						if( aOptions.overdrawThreshold > 0.f )
+							optimize_overdraw( mesh.indices, mesh.vert, kVertexCacheSize, aOptions.overdrawThreshold );
+
+						optimize_vertex_fetch( mesh );
+
+						meshStats.cacheAfter = analyze_vertex_cache( mesh.indices, mesh.vert.size(), kVertexCacheSize );
+					}
+
+					// Meshlets refer to the full detail mesh only. LODs are
+					// appended to the index buffer afterwards, so that the
+					// meshlets' triangle ranges stay valid.
+					aMeshlets[meshIndex] = make_meshlets( mesh, kMeshletMaxVertices, kMeshletMaxTriangles );
+
+					mesh.lods.assign( 1, MeshLod{ 0, std::uint32_t(mesh.indices.size()), 0.f } );
+					if( aOptions.generateLods )
+						generate_lods_( mesh, aOptions, meshStats );
+				}
+				catch( ... )
+				{
+					std::lock_guard<std::mutex> lock( errorMutex );
+					if( !error )
+						error = std::current_exception();
+
+					next = order.size(); // stop handing out work
+				}
+			}
+		};
+
+		std::size_t const threadCount = std::min( aOptions.threadCount, order.size() );
+
+		std::vector<std::thread> threads;
+		if( threadCount > 1 )
 		{
-			auto const endIndex = imesh.vertexStartIndex + imesh.vertexCount;
+			threads.reserve( threadCount-1 );
+			for( std::size_t i = 1; i < threadCount; ++i )
+				threads.emplace_back( worker_ );
+		}
 
-			TriangleSoup soup;
+		worker_(); // the calling thread participates as well
 
-			soup.vert.reserve( imesh.vertexCount );
-			for( std::size_t i = imesh.vertexStartIndex; i < endIndex; ++i )
-				soup.vert.emplace_back( aModel.positions[i] );
+		for( auto& thread : threads )
+			thread.join();
 
-			soup.text.reserve( imesh.vertexCount );
-			for( std::size_t i = imesh.vertexStartIndex; i < endIndex; ++i )
-				soup.text.emplace_back( aModel.texcoords[i] );
+		if( error )
+			std::rethrow_exception( error );
 
-			soup.norm.reserve( imesh.vertexCount );
-			for( std::size_t i = imesh.vertexStartIndex; i < endIndex; ++i )
-				soup.norm.emplace_back( aModel.normals[i] );
+		for( auto const& meshStats : stats )
+		{
+			aStats.cacheBefore += meshStats.cacheBefore;
+			aStats.cacheAfter += meshStats.cacheAfter;
 
+			for( std::size_t i = 0; i < kLodMaxLevels; ++i )
+				aStats.lodRelativeError[i] += meshStats.lodRelativeError[i];
+		}
 
-			indexed.emplace_back( make_indexed_mesh( soup, aErrorTolerance ) );
+		for( auto const& mesh : indexed )
+		{
+			for( std::size_t i = 0; i < mesh.lods.size(); ++i )
+			{
+				++aStats.lodMeshes[i];
+				aStats.lodIndices[i] += mesh.lods[i].indexCount;
+			}
 		}
 
 		return indexed;
 	}
+
+	TriangleSoup make_triangle_soup_( InputModel const& aModel, InputMeshInfo const& aMesh )
+	{
+		auto const endIndex = aMesh.vertexStartIndex + aMesh.vertexCount;
+
+		TriangleSoup soup;
+
+		soup.vert.reserve( aMesh.vertexCount );
+		for( std::size_t i = aMesh.vertexStartIndex; i < endIndex; ++i )
+			soup.vert.emplace_back( aModel.positions[i] );
+
+		soup.text.reserve( aMesh.vertexCount );
+		for( std::size_t i = aMesh.vertexStartIndex; i < endIndex; ++i )
+			soup.text.emplace_back( aModel.texcoords[i] );
+
+		soup.norm.reserve( aMesh.vertexCount );
+		for( std::size_t i = aMesh.vertexStartIndex; i < endIndex; ++i )
+			soup.norm.emplace_back( aModel.normals[i] );
+
+		return soup;
+	}
+
+	void generate_lods_( IndexedMesh& aMesh, BakeOptions_ const& aOptions, IndexingStats_& aStats )
+	{
+		assert( 1 == aMesh.lods.size() );
+
+		auto const size = glm::length( aMesh.aabbMax - aMesh.aabbMin );
+		if( !(size > 0.f) )
+			return;
+
+		// Every level is simplified from the full detail mesh, rather than
+		// from the previous level. This keeps the quadrics (and thus the
+		// error estimates) relative to the original surface.
+		auto const lod0 = aMesh.indices;
+
+		for( std::size_t level = 1; level < kLodMaxLevels; ++level )
+		{
+			auto const prev = aMesh.lods.back();
+
+			auto const target = std::size_t(prev.indexCount * kLodIndexRatio) / 3 * 3;
+
+			float error = 0.f;
+			auto lod = simplify_mesh( aMesh, lod0, target, kLodMaxErrors[level] * size, &error );
+
+			if( lod.empty() || lod.size() > std::size_t(prev.indexCount * (1.f - kLodMinReduction)) )
+				break;
+
+			if( aOptions.optimizeVertexCache )
+				optimize_vertex_cache( lod, aMesh.vert.size(), kVertexCacheSize );
+
+			// Coarser levels must not report a smaller error, otherwise the
+			// screen-space selection could pick them closer up.
+			error = std::max( error, prev.error );
+
+			aMesh.lods.emplace_back( MeshLod{ std::uint32_t(aMesh.indices.size()), std::uint32_t(lod.size()), error } );
+			aMesh.indices.insert( aMesh.indices.end(), lod.begin(), lod.end() );
+
+			aStats.lodRelativeError[level] = error / size;
+		}
+	}
+
+	void benchmark_vicinity_( InputModel const& aModel, float aErrorTolerance )
+	{
+		// Runs sequentially, so that the numbers are not affected by other
+		// meshes being indexed at the same time.
+		VicinityBenchmark total{};
+		std::size_t mismatches = 0;
+
+		for( auto const& imesh : aModel.meshes )
+		{
+			auto const soup = make_triangle_soup_( aModel, imesh );
+			auto const bench = benchmark_vicinity( soup, aErrorTolerance );
+
+			total.mapBuildSeconds += bench.mapBuildSeconds;
+			total.mapCollapseSeconds += bench.mapCollapseSeconds;
+			total.gridBuildSeconds += bench.gridBuildSeconds;
+			total.gridCollapseSeconds += bench.gridCollapseSeconds;
+			total.mapVertices += bench.mapVertices;
+			total.gridVertices += bench.gridVertices;
+
+			if( bench.mapVertices != bench.gridVertices )
+				++mismatches;
+		}
+
+		auto const mapTotal = total.mapBuildSeconds + total.mapCollapseSeconds;
+		auto const gridTotal = total.gridBuildSeconds + total.gridCollapseSeconds;
+
+		std::printf( "Vicinity benchmark (%zu meshes):\n", aModel.meshes.size() );
+		std::printf( " - unordered_multimap: build %8.2f ms, collapse %8.2f ms, total %8.2f ms => %zu vertices\n", total.mapBuildSeconds*1e3, total.mapCollapseSeconds*1e3, mapTotal*1e3, total.mapVertices );
+		std::printf( " - sorted grid:        build %8.2f ms, collapse %8.2f ms, total %8.2f ms => %zu vertices\n", total.gridBuildSeconds*1e3, total.gridCollapseSeconds*1e3, gridTotal*1e3, total.gridVertices );
+		std::printf( " - speedup: %.2fx\n", gridTotal > 0. ? mapTotal / gridTotal : 0. );
+
+		if( mismatches )
+			std::fprintf( stderr, "Warning: %zu meshes produced a different number of vertices!\n", mismatches );
+	}
+
+	void benchmark_obj_parse_( char const* aInputOBJ, ObjLoadOptions const& aConfigured )
+	{
+		struct Case_
+		{
+			char const* name;
+			ObjLoadOptions config;
+		};
+
+		Case_ const cases[] = {
+			{ "on demand, 1x 128 kB", { ObjParseMode::stream, { 0, 1, 0 } } },
+			{ "background, 2x 128 kB", { ObjParseMode::stream, { 0, 2, 0 } } },
+			{ "background, 3x 128 kB", { ObjParseMode::stream, { 0, 3, 0 } } },
+			{ "background, 3x 1 MB", { ObjParseMode::stream, { 1024*1024, 3, 1024*1024 } } },
+			{ "temp file, parallel", { ObjParseMode::file, {} } },
+			{ "configured", aConfigured }
+		};
+
+		std::printf( "OBJ parse benchmark for %s (%u hardware threads):\n", aInputOBJ, std::thread::hardware_concurrency() );
+
+		for( auto const& bench : cases )
+		{
+			// Decompression alone. Also determines the size of the OBJ.
+			auto const drainStart = std::chrono::steady_clock::now();
+
+			std::uint64_t objBytes = 0;
+			{
+				ZStdIStream ins( aInputOBJ, bench.config.stream );
+
+				std::vector<char> sink( 1024*1024 );
+				while( ins.read( sink.data(), std::streamsize(sink.size()) ) || ins.gcount() > 0 )
+					objBytes += std::uint64_t(ins.gcount());
+			}
+
+			auto const drainTime = std::chrono::duration<double>( std::chrono::steady_clock::now() - drainStart ).count();
+
+			// Decompression + rapidobj::ParseStream(), or decompression to a
+			// file + rapidobj::ParseFile(). MB/s covers both steps.
+			ObjLoadTimings times;
+			load_compressed_wavefront_obj( aInputOBJ, &times, bench.config );
+
+			auto const total = times.decompress + times.parse;
+			auto const mb = objBytes / (1024.*1024.);
+			std::printf( " - %-22s decompress %7.1f MB/s, parse %6.1f MB/s (%.0f MB in %.2f s = %.2f s decompress + %.2f s parse)\n", bench.name, mb/drainTime, mb/total, mb, total, times.decompress, times.parse );
+		}
+	}
 }
 
 namespace
@@ -0,0 +1,184 @@
+#include "meshlets.hpp"
+
+#include <limits>
+#include <algorithm>
+
+#include <cmath>
+#include <cassert>
+
+#include <glm/glm.hpp>
+
+namespace
+{
+	// Tweakables
+	// Normal cones wider than this (min. dot product between the cone axis
+	// and a triangle normal) are not useful for culling.
+	constexpr float kMinConeSpread = 0.1f;
+
+	constexpr std::uint8_t kUnassigned_ = 0xff;
+
+	void compute_bounds_( Meshlet&, MeshletData const&, IndexedMesh const& );
+}
+
+//--    make_meshlets()                 ///{{{2///////////////////////////////
+MeshletData make_meshlets( IndexedMesh const& aMesh, std::size_t aMaxVertices, std::size_t aMaxTriangles )
+{
+	assert( 0 == aMesh.indices.size() % 3 );
+	assert( aMaxVertices >= 3 && aMaxVertices < kUnassigned_ );
+	assert( aMaxTriangles >= 1 );
+
+	MeshletData ret;
+
+	auto const triangleCount = aMesh.indices.size() / 3;
+	if( 0 == triangleCount )
+		return ret;
+
+	// Local index of each mesh vertex in the current meshlet
+	std::vector<std::uint8_t> local( aMesh.vert.size(), kUnassigned_ );
+
+	Meshlet current{};
+
+	auto const flush_ = [&] {
+		if( 0 == current.triangleCount )
+			return;
+
+		compute_bounds_( current, ret, aMesh );
+
+		for( std::size_t i = 0; i < current.vertexCount; ++i )
+			local[ret.vertices[current.vertexOffset+i]] = kUnassigned_;
+
+		ret.meshlets.emplace_back( current );
+
+		current = Meshlet{};
+		current.vertexOffset = std::uint32_t(ret.vertices.size());
+		current.triangleOffset = std::uint32_t(ret.triangles.size() / 3);
+	};
+
+	for( std::size_t t = 0; t < triangleCount; ++t )
+	{
+		std::uint32_t const* tri = aMesh.indices.data() + t*3;
+
+		std::size_t newVertices = 0;
+		for( std::size_t i = 0; i < 3; ++i )
+		{
+			if( kUnassigned_ == local[tri[i]] )
+				++newVertices;
+		}
+
+		// Duplicate indices within a triangle would be counted twice above;
+		// that only makes the check slightly conservative.
+		if( current.vertexCount + newVertices > aMaxVertices || current.triangleCount + 1 > aMaxTriangles )
+			flush_();
+
+		for( std::size_t i = 0; i < 3; ++i )
+		{
+			auto& idx = local[tri[i]];
+			if( kUnassigned_ == idx )
+			{
+				idx = std::uint8_t(current.vertexCount++);
+				ret.vertices.emplace_back( tri[i] );
+			}
+
+			ret.triangles.emplace_back( idx );
+		}
+
+		++current.triangleCount;
+	}
+
+	flush_();
+
+	return ret;
+}
+
+
+//--    $ local functions               ///{{{2///////////////////////////////
+namespace
+{
+	void compute_bounds_( Meshlet& aMeshlet, MeshletData const& aData, IndexedMesh const& aMesh )
+	{
+		auto const vertex_ = [&] (std::size_t aTri, std::size_t aCorner) -> glm::vec3 const& {
+			auto const local = aData.triangles[(aMeshlet.triangleOffset+aTri)*3 + aCorner];
+			return aMesh.vert[aData.vertices[aMeshlet.vertexOffset+local]];
+		};
+
+		// Bounding sphere: center of the AABB and the distance to the
+		// farthest vertex. Not minimal, but cheap and good enough for culling.
+		glm::vec3 bmin( std::numeric_limits<float>::max() );
+		glm::vec3 bmax( -std::numeric_limits<float>::max() );
+
+		for( std::size_t i = 0; i < aMeshlet.vertexCount; ++i )
+		{
+			auto const& p = aMesh.vert[aData.vertices[aMeshlet.vertexOffset+i]];
+			bmin = glm::min( bmin, p );
+			bmax = glm::max( bmax, p );
+		}
+
+		aMeshlet.center = (bmin + bmax) * .5f;
+
+		float radius2 = 0.f;
+		for( std::size_t i = 0; i < aMeshlet.vertexCount; ++i )
+		{
+			auto const d = aMesh.vert[aData.vertices[aMeshlet.vertexOffset+i]] - aMeshlet.center;
+			radius2 = std::max( radius2, glm::dot( d, d ) );
+		}
+
+		aMeshlet.radius = std::sqrt( radius2 );
+
+		// Normal cone. Axis is the average of the (unit) triangle normals.
+		std::vector<glm::vec3> normals( aMeshlet.triangleCount );
+
+		glm::vec3 axis( 0.f );
+		for( std::size_t t = 0; t < aMeshlet.triangleCount; ++t )
+		{
+			auto const n = glm::cross( vertex_( t, 1 ) - vertex_( t, 0 ), vertex_( t, 2 ) - vertex_( t, 0 ) );
+			auto const len = glm::length( n );
+
+			normals[t] = len > 0.f ? n / len : glm::vec3( 0.f );
+			axis += normals[t];
+		}
+
+		auto const axisLength = glm::length( axis );
+
+		aMeshlet.coneApex = aMeshlet.center;
+		aMeshlet.coneAxis = glm::vec3( 0.f );
+		aMeshlet.coneCutoff = 1.f;
+
+		if( 0.f == axisLength )
+			return;
+
+		axis /= axisLength;
+
+		float minDot = 1.f;
+		for( auto const& n : normals )
+		{
+			if( glm::vec3( 0.f ) != n )
+				minDot = std::min( minDot, glm::dot( n, axis ) );
+		}
+
+		if( minDot <= kMinConeSpread )
+			return;
+
+		// Move the apex back along the axis until it is behind all triangle
+		// planes, i.e., dot(apex - p0, n) <= 0 for every triangle.
+		float maxT = 0.f;
+		for( std::size_t t = 0; t < aMeshlet.triangleCount; ++t )
+		{
+			auto const dn = glm::dot( axis, normals[t] );
+			if( dn <= 0.f )
+				continue;
+
+			auto const dc = glm::dot( aMeshlet.center - vertex_( t, 0 ), normals[t] );
+			maxT = std::max( maxT, dc / dn );
+		}
+
+		aMeshlet.coneApex = aMeshlet.center - axis * maxT;
+		aMeshlet.coneAxis = axis;
+
+		// The normal cone has half-angle a with cos(a) = minDot. Viewing
+		// directions from which all triangles are back-facing form the cone
+		// widened by 90 degrees and flipped, i.e., -cos(a+90) = sin(a).
+		aMeshlet.coneCutoff = std::sqrt( 1.f - minDot*minDot );
+	}
+}
+
+//--///}}}1/////////////// vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,59 @@
+#ifndef MESHLETS_HPP_1CA27497_6FB4_4C2F_B844_DECA134ED046
+#define MESHLETS_HPP_1CA27497_6FB4_4C2F_B844_DECA134ED046
+
+//--//////////////////////////////////////////////////////////////////////////
+//--    include                                 ///{{{1///////////////////////
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/vec3.hpp>
+
+#include "index_mesh.hpp"
+
+//--    types                                   ///{{{1///////////////////////
+struct Meshlet
+{
+	// Range in MeshletData::vertices
+	std::uint32_t vertexOffset;
+	std::uint32_t vertexCount;
+
+	// Range in MeshletData::triangles (in triangles, i.e., 3 entries each).
+	// Meshlets are built from consecutive triangles, so this is also the
+	// range of triangles in the mesh's index buffer.
+	std::uint32_t triangleOffset;
+	std::uint32_t triangleCount;
+
+	// Bounding sphere
+	glm::vec3 center;
+	float radius;
+
+	// Normal cone. The meshlet is back-facing from viewpoint V if
+	//   dot( normalize(coneApex - V), coneAxis ) >= coneCutoff
+	// coneCutoff is set to 1 (never culled) if the normals are too spread out.
+	glm::vec3 coneApex;
+	glm::vec3 coneAxis;
+	float coneCutoff;
+};
+
+struct MeshletData
+{
+	std::vector<Meshlet> meshlets;
+	std::vector<std::uint32_t> vertices; // index into mesh vertices
+	std::vector<std::uint8_t> triangles; // index into meshlet's vertices
+};
+
+//--    functions                               ///{{{1///////////////////////
+
+// Split a mesh into meshlets with at most aMaxVertices vertices and
+// aMaxTriangles triangles. Triangles are consumed in index buffer order, so
+// this should run after optimize_vertex_cache() (and optimize_overdraw()).
+MeshletData make_meshlets(
+	IndexedMesh const&,
+	std::size_t aMaxVertices = 64,
+	std::size_t aMaxTriangles = 124
+);
+
+#endif // MESHLETS_HPP_1CA27497_6FB4_4C2F_B844_DECA134ED046
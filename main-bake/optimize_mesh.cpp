@@ -0,0 +1,481 @@
+#include "optimize_mesh.hpp"
+
+#include <limits>
+#include <utility>
+#include <algorithm>
+
+#include <cassert>
+
+#include <glm/glm.hpp>
+
+#include "../utils/error.hpp"
+namespace lut = labutils;
+
+namespace
+{
+	constexpr std::uint32_t kInvalid_ = ~std::uint32_t(0);
+
+	// Triangle adjacency: for each vertex, the list of triangles that use it.
+	// Stored in a compressed form (offsets + flat triangle list).
+	struct Adjacency_
+	{
+		std::vector<std::uint32_t> offsets; // vertex count + 1
+		std::vector<std::uint32_t> triangles;
+	};
+
+	Adjacency_ build_adjacency_( std::vector<std::uint32_t> const&, std::size_t aVertexCount );
+
+	template< typename tVector >
+	void permute_( tVector&, std::vector<std::uint32_t> const& aNewToOld );
+
+	// FIFO cache simulation, triangle by triangle
+	struct FifoCache_
+	{
+		FifoCache_( std::size_t aVertexCount, std::size_t aCacheSize );
+
+		std::size_t add_triangle( std::uint32_t const* aTri ); // returns misses
+		void reset();
+
+		std::vector<std::size_t> insertedAt;
+		std::size_t time;
+		std::size_t size;
+	};
+
+	// Cluster boundaries: a cluster starts at each triangle where all three
+	// vertices miss the cache (i.e., where Tipsify could not continue
+	// locally)
+	std::vector<std::size_t> hard_boundaries_( std::vector<std::uint32_t> const&, std::size_t aVertexCount, std::size_t aCacheSize );
+
+	// Split hard clusters further, as long as each part stays within the
+	// ACMR threshold
+	std::vector<std::size_t> soft_boundaries_( std::vector<std::uint32_t> const&, std::size_t aVertexCount, std::vector<std::size_t> const& aHard, std::size_t aCacheSize, float aThreshold );
+}
+
+//--    VertexCacheStats                ///{{{2///////////////////////////////
+double VertexCacheStats::acmr() const
+{
+	return triangles ? double(misses) / triangles : 0.;
+}
+double VertexCacheStats::atvr() const
+{
+	return vertices ? double(misses) / vertices : 0.;
+}
+
+VertexCacheStats& VertexCacheStats::operator+= ( VertexCacheStats const& aOther )
+{
+	triangles += aOther.triangles;
+	vertices += aOther.vertices;
+	misses += aOther.misses;
+	return *this;
+}
+
+//--    analyze_vertex_cache()          ///{{{2///////////////////////////////
+VertexCacheStats analyze_vertex_cache( std::vector<std::uint32_t> const& aIndices, std::size_t aVertexCount, std::size_t aCacheSize )
+{
+	assert( aCacheSize > 0 );
+
+	VertexCacheStats ret;
+	ret.triangles = aIndices.size() / 3;
+	ret.vertices = aVertexCount;
+
+	// FIFO cache: a vertex is in the cache if it was inserted less than
+	// aCacheSize insertions ago. Track the insertion "time" per vertex.
+	std::vector<std::size_t> insertedAt( aVertexCount, std::numeric_limits<std::size_t>::max() );
+	std::size_t time = 0;
+
+	for( auto const idx : aIndices )
+	{
+		assert( idx < aVertexCount );
+
+		auto const at = insertedAt[idx];
+		if( std::numeric_limits<std::size_t>::max() == at || time - at >= aCacheSize )
+		{
+			insertedAt[idx] = time++;
+			++ret.misses;
+		}
+	}
+
+	return ret;
+}
+
+//--    optimize_vertex_cache()         ///{{{2///////////////////////////////
+void optimize_vertex_cache( std::vector<std::uint32_t>& aIndices, std::size_t aVertexCount, std::size_t aCacheSize )
+{
+	assert( 0 == aIndices.size() % 3 );
+
+	auto const triangleCount = aIndices.size() / 3;
+	if( 0 == triangleCount )
+		return;
+
+	auto const adjacency = build_adjacency_( aIndices, aVertexCount );
+
+	// Live triangle count per vertex
+	std::vector<std::uint32_t> live( aVertexCount );
+	for( std::size_t v = 0; v < aVertexCount; ++v )
+		live[v] = adjacency.offsets[v+1] - adjacency.offsets[v];
+
+	// Cache time stamps per vertex
+	std::vector<std::size_t> cacheTime( aVertexCount, 0 );
+
+	std::vector<std::uint32_t> deadEnd;
+	std::vector<char> emitted( triangleCount, 0 );
+
+	std::vector<std::uint32_t> candidates;
+
+	std::vector<std::uint32_t> result;
+	result.reserve( aIndices.size() );
+
+	std::size_t time = aCacheSize+1;
+	std::size_t cursor = 1;
+	std::uint32_t fanning = 0;
+
+	auto const skip_dead_end_ = [&] () -> std::uint32_t {
+		// Recently used vertices with live triangles first
+		while( !deadEnd.empty() )
+		{
+			auto const v = deadEnd.back();
+			deadEnd.pop_back();
+
+			if( live[v] > 0 )
+				return v;
+		}
+
+		// Otherwise the next vertex in input order with live triangles
+		for( ; cursor < aVertexCount; ++cursor )
+		{
+			if( live[cursor] > 0 )
+				return std::uint32_t(cursor);
+		}
+
+		return kInvalid_;
+	};
+
+	while( kInvalid_ != fanning )
+	{
+		candidates.clear();
+
+		// Emit all remaining triangles around the fanning vertex
+		for( auto i = adjacency.offsets[fanning]; i < adjacency.offsets[fanning+1]; ++i )
+		{
+			auto const tri = adjacency.triangles[i];
+			if( emitted[tri] )
+				continue;
+
+			for( std::size_t j = 0; j < 3; ++j )
+			{
+				auto const v = aIndices[tri*3+j];
+
+				result.emplace_back( v );
+				deadEnd.emplace_back( v );
+				candidates.emplace_back( v );
+
+				--live[v];
+
+				if( time - cacheTime[v] > aCacheSize )
+					cacheTime[v] = time++;
+			}
+
+			emitted[tri] = 1;
+		}
+
+		// Pick next fanning vertex: prefer the vertex that will still be in
+		// the cache after emitting its remaining triangles, and among those
+		// the one that has been in the cache the longest.
+		std::uint32_t next = kInvalid_;
+		std::ptrdiff_t best = -1;
+
+		for( auto const v : candidates )
+		{
+			if( 0 == live[v] )
+				continue;
+
+			std::ptrdiff_t priority = 0;
+			if( time - cacheTime[v] + 2*live[v] <= aCacheSize )
+				priority = std::ptrdiff_t(time - cacheTime[v]);
+
+			if( priority > best )
+			{
+				best = priority;
+				next = v;
+			}
+		}
+
+		if( kInvalid_ == next )
+			next = skip_dead_end_();
+
+		fanning = next;
+	}
+
+	assert( result.size() == aIndices.size() );
+	aIndices = std::move(result);
+}
+
+//--    optimize_overdraw()             ///{{{2///////////////////////////////
+void optimize_overdraw( std::vector<std::uint32_t>& aIndices, std::vector<glm::vec3> const& aPositions, std::size_t aCacheSize, float aThreshold )
+{
+	assert( 0 == aIndices.size() % 3 );
+
+	auto const triangleCount = aIndices.size() / 3;
+	if( 0 == triangleCount )
+		return;
+
+	auto const hard = hard_boundaries_( aIndices, aPositions.size(), aCacheSize );
+	auto const clusters = soft_boundaries_( aIndices, aPositions.size(), hard, aCacheSize, aThreshold );
+
+	// Nothing to reorder
+	if( clusters.size() <= 1 )
+		return;
+
+	// Area-weighted centroid of the mesh and of each cluster, as well as
+	// each cluster's average normal.
+	struct Cluster_
+	{
+		std::size_t begin, end; // in triangles
+		glm::vec3 centroid;
+		glm::vec3 normal;
+		float sortKey;
+	};
+
+	std::vector<Cluster_> info( clusters.size() );
+
+	glm::vec3 meshCentroid( 0.f );
+	float meshArea = 0.f;
+
+	for( std::size_t c = 0; c < clusters.size(); ++c )
+	{
+		auto& cluster = info[c];
+		cluster.begin = clusters[c];
+		cluster.end = c+1 < clusters.size() ? clusters[c+1] : triangleCount;
+
+		glm::vec3 centroid( 0.f ), normal( 0.f );
+		float area = 0.f;
+
+		for( std::size_t t = cluster.begin; t < cluster.end; ++t )
+		{
+			auto const& p0 = aPositions[aIndices[t*3+0]];
+			auto const& p1 = aPositions[aIndices[t*3+1]];
+			auto const& p2 = aPositions[aIndices[t*3+2]];
+
+			// |cross| = 2x triangle area; the factor cancels out
+			auto const n = glm::cross( p1-p0, p2-p0 );
+			auto const a = glm::length( n );
+
+			centroid += (p0+p1+p2) * (a / 3.f);
+			normal += n;
+			area += a;
+		}
+
+		meshCentroid += centroid;
+		meshArea += area;
+
+		cluster.centroid = area > 0.f ? centroid / area : aPositions[aIndices[cluster.begin*3]];
+
+		auto const len = glm::length( normal );
+		cluster.normal = len > 0.f ? normal / len : glm::vec3( 0.f );
+	}
+
+	if( meshArea > 0.f )
+		meshCentroid /= meshArea;
+
+	// Clusters that face away from the center are likely to occlude other
+	// parts of the mesh, so draw them first.
+	for( auto& cluster : info )
+		cluster.sortKey = glm::dot( cluster.centroid - meshCentroid, cluster.normal );
+
+	std::stable_sort( info.begin(), info.end(), [] (Cluster_ const& aA, Cluster_ const& aB) {
+		return aA.sortKey > aB.sortKey;
+	} );
+
+	std::vector<std::uint32_t> result;
+	result.reserve( aIndices.size() );
+
+	for( auto const& cluster : info )
+		result.insert( result.end(), aIndices.begin() + cluster.begin*3, aIndices.begin() + cluster.end*3 );
+
+	if( result.size() != aIndices.size() )
+		throw lut::Error( "optimize_overdraw(): clusters cover %zu of %zu indices", result.size(), aIndices.size() );
+
+	aIndices = std::move(result);
+}
+
+//--    optimize_vertex_fetch()         ///{{{2///////////////////////////////
+void optimize_vertex_fetch( IndexedMesh& aMesh )
+{
+	auto const vertexCount = aMesh.vert.size();
+
+	std::vector<std::uint32_t> oldToNew( vertexCount, kInvalid_ );
+	std::vector<std::uint32_t> newToOld;
+	newToOld.reserve( vertexCount );
+
+	for( auto& idx : aMesh.indices )
+	{
+		assert( idx < vertexCount );
+
+		if( kInvalid_ == oldToNew[idx] )
+		{
+			oldToNew[idx] = std::uint32_t(newToOld.size());
+			newToOld.emplace_back( idx );
+		}
+
+		idx = oldToNew[idx];
+	}
+
+	// Keep unreferenced vertices (if any) at the end
+	for( std::size_t v = 0; v < vertexCount; ++v )
+	{
+		if( kInvalid_ == oldToNew[v] )
+		{
+			oldToNew[v] = std::uint32_t(newToOld.size());
+			newToOld.emplace_back( std::uint32_t(v) );
+		}
+	}
+
+	permute_( aMesh.vert, newToOld );
+	permute_( aMesh.norm, newToOld );
+	permute_( aMesh.text, newToOld );
+	permute_( aMesh.tangent, newToOld );
+	permute_( aMesh.tangentComp, newToOld );
+}
+
+
+//--    $ local functions               ///{{{2///////////////////////////////
+namespace
+{
+	Adjacency_ build_adjacency_( std::vector<std::uint32_t> const& aIndices, std::size_t aVertexCount )
+	{
+		Adjacency_ ret;
+
+		// Count triangles per vertex, then prefix sum into offsets
+		ret.offsets.assign( aVertexCount+1, 0 );
+		for( auto const idx : aIndices )
+		{
+			assert( idx < aVertexCount );
+			++ret.offsets[idx+1];
+		}
+
+		for( std::size_t v = 0; v < aVertexCount; ++v )
+			ret.offsets[v+1] += ret.offsets[v];
+
+		// Scatter triangles
+		std::vector<std::uint32_t> fill( ret.offsets.begin(), ret.offsets.end()-1 );
+
+		ret.triangles.resize( aIndices.size() );
+		for( std::size_t i = 0; i < aIndices.size(); ++i )
+			ret.triangles[fill[aIndices[i]]++] = std::uint32_t(i / 3);
+
+		return ret;
+	}
+
+	FifoCache_::FifoCache_( std::size_t aVertexCount, std::size_t aCacheSize )
+		: insertedAt( aVertexCount )
+		, size( aCacheSize )
+	{
+		reset();
+	}
+
+	std::size_t FifoCache_::add_triangle( std::uint32_t const* aTri )
+	{
+		std::size_t misses = 0;
+		for( std::size_t i = 0; i < 3; ++i )
+		{
+			auto const at = insertedAt[aTri[i]];
+			if( std::numeric_limits<std::size_t>::max() == at || time - at >= size )
+			{
+				insertedAt[aTri[i]] = time++;
+				++misses;
+			}
+		}
+
+		return misses;
+	}
+
+	void FifoCache_::reset()
+	{
+		std::fill( insertedAt.begin(), insertedAt.end(), std::numeric_limits<std::size_t>::max() );
+		time = 0;
+	}
+
+	std::vector<std::size_t> hard_boundaries_( std::vector<std::uint32_t> const& aIndices, std::size_t aVertexCount, std::size_t aCacheSize )
+	{
+		// The first cluster always starts at triangle 0. A degenerate first
+		// triangle (e.g., 0,0,1) misses fewer than three times, so it does
+		// not necessarily start one by itself.
+		std::vector<std::size_t> ret{ 0 };
+
+		FifoCache_ cache( aVertexCount, aCacheSize );
+
+		auto const triangleCount = aIndices.size() / 3;
+		for( std::size_t t = 0; t < triangleCount; ++t )
+		{
+			if( 3 == cache.add_triangle( aIndices.data() + t*3 ) && 0 != t )
+				ret.emplace_back( t );
+		}
+
+		return ret;
+	}
+
+	std::vector<std::size_t> soft_boundaries_( std::vector<std::uint32_t> const& aIndices, std::size_t aVertexCount, std::vector<std::size_t> const& aHard, std::size_t aCacheSize, float aThreshold )
+	{
+		std::vector<std::size_t> ret;
+
+		FifoCache_ cache( aVertexCount, aCacheSize );
+
+		auto const triangleCount = aIndices.size() / 3;
+		for( std::size_t h = 0; h < aHard.size(); ++h )
+		{
+			auto const begin = aHard[h];
+			auto const end = h+1 < aHard.size() ? aHard[h+1] : triangleCount;
+
+			// ACMR of the complete hard cluster
+			cache.reset();
+
+			std::size_t clusterMisses = 0;
+			for( std::size_t t = begin; t < end; ++t )
+				clusterMisses += cache.add_triangle( aIndices.data() + t*3 );
+
+			float const threshold = aThreshold * float(clusterMisses) / float(end-begin);
+
+			// Split where the ACMR of the part so far drops below the
+			// threshold
+			ret.emplace_back( begin );
+
+			cache.reset();
+
+			std::size_t start = begin, misses = 0;
+			for( std::size_t t = begin; t < end; ++t )
+			{
+				misses += cache.add_triangle( aIndices.data() + t*3 );
+
+				float const acmr = float(misses) / float(t-start+1);
+				if( t+1 < end && acmr <= threshold )
+				{
+					ret.emplace_back( t+1 );
+
+					cache.reset();
+					start = t+1;
+					misses = 0;
+				}
+			}
+		}
+
+		return ret;
+	}
+
+	template< typename tVector >
+	void permute_( tVector& aData, std::vector<std::uint32_t> const& aNewToOld )
+	{
+		// Some attributes are optional (e.g., normals)
+		if( aData.empty() )
+			return;
+
+		assert( aData.size() == aNewToOld.size() );
+
+		tVector result( aData.size() );
+		for( std::size_t i = 0; i < aNewToOld.size(); ++i )
+			result[i] = aData[aNewToOld[i]];
+
+		aData = std::move(result);
+	}
+}
+
+//--///}}}1/////////////// vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
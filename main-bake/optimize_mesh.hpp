@@ -0,0 +1,68 @@
+#ifndef OPTIMIZE_MESH_HPP_C42AACCF_C188_463E_B4B1_3345401DCE55
+#define OPTIMIZE_MESH_HPP_C42AACCF_C188_463E_B4B1_3345401DCE55
+
+//--//////////////////////////////////////////////////////////////////////////
+//--    include                                 ///{{{1///////////////////////
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/vec3.hpp>
+
+#include "index_mesh.hpp"
+
+//--    types                                   ///{{{1///////////////////////
+struct VertexCacheStats
+{
+	std::size_t triangles = 0;
+	std::size_t vertices = 0;
+	std::size_t misses = 0; // post-transform cache misses
+
+	// Average cache miss ratio: misses per triangle. Ranges from 0.5 (best
+	// case for large regular meshes) to 3.0 (no reuse at all).
+	double acmr() const;
+
+	// Average transform to vertex ratio: misses per vertex. 1.0 is ideal.
+	double atvr() const;
+
+	VertexCacheStats& operator+= ( VertexCacheStats const& );
+};
+
+//--    functions                               ///{{{1///////////////////////
+
+// Simulate a FIFO post-transform vertex cache with aCacheSize entries.
+VertexCacheStats analyze_vertex_cache(
+	std::vector<std::uint32_t> const& aIndices,
+	std::size_t aVertexCount,
+	std::size_t aCacheSize
+);
+
+// Reorder triangles for post-transform vertex cache locality. Uses Tipsify
+// (Sander, Nehab & Barczak, "Fast Triangle Reordering for Vertex Locality and
+// Reduced Overdraw", SIGGRAPH 2007).
+void optimize_vertex_cache(
+	std::vector<std::uint32_t>& aIndices,
+	std::size_t aVertexCount,
+	std::size_t aCacheSize
+);
+
+// Reorder triangle clusters to reduce overdraw. Run this after
+// optimize_vertex_cache(). The index buffer is split into clusters such that
+// the ACMR within each cluster stays below aThreshold times the ACMR of the
+// input order (e.g., 1.05 allows a 5% increase). Clusters are then sorted
+// by how much they face away from the mesh center, which approximates a
+// front-to-back order for typical outside-in viewpoints (Sander et al. 2007).
+void optimize_overdraw(
+	std::vector<std::uint32_t>& aIndices,
+	std::vector<glm::vec3> const& aPositions,
+	std::size_t aCacheSize,
+	float aThreshold
+);
+
+// Reorder vertices by their first use in the index buffer, to improve
+// locality of vertex fetches. Permutes all per-vertex attributes of the mesh.
+void optimize_vertex_fetch( IndexedMesh& );
+
+#endif // OPTIMIZE_MESH_HPP_C42AACCF_C188_463E_B4B1_3345401DCE55
@@ -0,0 +1,372 @@
+#include "simplify_mesh.hpp"
+
+#include <limits>
+#include <utility>
+#include <algorithm>
+
+#include <cmath>
+#include <cassert>
+
+#include <glm/glm.hpp>
+
+namespace
+{
+	// Symmetric 4x4 quadric, stored as the 3x3 matrix A, vector b and scalar
+	// c, such that the error of a position p is p'Ap + 2b'p + c. Quadrics are
+	// area weighted; dividing by the accumulated weight gives the mean
+	// squared distance to the accumulated planes.
+	struct Quadric_
+	{
+		double a00, a01, a02, a11, a12, a22;
+		double b0, b1, b2;
+		double c;
+		double weight;
+
+		Quadric_& operator+= ( Quadric_ const& );
+
+		double error( glm::vec3 const& ) const;
+	};
+
+	Quadric_ plane_quadric_( glm::vec3 const& aP0, glm::vec3 const& aP1, glm::vec3 const& aP2 );
+
+	struct Collapse_
+	{
+		std::uint32_t from, to;
+		float cost;
+	};
+
+	// Triangle adjacency, same layout as in optimize_mesh.cpp
+	struct Adjacency_
+	{
+		std::vector<std::uint32_t> offsets; // vertex count + 1
+		std::vector<std::uint32_t> triangles;
+	};
+
+	Adjacency_ build_adjacency_( std::vector<std::uint32_t> const&, std::size_t aVertexCount );
+
+	// Map each vertex to the first vertex with the exact same position.
+	std::vector<std::uint32_t> position_remap_( std::vector<glm::vec3> const& );
+
+	// Vertices that must not be moved: seams and open (or non-manifold)
+	// borders.
+	std::vector<char> locked_vertices_( std::vector<std::uint32_t> const&, std::vector<std::uint32_t> const& aPositionRemap );
+
+	bool flips_( std::vector<std::uint32_t> const&, Adjacency_ const&, std::vector<glm::vec3> const&, Collapse_ const& );
+}
+
+//--    simplify_mesh()                 ///{{{2///////////////////////////////
+std::vector<std::uint32_t> simplify_mesh( IndexedMesh const& aMesh, std::vector<std::uint32_t> const& aIndices, std::size_t aTargetIndexCount, float aTargetError, float* aResultError )
+{
+	assert( 0 == aIndices.size() % 3 );
+
+	auto const vertexCount = aMesh.vert.size();
+	auto const& positions = aMesh.vert;
+
+	std::vector<std::uint32_t> indices( aIndices );
+
+	float resultCost = 0.f;
+	auto const maxCost = aTargetError * aTargetError;
+
+	auto const remap = position_remap_( positions );
+	auto const locked = locked_vertices_( indices, remap );
+
+	// Initial quadrics. These are accumulated per position, so that all
+	// vertices of a seam see the full neighbourhood.
+	std::vector<Quadric_> quadrics( vertexCount, Quadric_{} );
+	for( std::size_t i = 0; i < indices.size(); i += 3 )
+	{
+		auto const q = plane_quadric_( positions[indices[i+0]], positions[indices[i+1]], positions[indices[i+2]] );
+
+		for( std::size_t j = 0; j < 3; ++j )
+			quadrics[remap[indices[i+j]]] += q;
+	}
+
+	std::vector<Collapse_> collapses;
+	std::vector<char> touched( vertexCount );
+	std::vector<std::uint32_t> collapseTo( vertexCount );
+
+	// Each pass performs a set of independent collapses, cheapest first.
+	// Vertices around a collapse are not touched again during the same pass,
+	// so that the flip tests in each pass see up-to-date geometry.
+	while( indices.size() > aTargetIndexCount )
+	{
+		auto const adjacency = build_adjacency_( indices, vertexCount );
+
+		collapses.clear();
+		for( std::size_t i = 0; i < indices.size(); i += 3 )
+		{
+			for( std::size_t j = 0; j < 3; ++j )
+			{
+				auto const from = indices[i+j];
+				auto const to = indices[i+(j+1)%3];
+
+				if( locked[from] )
+					continue;
+
+				auto q = quadrics[from];
+				q += quadrics[remap[to]];
+
+				collapses.emplace_back( Collapse_{ from, to, float(q.error( positions[to] )) } );
+			}
+		}
+
+		if( collapses.empty() )
+			break;
+
+		std::sort( collapses.begin(), collapses.end(), [] (Collapse_ const& aA, Collapse_ const& aB) {
+			return aA.cost < aB.cost;
+		} );
+
+		// Each collapse removes about two triangles. Don't overshoot the
+		// target by much within one pass.
+		auto const budget = std::max( std::size_t(1), (indices.size() - aTargetIndexCount) / 6 );
+
+		std::fill( touched.begin(), touched.end(), 0 );
+		for( std::size_t v = 0; v < vertexCount; ++v )
+			collapseTo[v] = std::uint32_t(v);
+
+		std::size_t performed = 0;
+		for( auto const& col : collapses )
+		{
+			if( performed >= budget || col.cost > maxCost )
+				break;
+
+			if( touched[col.from] || touched[col.to] )
+				continue;
+
+			if( flips_( indices, adjacency, positions, col ) )
+				continue;
+
+			collapseTo[col.from] = col.to;
+			quadrics[remap[col.to]] += quadrics[col.from];
+
+			touched[col.from] = touched[col.to] = 1;
+			for( auto t = adjacency.offsets[col.from]; t < adjacency.offsets[col.from+1]; ++t )
+			{
+				auto const tri = adjacency.triangles[t];
+				for( std::size_t j = 0; j < 3; ++j )
+					touched[indices[tri*3+j]] = 1;
+			}
+
+			resultCost = std::max( resultCost, col.cost );
+			++performed;
+		}
+
+		if( 0 == performed )
+			break;
+
+		// Apply collapses and drop triangles that became degenerate
+		std::size_t out = 0;
+		for( std::size_t i = 0; i < indices.size(); i += 3 )
+		{
+			auto const a = collapseTo[indices[i+0]];
+			auto const b = collapseTo[indices[i+1]];
+			auto const c = collapseTo[indices[i+2]];
+
+			if( a == b || b == c || c == a )
+				continue;
+
+			indices[out++] = a;
+			indices[out++] = b;
+			indices[out++] = c;
+		}
+
+		indices.resize( out );
+	}
+
+	if( aResultError )
+		*aResultError = std::sqrt( resultCost );
+
+	return indices;
+}
+
+
+//--    $ local functions               ///{{{2///////////////////////////////
+namespace
+{
+	Quadric_& Quadric_::operator+= ( Quadric_ const& aOther )
+	{
+		a00 += aOther.a00; a01 += aOther.a01; a02 += aOther.a02;
+		a11 += aOther.a11; a12 += aOther.a12;
+		a22 += aOther.a22;
+		b0 += aOther.b0; b1 += aOther.b1; b2 += aOther.b2;
+		c += aOther.c;
+		weight += aOther.weight;
+		return *this;
+	}
+
+	double Quadric_::error( glm::vec3 const& aP ) const
+	{
+		if( 0. == weight )
+			return 0.;
+
+		double const x = aP.x, y = aP.y, z = aP.z;
+
+		double const e = a00*x*x + a11*y*y + a22*z*z
+			+ 2.*(a01*x*y + a02*x*z + a12*y*z)
+			+ 2.*(b0*x + b1*y + b2*z)
+			+ c
+		;
+
+		return std::max( 0., e / weight );
+	}
+
+	Quadric_ plane_quadric_( glm::vec3 const& aP0, glm::vec3 const& aP1, glm::vec3 const& aP2 )
+	{
+		auto const n = glm::cross( aP1 - aP0, aP2 - aP0 );
+		auto const len = glm::length( n );
+
+		if( 0.f == len )
+			return Quadric_{};
+
+		auto const nn = n / len;
+		double const a = nn.x, b = nn.y, c = nn.z;
+		double const d = -glm::dot( nn, aP0 );
+		double const w = .5 * len; // triangle area
+
+		Quadric_ ret;
+		ret.a00 = w*a*a; ret.a01 = w*a*b; ret.a02 = w*a*c;
+		ret.a11 = w*b*b; ret.a12 = w*b*c;
+		ret.a22 = w*c*c;
+		ret.b0 = w*a*d; ret.b1 = w*b*d; ret.b2 = w*c*d;
+		ret.c = w*d*d;
+		ret.weight = w;
+		return ret;
+	}
+
+	Adjacency_ build_adjacency_( std::vector<std::uint32_t> const& aIndices, std::size_t aVertexCount )
+	{
+		Adjacency_ ret;
+		ret.offsets.assign( aVertexCount+1, 0 );
+
+		for( auto const idx : aIndices )
+			++ret.offsets[idx+1];
+
+		for( std::size_t v = 0; v < aVertexCount; ++v )
+			ret.offsets[v+1] += ret.offsets[v];
+
+		std::vector<std::uint32_t> fill( ret.offsets.begin(), ret.offsets.end()-1 );
+
+		ret.triangles.resize( aIndices.size() );
+		for( std::size_t i = 0; i < aIndices.size(); ++i )
+			ret.triangles[fill[aIndices[i]]++] = std::uint32_t(i / 3);
+
+		return ret;
+	}
+
+	std::vector<std::uint32_t> position_remap_( std::vector<glm::vec3> const& aPositions )
+	{
+		std::vector<std::uint32_t> order( aPositions.size() );
+		for( std::size_t i = 0; i < order.size(); ++i )
+			order[i] = std::uint32_t(i);
+
+		auto const less_ = [&] (std::uint32_t aI, std::uint32_t aJ) {
+			auto const& a = aPositions[aI];
+			auto const& b = aPositions[aJ];
+			if( a.x != b.x ) return a.x < b.x;
+			if( a.y != b.y ) return a.y < b.y;
+			if( a.z != b.z ) return a.z < b.z;
+			return aI < aJ;
+		};
+		std::sort( order.begin(), order.end(), less_ );
+
+		std::vector<std::uint32_t> ret( aPositions.size() );
+		for( std::size_t i = 0; i < order.size(); ++i )
+		{
+			if( i > 0 && aPositions[order[i]] == aPositions[order[i-1]] )
+				ret[order[i]] = ret[order[i-1]];
+			else
+				ret[order[i]] = order[i];
+		}
+
+		return ret;
+	}
+
+	std::vector<char> locked_vertices_( std::vector<std::uint32_t> const& aIndices, std::vector<std::uint32_t> const& aPositionRemap )
+	{
+		auto const vertexCount = aPositionRemap.size();
+
+		std::vector<char> ret( vertexCount, 0 );
+
+		// Seams
+		for( std::size_t v = 0; v < vertexCount; ++v )
+		{
+			auto const r = aPositionRemap[v];
+			if( r != v )
+				ret[r] = ret[v] = 1;
+		}
+
+		// Borders: edges (by position) that are not used exactly twice
+		std::vector<std::uint64_t> edges;
+		edges.reserve( aIndices.size() );
+
+		for( std::size_t i = 0; i < aIndices.size(); i += 3 )
+		{
+			for( std::size_t j = 0; j < 3; ++j )
+			{
+				auto a = aPositionRemap[aIndices[i+j]];
+				auto b = aPositionRemap[aIndices[i+(j+1)%3]];
+				if( a > b )
+					std::swap( a, b );
+
+				edges.emplace_back( std::uint64_t(a) << 32 | b );
+			}
+		}
+
+		std::sort( edges.begin(), edges.end() );
+
+		for( std::size_t i = 0; i < edges.size(); )
+		{
+			std::size_t j = i+1;
+			while( j < edges.size() && edges[j] == edges[i] )
+				++j;
+
+			if( 2 != j-i )
+			{
+				// Mark all vertices at these positions; seams are already
+				// locked, so marking the representative is sufficient.
+				ret[std::uint32_t(edges[i] >> 32)] = 1;
+				ret[std::uint32_t(edges[i])] = 1;
+			}
+
+			i = j;
+		}
+
+		return ret;
+	}
+
+	bool flips_( std::vector<std::uint32_t> const& aIndices, Adjacency_ const& aAdjacency, std::vector<glm::vec3> const& aPositions, Collapse_ const& aCollapse )
+	{
+		auto const& target = aPositions[aCollapse.to];
+
+		for( auto t = aAdjacency.offsets[aCollapse.from]; t < aAdjacency.offsets[aCollapse.from+1]; ++t )
+		{
+			std::uint32_t const* tri = aIndices.data() + aAdjacency.triangles[t]*3;
+
+			// Triangles along the collapsed edge disappear
+			if( tri[0] == aCollapse.to || tri[1] == aCollapse.to || tri[2] == aCollapse.to )
+				continue;
+
+			glm::vec3 const p[3] = { aPositions[tri[0]], aPositions[tri[1]], aPositions[tri[2]] };
+			glm::vec3 q[3] = { p[0], p[1], p[2] };
+
+			for( std::size_t j = 0; j < 3; ++j )
+			{
+				if( tri[j] == aCollapse.from )
+					q[j] = target;
+			}
+
+			auto const n0 = glm::cross( p[1] - p[0], p[2] - p[0] );
+			auto const n1 = glm::cross( q[1] - q[0], q[2] - q[0] );
+
+			// Reject flipped and degenerate results. The latter also catches
+			// a vertex being moved onto a seam copy of another corner.
+			if( glm::dot( n0, n1 ) <= 0.f )
+				return true;
+		}
+
+		return false;
+	}
+}
+
+//--///}}}1/////////////// vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
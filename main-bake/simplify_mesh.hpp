@@ -0,0 +1,37 @@
+#ifndef SIMPLIFY_MESH_HPP_5E0B2C71_93A4_4D0F_A6E8_27C1F94B3D6A
+#define SIMPLIFY_MESH_HPP_5E0B2C71_93A4_4D0F_A6E8_27C1F94B3D6A
+
+//--//////////////////////////////////////////////////////////////////////////
+//--    include                                 ///{{{1///////////////////////
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "index_mesh.hpp"
+
+//--    functions                               ///{{{1///////////////////////
+
+// Simplify the triangles in aIndices (which refer to aMesh's vertices) using
+// edge collapses ordered by the quadric error metric (Garland & Heckbert,
+// "Surface Simplification Using Quadric Error Metrics", SIGGRAPH 1997).
+//
+// Collapses always move a vertex onto one of its neighbours, so no new
+// vertices are created and the result can share aMesh's vertex buffer.
+// Vertices on open borders and on attribute seams (several vertices with the
+// same position) are never moved, which keeps the silhouette of open meshes
+// and avoids cracks between seams.
+//
+// Stops once the result has at most aTargetIndexCount indices or when the
+// next collapse would exceed aTargetError (in model units). The error of the
+// result (same units) is returned in aResultError, if non-null.
+std::vector<std::uint32_t> simplify_mesh(
+	IndexedMesh const&,
+	std::vector<std::uint32_t> const& aIndices,
+	std::size_t aTargetIndexCount,
+	float aTargetError,
+	float* aResultError = nullptr
+);
+
+#endif // SIMPLIFY_MESH_HPP_5E0B2C71_93A4_4D0F_A6E8_27C1F94B3D6A
@@ -1,7 +1,13 @@
 #include "zstdistream.hpp"
 
-#include <streambuf>
+#include <mutex>
+#include <vector>
+#include <thread>
+#include <utility>
 #include <fstream>
+#include <streambuf>
+#include <exception>
+#include <condition_variable>
 
 #include <zstd.h>
 
@@ -13,74 +19,98 @@ namespace
 	class ZStdStreambuf_ : public std::streambuf
 	{
 		public:
-			ZStdStreambuf_( char const* aPath ), ~ZStdStreambuf_();
+			ZStdStreambuf_( char const* aPath, ZStdStreamConfig const& ), ~ZStdStreambuf_();
 
 		protected:
 			int underflow() override;
 
 		private:
-			char* mOutBuf;
-			std::size_t mOutSize;
+			// Decompress into aBlock until it is full or the input runs
+			// out. Returns the number of bytes written.
+			std::size_t fill_( char* aBlock );
+
+			// Body of the background thread (mBlockCount >= 2).
+			void produce_();
+
+			char* block_( std::size_t aIndex );
 
-			char* mInBuf;
-			std::size_t mInSize;
+		private:
+			std::size_t mBlockSize;
+			std::size_t mBlockCount;
+			std::vector<char> mBlocks; // mBlockCount blocks of mBlockSize
+			std::vector<std::size_t> mBlockFill;
+
+			std::vector<char> mInBuf;
 			ZSTD_inBuffer mInState;
+			bool mInputDone = false;
 
 			ZSTD_DCtx* mCtx;
 
 			std::ifstream mStream;
+
+			// Ring of blocks shared with the producer. Blocks [mConsumed,
+			// mProduced) hold data; block mConsumed is the one currently
+			// exposed via gptr() if mHaveBlock is set.
+			std::mutex mMutex;
+			std::condition_variable mFilled, mFreed;
+			std::size_t mProduced = 0, mConsumed = 0;
+			bool mHaveBlock = false;
+			bool mEnd = false, mStop = false;
+			std::exception_ptr mError;
+
+			std::thread mProducer;
 	};
 }
 
-ZStdIStream::ZStdIStream( char const* aPath )
+ZStdIStream::ZStdIStream( char const* aPath, ZStdStreamConfig const& aConfig )
 	: std::istream( nullptr )
-	, mInternal( std::make_unique<ZStdStreambuf_>(aPath) )
+	, mInternal( std::make_unique<ZStdStreambuf_>(aPath, aConfig) )
 {
 	rdbuf( mInternal.get() );
 }
 
 namespace
 {
-	ZStdStreambuf_::ZStdStreambuf_( char const* aPath )
+	ZStdStreambuf_::ZStdStreambuf_( char const* aPath, ZStdStreamConfig const& aConfig )
 		: mStream( aPath, std::ios::binary )
 	{
 		if( !mStream.is_open() )
 			throw lut::Error( "Unable to open '%s'", aPath );
 
 		// Init ZStd
-		mOutSize = ZSTD_DStreamOutSize();
-		mOutBuf = reinterpret_cast<char*>(::operator new( mOutSize ));
+		mBlockSize = aConfig.blockSize ? aConfig.blockSize : ZSTD_DStreamOutSize();
+		mBlockCount = aConfig.blockCount ? aConfig.blockCount : 1;
 
-		mInSize = ZSTD_DStreamInSize();
-		mInBuf = reinterpret_cast<char*>(::operator new( mInSize ));
+		mBlocks.resize( mBlockSize * mBlockCount );
+		mBlockFill.resize( mBlockCount, 0 );
+
+		mInBuf.resize( aConfig.readSize ? aConfig.readSize : ZSTD_DStreamInSize() );
+		mInState = ZSTD_inBuffer{ mInBuf.data(), 0, 0 };
 
 		mCtx = ZSTD_createDCtx();
 		if( !mCtx )
 			throw lut::Error( "ZSTD_createDCtx(): returned error" );
 
-		// Fill buffer once
-		mStream.read( mInBuf, mInSize );
-		if( mStream.bad() )
-			throw lut::Error( "Reading: badness happened" ); // :-(
-
-		mInState.src = mInBuf;
-		mInState.pos = 0;
-		mInState.size = mStream.gcount(); // iostreams are terrible.
-
-		// Decompress once
-		ZSTD_outBuffer ob{ mOutBuf, mOutSize, 0 };
-		auto const ret = ZSTD_decompressStream( mCtx, &ob, &mInState );
-		if( ZSTD_isError(ret) )
-			throw lut::Error( "Decompression: %s", ZSTD_getErrorName(ret) );
+		// Stream buffer starts out empty; the first underflow() fetches the
+		// first block.
+		setg( nullptr, nullptr, nullptr );
 
-		// Initialize stream buffer
-		setg( mOutBuf, mOutBuf, mOutBuf + ob.pos );
+		if( mBlockCount >= 2 )
+			mProducer = std::thread( [this] { produce_(); } );
 	}
 
 	ZStdStreambuf_::~ZStdStreambuf_()
 	{
-		::operator delete( mInBuf );
-		::operator delete( mOutBuf );
+		if( mProducer.joinable() )
+		{
+			{
+				std::lock_guard<std::mutex> lock( mMutex );
+				mStop = true;
+			}
+
+			mFreed.notify_all();
+			mProducer.join();
+		}
 
 		ZSTD_freeDCtx( mCtx );
 	}
@@ -89,29 +119,129 @@ namespace
 	{
 		// Decompressed buffer empty?
 		if( gptr() == egptr() )
+		{
+			if( !mProducer.joinable() )
+			{
+				auto const bytes = fill_( block_( 0 ) );
+				setg( block_( 0 ), block_( 0 ), block_( 0 ) + bytes );
+			}
+			else
+			{
+				std::unique_lock<std::mutex> lock( mMutex );
+
+				// Hand the block we just finished back to the producer
+				if( mHaveBlock )
+				{
+					++mConsumed;
+					mHaveBlock = false;
+					mFreed.notify_one();
+				}
+
+				mFilled.wait( lock, [this] { return mProduced != mConsumed || mEnd; } );
+
+				if( mProduced == mConsumed )
+				{
+					if( mError )
+						std::rethrow_exception( std::exchange( mError, nullptr ) );
+
+					return traits_type::eof();
+				}
+
+				auto const index = mConsumed % mBlockCount;
+				mHaveBlock = true;
+
+				setg( block_( index ), block_( index ), block_( index ) + mBlockFill[index] );
+			}
+		}
+
+		return gptr() == egptr()
+			? traits_type::eof()
+			: traits_type::to_int_type( *gptr() )
+		;
+	}
+
+	std::size_t ZStdStreambuf_::fill_( char* aBlock )
+	{
+		ZSTD_outBuffer ob{ aBlock, mBlockSize, 0 };
+		while( ob.pos < ob.size )
 		{
 			// Input buffer empty?
-			if( mInState.pos == mInSize )
+			if( mInState.pos == mInState.size && !mInputDone )
 			{
-				mStream.read( mInBuf, mInSize );
+				mStream.read( mInBuf.data(), std::streamsize(mInBuf.size()) );
 				if( mStream.bad() )
 					throw lut::Error( "Reading: badness happened" ); // :-(
 
 				mInState.pos = 0;
-				mInState.size = mStream.gcount();
+				mInState.size = std::size_t(mStream.gcount()); // iostreams are terrible.
+				mInputDone = (0 == mInState.size);
 			}
 
-			ZSTD_outBuffer ob{ mOutBuf, mOutSize, 0 };
+			// With the input exhausted, keep going only as long as zstd still
+			// flushes data that it held back.
+			auto const before = ob.pos;
+
 			auto const ret = ZSTD_decompressStream( mCtx, &ob, &mInState );
 			if( ZSTD_isError(ret) )
 				throw lut::Error( "Decompression: %s", ZSTD_getErrorName(ret) );
 
-			setg( mOutBuf, mOutBuf, mOutBuf + ob.pos );
+			if( mInputDone && before == ob.pos )
+				break;
 		}
 
-		return gptr() == egptr() 
-			? traits_type::eof() 
-			: traits_type::to_int_type( *gptr() )
-		;
+		return ob.pos;
+	}
+
+	void ZStdStreambuf_::produce_()
+	{
+		try
+		{
+			for( ;; )
+			{
+				{
+					std::unique_lock<std::mutex> lock( mMutex );
+					mFreed.wait( lock, [this] { return mStop || mProduced - mConsumed < mBlockCount; } );
+
+					if( mStop )
+						return;
+				}
+
+				// The block at mProduced is not visible to the reader until
+				// mProduced is incremented, so fill it without the lock.
+				auto const index = mProduced % mBlockCount;
+				auto const bytes = fill_( block_( index ) );
+
+				{
+					std::lock_guard<std::mutex> lock( mMutex );
+					if( 0 == bytes )
+						mEnd = true;
+					else
+					{
+						mBlockFill[index] = bytes;
+						++mProduced;
+					}
+				}
+
+				mFilled.notify_one();
+
+				if( 0 == bytes )
+					return;
+			}
+		}
+		catch( ... )
+		{
+			{
+				std::lock_guard<std::mutex> lock( mMutex );
+				mError = std::current_exception();
+				mEnd = true;
+			}
+
+			mFilled.notify_one();
+		}
+	}
+
+	char* ZStdStreambuf_::block_( std::size_t aIndex )
+	{
+		return mBlocks.data() + aIndex*mBlockSize;
 	}
 }
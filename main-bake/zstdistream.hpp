@@ -4,16 +4,38 @@
 #include <istream>
 #include <memory>
 
+#include <cstddef>
+
 // Rapidobj fortunately allows us to feed it a custom data stream. Somewhat
 // unfortunately, the interface for this is a std::istream.
 //
 // Hence, to to decompress stuff on the fly, we have to write a std::istream /
 // std::streambuf adaptor. :-(
 
+struct ZStdStreamConfig
+{
+	/* Size of each block of decompressed data handed to the reader. Zero
+	 * selects ZSTD_DStreamOutSize() (128 kB).
+	 */
+	std::size_t blockSize = 0;
+
+	/* Number of decompressed blocks. With two or more, a background thread
+	 * reads and decompresses ahead into the free blocks while the reader
+	 * consumes the others. With one (or zero), everything happens on the
+	 * reader's thread, whenever it runs out of data.
+	 */
+	std::size_t blockCount = 3;
+
+	/* Size of the reads from the compressed file. Zero selects
+	 * ZSTD_DStreamInSize() (128 kB + a bit).
+	 */
+	std::size_t readSize = 0;
+};
+
 class ZStdIStream : public std::istream
 {
 	public:
-		explicit ZStdIStream( char const* aPath );
+		explicit ZStdIStream( char const* aPath, ZStdStreamConfig const& = {} );
 
 	private:
 		std::unique_ptr<std::streambuf> mInternal;
@@ -1,7 +1,31 @@
 #include "baked_model.hpp"
 
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <numeric>
+#include <utility>
+#include <algorithm>
+#include <exception>
+
+#include <cerrno>
 #include <cstdio>
 #include <cstring>
+#include <cassert>
+
+#if defined(_WIN32)
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <windows.h>
+#else // !_WIN32
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#endif // ~ _WIN32
+
+#include <zstd.h>
 
 #include "../utils/error.hpp"
 namespace lut = labutils;
@@ -10,118 +34,842 @@ namespace
 {
 	// See cw2-bake/main.cpp for more info
 	constexpr char kFileMagic[16] = "\0\0COMP5892Mmesh";
-	constexpr char kFileVariant[16] = "21-tan";
+	constexpr char kFileVariant[16] = "28-toc";
+
+	// Same layout as kFileVariant. The position bias and scale (used as
+	// culling bounds) may be larger than the mesh; positions still decode
+	// exactly, so these are read, but culling is less effective.
+	constexpr char kFileVariantLoose[16] = "27-toc";
+
+	// Older variants without the table of contents; everything is stored
+	// sequentially. These can still be read. Their bounds may be too large,
+	// as with kFileVariantLoose.
+	constexpr char kFileVariantSequential[16] = "26-index16";
+
+	constexpr std::size_t kPayloadAlignment = 64;
+	constexpr std::size_t kArrayAlignment = 16;
+
+	// Header flags
+	constexpr std::uint32_t kFileFlagZstdMeshes = 1u << 0; // see decode_mesh_()
+	constexpr std::uint32_t kKnownFileFlags = kFileFlagZstdMeshes;
 
 	constexpr std::uint32_t kMaxString = 32*1024;
 
+	// Magic, variant, counts; the table of contents follows
+	constexpr std::size_t kHeaderSize = 48;
+
+	// types
+	struct Header_
+	{
+		bool hasToc;
+	};
+
+	struct TocCounts_
+	{
+		std::uint32_t textures;
+		std::uint32_t materials;
+		std::uint32_t meshes;
+		std::uint32_t flags;
+	};
+
+	// Arrays in a mesh payload, in file order
+	enum EMeshArray_ : std::size_t
+	{
+		kMeshPositions_,
+		kMeshTexcoords_,
+		kMeshTangents_,
+		kMeshIndices_,
+		kMeshLods_,
+		kMeshMeshlets_,
+		kMeshMeshletVertices_,
+		kMeshMeshletTriangles_,
+		kMeshArrayCount_
+	};
+
+	struct MeshArray_
+	{
+		std::size_t offset; // relative to the start of the payload
+		std::size_t size;   // in bytes
+		std::size_t lane;   // component size, for the byte shuffle
+	};
+
+	using MeshLayout_ = std::array<MeshArray_, kMeshArrayCount_>;
+
+	// File with positional reads (pread() or equivalent). Reads don't share
+	// a file position, so several threads can read from it concurrently.
+	class PositionalFile_
+	{
+		public:
+			explicit PositionalFile_( char const* aPath );
+			~PositionalFile_();
+
+			PositionalFile_( PositionalFile_ const& ) = delete;
+			PositionalFile_& operator= (PositionalFile_ const&) = delete;
+
+		public:
+			std::uint64_t size() const noexcept;
+
+			void read( std::uint64_t aOffset, std::size_t aBytes, void* aBuffer ) const;
+
+		private:
+#			if defined(_WIN32)
+			HANDLE mHandle;
+#			else
+			int mFd;
+#			endif
+
+			std::uint64_t mSize;
+			char const* mPath;
+	};
+
+	// Sequential reader over a range of bytes. All reads are bounds checked.
+	class Reader_
+	{
+		public:
+			Reader_( std::span<std::byte const> aBytes, char const* aInputName ) noexcept
+				: mBytes( aBytes )
+				, mInputName( aInputName )
+			{}
+
+		public:
+			std::span<std::byte const> bytes( std::size_t aCount )
+			{
+				if( aCount > mBytes.size() - mOffset )
+					throw lut::Error( "load_baked_model_(): %s: expected %zu bytes at offset %zu, file has %zu", mInputName, aCount, mOffset, mBytes.size() );
+
+				auto const ret = mBytes.subspan( mOffset, aCount );
+				mOffset += aCount;
+				return ret;
+			}
+
+			template< typename tType >
+			tType value()
+			{
+				tType ret;
+				std::memcpy( &ret, bytes( sizeof(tType) ).data(), sizeof(tType) );
+				return ret;
+			}
+
+			std::uint32_t u32()
+			{
+				return value<std::uint32_t>();
+			}
+
+			std::string string()
+			{
+				auto const length = u32();
+
+				if( length >= kMaxString )
+					throw lut::Error( "load_baked_model_(): %s: unexpectedly long string (%u bytes)", mInputName, length );
+
+				auto const data = bytes( length );
+				return std::string( reinterpret_cast<char const*>(data.data()), length );
+			}
+
+			std::size_t remaining() const noexcept
+			{
+				return mBytes.size() - mOffset;
+			}
+
+			// Skip to the next multiple of aAlignment (relative to the
+			// start of the bytes passed to the constructor)
+			void align( std::size_t aAlignment )
+			{
+				bytes( (aAlignment - mOffset % aAlignment) % aAlignment );
+			}
+
+		private:
+			std::span<std::byte const> mBytes;
+			std::size_t mOffset = 0;
+
+			char const* mInputName;
+	};
+
 	// functions
-	BakedModel load_baked_model_( FILE*, char const* );
+	template< typename tType >
+	void copy_out_( std::vector<tType>&, std::span<std::byte const> );
+
+	BakedMeshData copy_mesh_( MappedBakedMeshData const& );
+
+	std::string base_path_( char const* );
+
+	Header_ read_header_( Reader_&, char const* );
+	TocCounts_ read_toc_counts_( Reader_& );
+	std::vector<BakedTocEntry> read_toc_entries_( Reader_&, TocCounts_ const&, std::uint64_t, char const* );
+
+	BakedTextureInfo parse_texture_( std::span<std::byte const>, std::string const&, char const* );
+	std::vector<BakedMaterialInfo> parse_materials_( std::span<std::byte const>, std::uint32_t, std::size_t, char const* );
+	MeshLayout_ mesh_layout_( BakedMeshHeader const& );
+	MappedBakedMeshData parse_mesh_( std::span<std::byte const>, std::size_t, char const*, std::uint32_t );
+
+	std::span<std::byte const> decode_mesh_( std::span<std::byte const>, std::vector<std::byte>& aScratch, std::vector<std::byte>& aOut, char const*, std::uint32_t );
+
+	void load_baked_model_( MappedBakedModel&, char const* );
+
+	void load_toc_( MappedBakedModel&, Reader_&, std::string const&, char const* );
+	void load_sequential_( MappedBakedModel&, Reader_&, std::string const&, char const* );
+
+	void check_lods_( MappedBakedMeshData const&, char const*, std::uint32_t );
 }
 
 BakedModel load_baked_model( char const* aModelPath )
 {
-	FILE* fin = std::fopen( aModelPath, "rb" );
-	if( !fin )
-		throw lut::Error( "load_baked_model(): unable to open '%s' for reading", aModelPath );
+	auto const mapped = load_baked_model_mapped( aModelPath );
+
+	BakedModel ret;
+	ret.textures = mapped.textures;
+	ret.materials = mapped.materials;
+
+	ret.meshes.reserve( mapped.meshes.size() );
+	for( auto const& mesh : mapped.meshes )
+		ret.meshes.emplace_back( copy_mesh_( mesh ) );
+
+	return ret;
+}
+
+MappedBakedModel load_baked_model_mapped( char const* aModelPath )
+{
+	MappedBakedModel ret;
+	ret.file = BakedFileMapping( aModelPath );
+
+	load_baked_model_( ret, aModelPath );
+	return ret;
+}
+
+BakedModel load_baked_model_parallel( char const* aModelPath, std::size_t aThreadCount )
+{
+	PositionalFile_ file( aModelPath );
+
+	// Header and table of contents
+	std::vector<std::byte> buffer( std::min<std::uint64_t>( kHeaderSize, file.size() ) );
+	file.read( 0, buffer.size(), buffer.data() );
+
+	Reader_ in( buffer, aModelPath );
+
+	auto const header = read_header_( in, aModelPath );
+	if( !header.hasToc )
+		return load_baked_model( aModelPath ); // no random access without a TOC
+
+	auto const counts = read_toc_counts_( in );
+
+	buffer.resize( (std::size_t(counts.textures) + 1 + counts.meshes) * sizeof(BakedTocEntry) );
+	file.read( kHeaderSize, buffer.size(), buffer.data() );
+
+	Reader_ tin( buffer, aModelPath );
+	auto const toc = read_toc_entries_( tin, counts, file.size(), aModelPath );
+
+	auto const read_payload_ = [&] (BakedTocEntry const& aEntry, std::vector<std::byte>& aBuffer) {
+		aBuffer.resize( std::size_t(aEntry.size) );
+		file.read( aEntry.offset, aBuffer.size(), aBuffer.data() );
+		return std::span<std::byte const>( aBuffer );
+	};
+
+	// Textures and materials are tiny; read them on the calling thread
+	BakedModel ret;
+
+	auto const prefix = base_path_( aModelPath );
+
+	ret.textures.reserve( counts.textures );
+	for( std::uint32_t i = 0; i < counts.textures; ++i )
+		ret.textures.emplace_back( parse_texture_( read_payload_( toc[i], buffer ), prefix, aModelPath ) );
+
+	ret.materials = parse_materials_( read_payload_( toc[counts.textures], buffer ), counts.materials, ret.textures.size(), aModelPath );
+
+	// Meshes are read, decompressed (if needed), validated and decoded by a
+	// set of worker threads.
+	// Largest payloads are handed out first (see index_meshes_() in the
+	// baker for the same reasoning).
+	ret.meshes.resize( counts.meshes );
+
+	auto const meshToc = toc.data() + counts.textures + 1;
+
+	std::vector<std::uint32_t> order( counts.meshes );
+	std::iota( order.begin(), order.end(), std::uint32_t(0) );
+	std::stable_sort( order.begin(), order.end(), [&] (std::uint32_t aI, std::uint32_t aJ) {
+		return meshToc[aI].size > meshToc[aJ].size;
+	} );
+
+	std::atomic<std::size_t> next{ 0 };
+
+	std::mutex errorMutex;
+	std::exception_ptr error;
+
+	auto const worker_ = [&] {
+		// Reused between meshes
+		std::vector<std::byte> meshBuffer, scratch, decoded;
+
+		for( std::size_t i; (i = next.fetch_add( 1 )) < order.size(); )
+		{
+			auto const meshIndex = order[i];
+
+			try
+			{
+				auto payload = read_payload_( meshToc[meshIndex], meshBuffer );
+				if( counts.flags & kFileFlagZstdMeshes )
+					payload = decode_mesh_( payload, scratch, decoded, aModelPath, meshIndex );
+
+				auto const mesh = parse_mesh_( payload, ret.materials.size(), aModelPath, meshIndex );
+				ret.meshes[meshIndex] = copy_mesh_( mesh );
+			}
+			catch( ... )
+			{
+				std::lock_guard<std::mutex> lock( errorMutex );
+				if( !error )
+					error = std::current_exception();
+
+				next = order.size(); // stop handing out work
+			}
+		}
+	};
+
+	if( 0 == aThreadCount )
+		aThreadCount = std::max( 1u, std::thread::hardware_concurrency() );
+
+	std::size_t const threadCount = std::min<std::size_t>( aThreadCount, order.size() );
+
+	std::vector<std::thread> threads;
+	if( threadCount > 1 )
+	{
+		threads.reserve( threadCount-1 );
+		for( std::size_t i = 1; i < threadCount; ++i )
+			threads.emplace_back( worker_ );
+	}
+
+	worker_(); // the calling thread participates as well
+
+	for( auto& thread : threads )
+		thread.join();
+
+	if( error )
+		std::rethrow_exception( error );
+
+	return ret;
+}
+
+
+BakedFileMapping::BakedFileMapping() noexcept = default;
+
+BakedFileMapping::~BakedFileMapping()
+{
+	if( mData )
+	{
+#		if defined(_WIN32)
+		UnmapViewOfFile( mData );
+#		else
+		munmap( const_cast<void*>(mData), mSize );
+#		endif
+	}
+}
+
+BakedFileMapping::BakedFileMapping( char const* aPath )
+{
+#	if defined(_WIN32)
+	HANDLE file = CreateFileA( aPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+	if( INVALID_HANDLE_VALUE == file )
+		throw lut::Error( "BakedFileMapping: unable to open '%s' for reading", aPath );
 
-	try
+	LARGE_INTEGER size;
+	if( !GetFileSizeEx( file, &size ) )
 	{
-		auto ret = load_baked_model_( fin, aModelPath );
-		std::fclose( fin );
-		return ret;
+		CloseHandle( file );
+		throw lut::Error( "BakedFileMapping: unable to query size of '%s'", aPath );
+	}
+
+	mSize = std::size_t(size.QuadPart);
+	if( 0 == mSize )
+	{
+		CloseHandle( file );
+		return;
+	}
+
+	// The view keeps the file mapping alive, so neither handle is needed
+	// after mapping.
+	HANDLE mapping = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	CloseHandle( file );
+
+	if( !mapping )
+		throw lut::Error( "BakedFileMapping: unable to create file mapping for '%s'", aPath );
+
+	mData = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+	CloseHandle( mapping );
+
+	if( !mData )
+		throw lut::Error( "BakedFileMapping: unable to map '%s'", aPath );
+#	else // !_WIN32
+	int const fd = open( aPath, O_RDONLY );
+	if( -1 == fd )
+		throw lut::Error( "BakedFileMapping: unable to open '%s' for reading: %s", aPath, std::strerror(errno) );
+
+	struct stat st;
+	if( -1 == fstat( fd, &st ) )
+	{
+		close( fd );
+		throw lut::Error( "BakedFileMapping: unable to query size of '%s': %s", aPath, std::strerror(errno) );
 	}
-	catch( ... )
+
+	mSize = std::size_t(st.st_size);
+	if( 0 == mSize )
 	{
-		std::fclose( fin );
-		throw;
+		close( fd );
+		return;
 	}
+
+	void* data = mmap( nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd ); // the mapping keeps its own reference to the file
+
+	if( MAP_FAILED == data )
+		throw lut::Error( "BakedFileMapping: unable to map '%s': %s", aPath, std::strerror(errno) );
+
+	// The whole file is read front to back during loading and upload; start
+	// reading it in right away. (These are only hints; failure is harmless.)
+	madvise( data, mSize, MADV_SEQUENTIAL );
+	madvise( data, mSize, MADV_WILLNEED );
+
+	mData = data;
+#	endif // ~ _WIN32
+}
+
+BakedFileMapping::BakedFileMapping( BakedFileMapping&& aOther ) noexcept
+	: mData( std::exchange( aOther.mData, nullptr ) )
+	, mSize( std::exchange( aOther.mSize, 0 ) )
+{}
+BakedFileMapping& BakedFileMapping::operator=( BakedFileMapping&& aOther ) noexcept
+{
+	std::swap( mData, aOther.mData );
+	std::swap( mSize, aOther.mSize );
+	return *this;
+}
+
+std::span<std::byte const> BakedFileMapping::bytes() const noexcept
+{
+	return { static_cast<std::byte const*>(mData), mSize };
 }
 
+
 namespace
 {
-	void checked_read_( FILE* aFin, std::size_t aBytes, void* aBuffer )
+	PositionalFile_::PositionalFile_( char const* aPath )
+		: mPath( aPath )
 	{
-		auto ret = std::fread( aBuffer, 1, aBytes, aFin );
+#		if defined(_WIN32)
+		mHandle = CreateFileA( aPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+		if( INVALID_HANDLE_VALUE == mHandle )
+			throw lut::Error( "load_baked_model_parallel(): unable to open '%s' for reading", aPath );
+
+		LARGE_INTEGER size;
+		if( !GetFileSizeEx( mHandle, &size ) )
+		{
+			CloseHandle( mHandle );
+			throw lut::Error( "load_baked_model_parallel(): unable to query size of '%s'", aPath );
+		}
+
+		mSize = std::uint64_t(size.QuadPart);
+#		else // !_WIN32
+		mFd = open( aPath, O_RDONLY );
+		if( -1 == mFd )
+			throw lut::Error( "load_baked_model_parallel(): unable to open '%s' for reading: %s", aPath, std::strerror(errno) );
+
+		struct stat st;
+		if( -1 == fstat( mFd, &st ) )
+		{
+			close( mFd );
+			throw lut::Error( "load_baked_model_parallel(): unable to query size of '%s': %s", aPath, std::strerror(errno) );
+		}
 
-		if( aBytes != ret )
-			throw lut::Error( "checked_read_(): expected %zu bytes, got %zu", aBytes, ret );
+		mSize = std::uint64_t(st.st_size);
+#		endif // ~ _WIN32
 	}
 
-	std::uint32_t read_uint32_( FILE* aFin )
+	PositionalFile_::~PositionalFile_()
 	{
-		std::uint32_t ret;
-		checked_read_( aFin, sizeof(std::uint32_t), &ret );
-		return ret;
+#		if defined(_WIN32)
+		CloseHandle( mHandle );
+#		else
+		close( mFd );
+#		endif
 	}
-	std::string read_string_( FILE* aFin )
+
+	std::uint64_t PositionalFile_::size() const noexcept
 	{
-		auto const length = read_uint32_( aFin );
+		return mSize;
+	}
 
-		if( length >= kMaxString )
-			throw lut::Error( "read_string_(): unexpectedly long string (%u bytes)", length );
+	void PositionalFile_::read( std::uint64_t aOffset, std::size_t aBytes, void* aBuffer ) const
+	{
+		auto* out = static_cast<std::byte*>(aBuffer);
 
-		std::string ret;
-		ret.resize( length );
+		while( aBytes )
+		{
+#			if defined(_WIN32)
+			// Passing the offset via OVERLAPPED makes ReadFile() positional
+			// on a synchronous handle, like pread().
+			OVERLAPPED ov{};
+			ov.Offset = DWORD(aOffset & 0xffffffffu);
+			ov.OffsetHigh = DWORD(aOffset >> 32);
+
+			DWORD const chunk = DWORD(std::min<std::size_t>( aBytes, 1u<<30 ));
+			DWORD got = 0;
+			if( !ReadFile( mHandle, out, chunk, &got, &ov ) || 0 == got )
+				throw lut::Error( "load_baked_model_parallel(): %s: read of %zu bytes at offset %llu failed", mPath, aBytes, (unsigned long long)aOffset );
+#			else // !_WIN32
+			auto const got = pread( mFd, out, aBytes, off_t(aOffset) );
+			if( got < 0 && EINTR == errno )
+				continue;
+
+			if( got <= 0 )
+				throw lut::Error( "load_baked_model_parallel(): %s: read of %zu bytes at offset %llu failed: %s", mPath, aBytes, (unsigned long long)aOffset, got < 0 ? std::strerror(errno) : "end of file" );
+#			endif // ~ _WIN32
+
+			out += got;
+			aOffset += std::uint64_t(got);
+			aBytes -= std::size_t(got);
+		}
+	}
 
-		checked_read_( aFin, length, ret.data() );
-		return ret;
+
+	template< typename tType >
+	void copy_out_( std::vector<tType>& aOut, std::span<std::byte const> aBytes )
+	{
+		assert( 0 == aBytes.size() % sizeof(tType) );
+
+		aOut.resize( aBytes.size() / sizeof(tType) );
+		if( !aBytes.empty() )
+			std::memcpy( aOut.data(), aBytes.data(), aBytes.size() );
 	}
 
-	BakedModel load_baked_model_( FILE* aFin, char const* aInputName )
+	BakedMeshData copy_mesh_( MappedBakedMeshData const& aMesh )
 	{
-		BakedModel ret;
+		BakedMeshData ret;
+		ret.materialId = aMesh.materialId;
+		ret.positionScale = aMesh.positionScale;
+		ret.positionBias = aMesh.positionBias;
+
+		copy_out_( ret.positions, aMesh.positions );
+		copy_out_( ret.texcoords, aMesh.texcoords );
+		copy_out_( ret.tangentsComp, aMesh.tangentsComp );
+
+		ret.indexSize = aMesh.indexSize;
+		if( sizeof(std::uint16_t) == aMesh.indexSize )
+			copy_out_( ret.indices16, aMesh.indices );
+		else
+			copy_out_( ret.indices, aMesh.indices );
+
+		ret.lods = aMesh.lods;
 
-		// Figure out base path
+		copy_out_( ret.meshlets, aMesh.meshlets );
+		copy_out_( ret.meshletVertices, aMesh.meshletVertices );
+		copy_out_( ret.meshletTriangles, aMesh.meshletTriangles );
+
+		return ret;
+	}
+
+	std::string base_path_( char const* aInputName )
+	{
 		char const* pathBeg = aInputName;
 		char const* pathEnd = std::strrchr( pathBeg, '/' );
 	
-		std::string const prefix = pathEnd
+		return pathEnd
 			? std::string( pathBeg, pathEnd+1 )
 			: ""
 		;
+	}
 
-		// Read header and verify file magic and variant
-		char magic[16];
-		checked_read_( aFin, 16, magic );
+	Header_ read_header_( Reader_& aIn, char const* aInputName )
+	{
+		// Verify file magic and variant
+		auto const magic = aIn.bytes( 16 );
 
-		if( 0 != std::memcmp( magic, kFileMagic, 16 ) )
+		if( 0 != std::memcmp( magic.data(), kFileMagic, 16 ) )
 			throw lut::Error( "load_baked_model_(): %s: invalid file signature!", aInputName );
 
 		char variant[16];
-		checked_read_( aFin, 16, variant );
+		std::memcpy( variant, aIn.bytes( 16 ).data(), 16 );
+		variant[15] = '\0';
+
+		auto const is_ = [&] (char const* aVariant) {
+			return 0 == std::memcmp( variant, aVariant, 16 );
+		};
+
+		if( is_( kFileVariant ) )
+			return Header_{ true };
+
+		if( is_( kFileVariantLoose ) || is_( kFileVariantSequential ) )
+		{
+			std::fprintf( stderr, "Note: '%s' has variant '%s'; re-bake for tighter culling bounds\n", aInputName, variant );
+			return Header_{ is_( kFileVariantLoose ) };
+		}
+
+		throw lut::Error( "load_baked_model_(): %s: file variant is '%s', expected '%s'", aInputName, variant, kFileVariant );
+	}
+
+	TocCounts_ read_toc_counts_( Reader_& aIn )
+	{
+		TocCounts_ ret;
+		ret.textures = aIn.u32();
+		ret.materials = aIn.u32();
+		ret.meshes = aIn.u32();
+		ret.flags = aIn.u32();
+		return ret;
+	}
+
+	std::vector<BakedTocEntry> read_toc_entries_( Reader_& aIn, TocCounts_ const& aCounts, std::uint64_t aFileSize, char const* aInputName )
+	{
+		if( aCounts.flags & ~kKnownFileFlags )
+			throw lut::Error( "load_baked_model_(): %s: unsupported file flags %#x", aInputName, aCounts.flags );
+
+		std::vector<BakedTocEntry> ret( std::size_t(aCounts.textures) + 1 + aCounts.meshes );
+		copy_out_( ret, aIn.bytes( ret.size()*sizeof(BakedTocEntry) ) );
+
+		for( auto const& entry : ret )
+		{
+			if( 0 != entry.offset % kPayloadAlignment || entry.offset > aFileSize || entry.size > aFileSize - entry.offset )
+				throw lut::Error( "load_baked_model_(): %s: invalid table of contents entry (offset %llu, size %llu)", aInputName, (unsigned long long)entry.offset, (unsigned long long)entry.size );
+		}
+
+		return ret;
+	}
+
+	BakedTextureInfo parse_texture_( std::span<std::byte const> aPayload, std::string const& aPrefix, char const* aInputName )
+	{
+		Reader_ in( aPayload, aInputName );
+
+		BakedTextureInfo ret;
+		ret.path = aPrefix + in.string();
+		ret.space = ETextureSpace(in.value<std::uint8_t>());
+		ret.channels = in.value<std::uint8_t>();
+		return ret;
+	}
+
+	std::vector<BakedMaterialInfo> parse_materials_( std::span<std::byte const> aPayload, std::uint32_t aCount, std::size_t aTextureCount, char const* aInputName )
+	{
+		Reader_ in( aPayload, aInputName );
+
+		std::vector<BakedMaterialInfo> ret;
+		copy_out_( ret, in.bytes( std::size_t(aCount)*sizeof(BakedMaterialInfo) ) );
+
+		for( auto const& info : ret )
+		{
+			assert( info.baseColorTextureId < aTextureCount );
+			assert( info.roughnessTextureId < aTextureCount );
+			assert( info.metalnessTextureId < aTextureCount );
+			assert( info.emissiveTextureId < aTextureCount );
+			(void)info;
+		}
+		(void)aTextureCount;
+
+		return ret;
+	}
+
+	MeshLayout_ mesh_layout_( BakedMeshHeader const& aHeader )
+	{
+		std::size_t const V = aHeader.vertexCount;
+
+		std::size_t const sizes[kMeshArrayCount_][2] = { // { bytes, lane }
+			{ V*sizeof(glm::u16vec4), sizeof(std::uint16_t) },
+			{ V*sizeof(glm::u16vec2), sizeof(std::uint16_t) },
+			{ V*sizeof(std::uint32_t), sizeof(std::uint32_t) },
+			{ std::size_t(aHeader.indexCount)*aHeader.indexSize, aHeader.indexSize },
+			{ std::size_t(aHeader.lodCount)*sizeof(BakedMeshLod), sizeof(std::uint32_t) },
+			{ std::size_t(aHeader.meshletCount)*sizeof(BakedMeshlet), sizeof(std::uint32_t) },
+			{ std::size_t(aHeader.meshletVertexCount)*sizeof(std::uint32_t), sizeof(std::uint32_t) },
+			{ 3*std::size_t(aHeader.meshletTriangleCount)*sizeof(std::uint8_t), sizeof(std::uint8_t) }
+		};
+
+		MeshLayout_ ret;
+
+		std::size_t offset = sizeof(BakedMeshHeader);
+		for( std::size_t i = 0; i < kMeshArrayCount_; ++i )
+		{
+			offset = (offset + kArrayAlignment-1) / kArrayAlignment * kArrayAlignment;
+			ret[i] = MeshArray_{ offset, sizes[i][0], sizes[i][1] };
+			offset += sizes[i][0];
+		}
+
+		return ret;
+	}
+
+	MappedBakedMeshData parse_mesh_( std::span<std::byte const> aPayload, std::size_t aMaterialCount, char const* aInputName, std::uint32_t aMesh )
+	{
+		Reader_ in( aPayload, aInputName );
 
-		if( 0 != std::memcmp( variant, kFileVariant, 16 ) )
-			throw lut::Error( "load_baked_model_(): %s: file variant is '%s', expected '%s'", aInputName, variant, kFileVariant );
+		auto const header = in.value<BakedMeshHeader>();
+		assert( header.materialId < aMaterialCount );
+		(void)aMaterialCount;
+
+		if( sizeof(std::uint16_t) != header.indexSize && sizeof(std::uint32_t) != header.indexSize )
+			throw lut::Error( "load_baked_model_(): %s: mesh %u has invalid index size %u", aInputName, aMesh, header.indexSize );
+
+		auto const layout = mesh_layout_( header );
+
+		auto const& last = layout[kMeshArrayCount_-1];
+		if( last.offset + last.size > aPayload.size() )
+			throw lut::Error( "load_baked_model_(): %s: mesh %u needs %zu bytes, payload has %zu", aInputName, aMesh, last.offset + last.size, aPayload.size() );
+
+		auto const array_ = [&] (EMeshArray_ aArray) {
+			return aPayload.subspan( layout[aArray].offset, layout[aArray].size );
+		};
+
+		MappedBakedMeshData ret;
+		ret.materialId = header.materialId;
+		ret.positionScale = glm::vec3( header.positionScale[0], header.positionScale[1], header.positionScale[2] );
+		ret.positionBias = glm::vec3( header.positionBias[0], header.positionBias[1], header.positionBias[2] );
+
+		ret.vertexCount = header.vertexCount;
+		ret.indexCount = header.indexCount;
+		ret.indexSize = header.indexSize;
+
+		ret.positions = array_( kMeshPositions_ );
+		ret.texcoords = array_( kMeshTexcoords_ );
+		ret.tangentsComp = array_( kMeshTangents_ );
+		ret.indices = array_( kMeshIndices_ );
+
+		copy_out_( ret.lods, array_( kMeshLods_ ) );
+		check_lods_( ret, aInputName, aMesh );
+
+		ret.meshletCount = header.meshletCount;
+		ret.meshlets = array_( kMeshMeshlets_ );
+		ret.meshletVertices = array_( kMeshMeshletVertices_ );
+		ret.meshletTriangles = array_( kMeshMeshletTriangles_ );
+
+		return ret;
+	}
+
+	std::span<std::byte const> decode_mesh_( std::span<std::byte const> aFrame, std::vector<std::byte>& aScratch, std::vector<std::byte>& aOut, char const* aInputName, std::uint32_t aMesh )
+	{
+		// With kFileFlagZstdMeshes, each mesh payload is a single zstd frame
+		// (with the content size in its header). Before compression, each
+		// array was byte-shuffled: viewing it as elements of 'lane' bytes,
+		// the first bytes of all elements were stored first, then the second
+		// bytes, and so on. The header and padding are not shuffled.
+		auto const size = ZSTD_getFrameContentSize( aFrame.data(), aFrame.size() );
+		if( ZSTD_CONTENTSIZE_ERROR == size || ZSTD_CONTENTSIZE_UNKNOWN == size || size < sizeof(BakedMeshHeader) )
+			throw lut::Error( "load_baked_model_(): %s: mesh %u is not a valid zstd frame", aInputName, aMesh );
+
+		aScratch.resize( std::size_t(size) );
+
+		auto const got = ZSTD_decompress( aScratch.data(), aScratch.size(), aFrame.data(), aFrame.size() );
+		if( ZSTD_isError( got ) || got != size )
+			throw lut::Error( "load_baked_model_(): %s: unable to decompress mesh %u: %s", aInputName, aMesh, ZSTD_isError( got ) ? ZSTD_getErrorName( got ) : "size mismatch" );
+
+		BakedMeshHeader header;
+		std::memcpy( &header, aScratch.data(), sizeof(header) );
+
+		auto const layout = mesh_layout_( header );
+
+		auto const& last = layout[kMeshArrayCount_-1];
+		if( last.offset + last.size > aScratch.size() )
+			throw lut::Error( "load_baked_model_(): %s: mesh %u needs %zu bytes, payload has %zu", aInputName, aMesh, last.offset + last.size, aScratch.size() );
+
+		aOut.resize( aScratch.size() );
+		std::memcpy( aOut.data(), aScratch.data(), sizeof(header) );
+
+		for( auto const& array : layout )
+		{
+			auto const* src = aScratch.data() + array.offset;
+			auto* dst = aOut.data() + array.offset;
+
+			if( array.lane <= 1 || 0 != array.size % array.lane )
+			{
+				std::memcpy( dst, src, array.size );
+				continue;
+			}
+
+			auto const count = array.size / array.lane;
+			for( std::size_t b = 0; b < array.lane; ++b )
+			{
+				for( std::size_t i = 0; i < count; ++i )
+					dst[i*array.lane + b] = src[b*count + i];
+			}
+		}
+
+		return aOut;
+	}
+
+	void load_baked_model_( MappedBakedModel& aModel, char const* aInputName )
+	{
+		Reader_ in( aModel.file.bytes(), aInputName );
+
+		auto const prefix = base_path_( aInputName );
+		auto const header = read_header_( in, aInputName );
+
+		if( header.hasToc )
+			load_toc_( aModel, in, prefix, aInputName );
+		else
+			load_sequential_( aModel, in, prefix, aInputName );
+	}
+
+	void load_toc_( MappedBakedModel& aModel, Reader_& aIn, std::string const& aPrefix, char const* aInputName )
+	{
+		auto& ret = aModel;
+
+		auto const fileBytes = aModel.file.bytes();
+		auto const payload_ = [&] (BakedTocEntry const& aEntry) {
+			return fileBytes.subspan( std::size_t(aEntry.offset), std::size_t(aEntry.size) );
+		};
+
+		auto const counts = read_toc_counts_( aIn );
+		auto const toc = read_toc_entries_( aIn, counts, fileBytes.size(), aInputName );
+
+		ret.textures.reserve( counts.textures );
+		for( std::uint32_t i = 0; i < counts.textures; ++i )
+			ret.textures.emplace_back( parse_texture_( payload_( toc[i] ), aPrefix, aInputName ) );
+
+		ret.materials = parse_materials_( payload_( toc[counts.textures] ), counts.materials, ret.textures.size(), aInputName );
+
+		// Each mesh is self-contained, so this could equally well be done for
+		// a subset of the meshes or in any order.
+		ret.meshPayloads.assign( toc.begin() + counts.textures + 1, toc.end() );
+
+		ret.meshes.reserve( counts.meshes );
+
+		if( counts.flags & kFileFlagZstdMeshes )
+		{
+			// Compressed meshes can't be viewed in place; decode them into
+			// buffers owned by the model.
+			std::vector<std::byte> scratch;
+
+			ret.decodedMeshes.resize( counts.meshes );
+			for( std::uint32_t i = 0; i < counts.meshes; ++i )
+			{
+				auto const payload = decode_mesh_( payload_( ret.meshPayloads[i] ), scratch, ret.decodedMeshes[i], aInputName, i );
+				ret.meshes.emplace_back( parse_mesh_( payload, ret.materials.size(), aInputName, i ) );
+			}
+		}
+		else
+		{
+			for( std::uint32_t i = 0; i < counts.meshes; ++i )
+				ret.meshes.emplace_back( parse_mesh_( payload_( ret.meshPayloads[i] ), ret.materials.size(), aInputName, i ) );
+		}
+	}
+
+	void load_sequential_( MappedBakedModel& aModel, Reader_& aIn, std::string const& aPrefix, char const* aInputName )
+	{
+		auto& ret = aModel;
+		auto& in = aIn;
 
 		// Read texture info
-		auto const textureCount = read_uint32_( aFin );
+		auto const textureCount = in.u32();
 		for( std::uint32_t i = 0; i < textureCount; ++i )
 		{
 			BakedTextureInfo info;
-			info.path = prefix + read_string_( aFin );
-
-			std::uint8_t space;
-			checked_read_( aFin, sizeof(std::uint8_t), &space );
-			info.space = ETextureSpace(space);
-
-			std::uint8_t channels;
-			checked_read_( aFin, sizeof(std::uint8_t), &channels );
-			info.channels = channels;
+			info.path = aPrefix + in.string();
+			info.space = ETextureSpace(in.value<std::uint8_t>());
+			info.channels = in.value<std::uint8_t>();
 
 			ret.textures.emplace_back( std::move(info) );
 		}
 
 		// Read material info
-		auto const materialCount = read_uint32_( aFin );
+		auto const materialCount = in.u32();
 		for( std::uint32_t i = 0; i < materialCount; ++i )
 		{
 			BakedMaterialInfo info;
-			info.baseColorTextureId = read_uint32_( aFin );
-			info.roughnessTextureId = read_uint32_( aFin );
-			info.metalnessTextureId = read_uint32_( aFin );
-			info.alphaMaskTextureId = read_uint32_( aFin );
-			info.normalMapTextureId = read_uint32_( aFin );
-			info.emissiveTextureId = read_uint32_( aFin );
+			info.baseColorTextureId = in.u32();
+			info.roughnessTextureId = in.u32();
+			info.metalnessTextureId = in.u32();
+			info.alphaMaskTextureId = in.u32();
+			info.normalMapTextureId = in.u32();
+			info.emissiveTextureId = in.u32();
 
 			assert( info.baseColorTextureId < ret.textures.size() );
 			assert( info.roughnessTextureId < ret.textures.size() );
@@ -132,44 +880,69 @@ namespace
 		}
 
 		// Read mesh data
-		auto const meshCount = read_uint32_( aFin );
+		auto const meshCount = in.u32();
+		ret.meshes.reserve( meshCount );
 		for( std::uint32_t i = 0; i < meshCount; ++i )
 		{
-			BakedMeshData data;
-			data.materialId = read_uint32_( aFin );
+			MappedBakedMeshData data;
+			data.materialId = in.u32();
 			assert( data.materialId < ret.materials.size() );
 
-			auto const V = read_uint32_( aFin );
-			auto const I = read_uint32_( aFin );
+			auto const V = in.u32();
+			auto const I = in.u32();
 
-			data.positions.resize( V );
-			checked_read_( aFin, V*sizeof(glm::vec3), data.positions.data() );
+			data.vertexCount = V;
+			data.indexCount = I;
 
-			data.normals.resize( V );
-			checked_read_( aFin, V*sizeof(glm::vec3), data.normals.data() );
+			data.indexSize = in.u32();
+			if( sizeof(std::uint16_t) != data.indexSize && sizeof(std::uint32_t) != data.indexSize )
+				throw lut::Error( "load_baked_model_(): %s: mesh %u has invalid index size %u", aInputName, i, data.indexSize );
 
-			data.texcoords.resize( V );
-			checked_read_( aFin, V*sizeof(glm::vec2), data.texcoords.data() );
+			data.positionScale = in.value<glm::vec3>();
+			data.positionBias = in.value<glm::vec3>();
 
-			data.tangents.resize(V);
-			checked_read_(aFin, V * sizeof(glm::vec4), data.tangents.data());
+			data.positions = in.bytes( std::size_t(V)*sizeof(glm::u16vec4) );
+			data.texcoords = in.bytes( std::size_t(V)*sizeof(glm::u16vec2) );
+			data.tangentsComp = in.bytes( std::size_t(V)*sizeof(std::uint32_t) );
 
-			data.tangentsComp.resize(V);
-			checked_read_(aFin, V * sizeof(std::uint32_t), data.tangentsComp.data());
+			data.indices = in.bytes( std::size_t(I)*data.indexSize );
+			if( sizeof(std::uint16_t) == data.indexSize && 0 != I%2 )
+				in.bytes( sizeof(std::uint16_t) ); // Padded to a multiple of 4 bytes
 
-			data.indices.resize( I );
-			checked_read_( aFin, I*sizeof(std::uint32_t), data.indices.data() );
+			auto const L = in.u32();
+			copy_out_( data.lods, in.bytes( std::size_t(L)*sizeof(BakedMeshLod) ) );
+			check_lods_( data, aInputName, i );
 
 			ret.meshes.emplace_back( std::move(data) );
 		}
 
+		// Read meshlet data
+		for( auto& data : ret.meshes )
+		{
+			auto const K = in.u32();
+			auto const MV = in.u32();
+			auto const MT = in.u32();
+
+			data.meshletCount = K;
+			data.meshlets = in.bytes( std::size_t(K)*sizeof(BakedMeshlet) );
+			data.meshletVertices = in.bytes( std::size_t(MV)*sizeof(std::uint32_t) );
+			data.meshletTriangles = in.bytes( 3*std::size_t(MT)*sizeof(std::uint8_t) );
+		}
+
 		// Check
-		char byte;
-		auto const check = std::fread( &byte, 1, 1, aFin );
-		
-		if( 0 != check )
+		if( 0 != in.remaining() )
 			std::fprintf( stderr, "Note: '%s' contains trailing bytes\n", aInputName );
+	}
 
-		return ret;
+	void check_lods_( MappedBakedMeshData const& aData, char const* aInputName, std::uint32_t aMesh )
+	{
+		if( aData.lods.empty() )
+			throw lut::Error( "load_baked_model_(): %s: mesh %u has no levels of detail", aInputName, aMesh );
+
+		for( auto const& lod : aData.lods )
+		{
+			if( std::uint64_t(lod.firstIndex) + lod.indexCount > aData.indexCount )
+				throw lut::Error( "load_baked_model_(): %s: mesh %u has a level of detail outside of its indices", aInputName, aMesh );
+		}
 	}
 }
@@ -1,32 +1,45 @@
 #ifndef BAKED_MODEL_HPP_7D7BFF3A_1743_43DF_8D4F_D67D80FD8282
 #define BAKED_MODEL_HPP_7D7BFF3A_1743_43DF_8D4F_D67D80FD8282
 
+#include <span>
 #include <string>
 #include <vector>
 
+#include <cstddef>
 #include <cstdint>
 
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
+#include <glm/gtc/type_precision.hpp>
 
 
 /* Baked file format:
  *
  *  1. Header:
  *    - 16*char: file magic = "\0\0COMP5892Mmesh"
- *    - 16*char: variant = "default" (changes later)
+ *    - 16*char: variant = "28-toc"
+ *    - 1*uint32_t: T = number of (unique) textures
+ *    - 1*uint32_t: M = number of materials
+ *    - 1*uint32_t: N = number of meshes
+ *    - 1*uint32_t: flags; bit 0 = mesh payloads are zstd compressed (see
+ *                  below)
+ *
+ *  2. Table of contents
+ *    - repeat T + 1 + N times: BakedTocEntry (offset and size of a payload)
+ *      - T entries: one per texture
+ *      - 1 entry: material block
+ *      - N entries: one per mesh
  *
- *  2. Textures
- *    - 1*uint32_t: U = number of (unique) textures
- *    - repeat U times:
+ *  3. Payloads, each starting at a multiple of 64 bytes. The payloads are
+ *     independent of each other; any of them can be read on its own.
+ *
+ *    Texture payload:
  *      - string: path to texture
  *      - 1*uint8_t: texture color space (see ETextureSpace)
  *      - 1*uint8_t: number of channels in texture
  *
- *  3. Material information
- *    - 1*uint32_t: M = number of materials
- *    - repeat M times:
+ *    Material block (M times BakedMaterialInfo, tightly packed):
  *      - uint32_t: base color texture index
  *      - uint32_t: roughness texture index
  *      - uint32_t: metalness texture index
@@ -34,16 +47,31 @@
  *      - uint32_t: normal map texture index; set to 0xffffffff if not available
  *      - uint32_t: emissive texture index;
  *
- *  4. Mesh data
- *    - 1*uint32_t: M = number of meshes
- *    - repeat M times:
- *      - uint32_t : material index
- *      - uint32_t : V = number of vertices
- *      - uint32_t : I = number of indices
- *      - repeat V times: vec3 position
- *      - repeat V times: vec3 normal
- *      - repeat V times: vec2 texture coordinate
- *      - repeat I times: uint32_t index
+ *    Mesh payload:
+ *      - BakedMeshHeader (counts V, I, S, L, K, MV, MT; see below)
+ *      - followed by these arrays, each starting at a multiple of 16 bytes:
+ *        - repeat V times: 4*uint16_t position (unorm, see BakedMeshData)
+ *        - repeat V times: 2*uint16_t texture coordinate (half float)
+ *        - repeat V times: uint32_t packed TBN quaternion (A2R10G10B10)
+ *        - repeat I times: uint16_t (S = 2) or uint32_t (S = 4) index
+ *        - repeat L times: BakedMeshLod
+ *        - repeat K times: BakedMeshlet
+ *        - repeat MV times: uint32_t mesh vertex index
+ *        - repeat MT times: 3*uint8_t meshlet-local vertex index
+ *
+ * If flag bit 0 is set, each mesh payload is instead a single zstd frame
+ * (the TOC lists the compressed size). Before compression, each of the
+ * arrays was byte-shuffled with its component size as lane size (e.g. 2
+ * for positions and texture coordinates); see decode_mesh_() in
+ * baked_model.cpp.
+ *
+ * The older variant "26-index16" stores the same data sequentially, without
+ * table of contents and alignment (all meshes first, then the meshlets of all
+ * meshes). The loader still accepts it. Variant "27-toc" has the same layout
+ * as "28-toc". In files of both older variants,
+ * the position bias and scale (which the renderer uses as culling bounds)
+ * may be larger than the mesh. Positions still decode exactly; the loader
+ * prints a note suggesting a re-bake.
  *
  * Strings are stored as
  *   - 1*uint32_t: N = length of string in chars, including terminating \0
@@ -94,17 +122,103 @@ struct BakedMaterialInfo
 	std::uint32_t emissiveTextureId; // May be set to 0xffffffff if no emissive map
 };
 
+struct BakedMeshlet
+{
+	// Range in BakedMeshData::meshletVertices
+	std::uint32_t vertexOffset;
+	std::uint32_t vertexCount;
+
+	// Range in BakedMeshData::meshletTriangles, in triangles. Meshlets are
+	// made from consecutive triangles, so indices [3*triangleOffset, 
+	// 3*(triangleOffset+triangleCount)) of BakedMeshData::indices describe
+	// the same triangles. This allows drawing individual meshlets with the
+	// regular index buffer.
+	std::uint32_t triangleOffset;
+	std::uint32_t triangleCount;
+
+	// Bounding sphere
+	glm::vec3 center;
+	float radius;
+
+	// Normal cone: the meshlet is back-facing when seen from V if 
+	//   dot( normalize(coneApex - V), coneAxis ) >= coneCutoff
+	glm::vec3 coneApex;
+	glm::vec3 coneAxis;
+	float coneCutoff;
+};
+
+static_assert( sizeof(BakedMeshlet) == 15*sizeof(std::uint32_t), "BakedMeshlet is read directly from the file" );
+
+struct BakedMeshLod
+{
+	// Range in BakedMeshData::indices. Level zero is the full detail mesh
+	// and starts at index zero; coarser levels follow and reuse the same
+	// vertices.
+	std::uint32_t firstIndex;
+	std::uint32_t indexCount;
+
+	// Simplification error in model units. Non-decreasing along the chain.
+	float error;
+};
+
+static_assert( sizeof(BakedMeshLod) == 3*sizeof(std::uint32_t), "BakedMeshLod is read directly from the file" );
+
+struct BakedTocEntry
+{
+	// Offset from the start of the file and size of a payload, in bytes
+	std::uint64_t offset;
+	std::uint64_t size;
+};
+
+static_assert( sizeof(BakedTocEntry) == 16, "BakedTocEntry is read directly from the file" );
+
+struct BakedMeshHeader
+{
+	std::uint32_t materialId;
+	std::uint32_t vertexCount;
+	std::uint32_t indexCount;
+	std::uint32_t indexSize; // in bytes, 2 or 4
+	std::uint32_t lodCount;
+	std::uint32_t meshletCount;
+	std::uint32_t meshletVertexCount;
+	std::uint32_t meshletTriangleCount;
+
+	float positionScale[3];
+	float positionBias[3];
+
+	std::uint32_t reserved[2];
+};
+
+static_assert( sizeof(BakedMeshHeader) == 64, "BakedMeshHeader is read directly from the file" );
+static_assert( sizeof(BakedMaterialInfo) == 6*sizeof(std::uint32_t), "BakedMaterialInfo is read directly from the file" );
+
 struct BakedMeshData
 {
 	std::uint32_t materialId;
 
-	std::vector<glm::vec3> positions;
-	std::vector<glm::vec2> texcoords;
-	std::vector<glm::vec3> normals;
-	std::vector<glm::vec4> tangents;
+	// Positions are stored as 16-bit unorm values relative to the mesh's
+	// AABB. The model space position is
+	//   positionBias + positionScale * vec3(positions[i]) / 65535
+	// Binding the positions as VK_FORMAT_R16G16B16A16_UNORM performs the
+	// division; the fourth component is padding.
+	glm::vec3 positionScale;
+	glm::vec3 positionBias;
+
+	std::vector<glm::u16vec4> positions;
+	std::vector<glm::u16vec2> texcoords; // half floats
 	std::vector<std::uint32_t> tangentsComp;
 
+	// Meshes with at most 65536 vertices use 16-bit indices, others 32-bit
+	// indices. Only the vector matching indexSize is filled.
+	std::uint32_t indexSize; // in bytes, 2 or 4
+	std::vector<std::uint16_t> indices16;
 	std::vector<std::uint32_t> indices;
+
+	std::vector<BakedMeshLod> lods;
+
+	std::vector<BakedMeshlet> meshlets;
+	std::vector<std::uint32_t> meshletVertices;
+	std::vector<std::uint8_t> meshletTriangles; // 3 per triangle
 };
 
 struct BakedModel
@@ -116,5 +230,85 @@ struct BakedModel
 
 BakedModel load_baked_model( char const* aModelPath );
 
+
+// Zero-copy alternative to load_baked_model(). The file is memory mapped and
+// the per-mesh arrays are views into the mapping instead of owning vectors,
+// so they can be copied straight into (staging) buffers. The views remain
+// valid for as long as the MappedBakedModel is alive.
+//
+// Arrays in older (sequential) files are not necessarily aligned, so the views
+// are raw bytes; use std::memcpy() rather than casting them to the element
+// type. The element types and counts are the same as in BakedMeshData.
+class BakedFileMapping
+{
+	public:
+		BakedFileMapping() noexcept, ~BakedFileMapping();
+
+		explicit BakedFileMapping( char const* aPath );
+
+		BakedFileMapping( BakedFileMapping const& ) = delete;
+		BakedFileMapping& operator= (BakedFileMapping const&) = delete;
+
+		BakedFileMapping( BakedFileMapping&& ) noexcept;
+		BakedFileMapping& operator = (BakedFileMapping&&) noexcept;
+
+	public:
+		std::span<std::byte const> bytes() const noexcept;
+
+	private:
+		void const* mData = nullptr;
+		std::size_t mSize = 0;
+};
+
+struct MappedBakedMeshData
+{
+	std::uint32_t materialId;
+
+	glm::vec3 positionScale;
+	glm::vec3 positionBias;
+
+	std::uint32_t vertexCount;
+	std::uint32_t indexCount;
+	std::uint32_t indexSize; // in bytes, 2 or 4
+
+	std::span<std::byte const> positions;    // vertexCount * glm::u16vec4
+	std::span<std::byte const> texcoords;    // vertexCount * glm::u16vec2
+	std::span<std::byte const> tangentsComp; // vertexCount * std::uint32_t
+	std::span<std::byte const> indices;      // indexCount * indexSize (no padding)
+
+	std::vector<BakedMeshLod> lods; // small, copied out of the mapping
+
+	std::uint32_t meshletCount;
+	std::span<std::byte const> meshlets;         // meshletCount * BakedMeshlet
+	std::span<std::byte const> meshletVertices;  // std::uint32_t each
+	std::span<std::byte const> meshletTriangles; // 3*std::uint8_t each
+};
+
+struct MappedBakedModel
+{
+	BakedFileMapping file;
+
+	std::vector<BakedTextureInfo> textures;
+	std::vector<BakedMaterialInfo> materials;
+	std::vector<MappedBakedMeshData> meshes;
+
+	// Location of each mesh's payload in the file. Empty for the older
+	// sequential variants, which have no table of contents.
+	std::vector<BakedTocEntry> meshPayloads;
+
+	// Decompressed mesh payloads, for files with compressed meshes. The
+	// views in meshes refer to these instead of the mapping in that case.
+	std::vector<std::vector<std::byte>> decodedMeshes;
+};
+
+MappedBakedModel load_baked_model_mapped( char const* aModelPath );
+
+
+// Same result as load_baked_model(), but the mesh payloads are read (with
+// positional reads, no shared file position), validated and decoded by
+// aThreadCount threads in parallel (0 = number of hardware threads). Needs
+// the table of contents; files without one are loaded sequentially.
+BakedModel load_baked_model_parallel( char const* aModelPath, std::size_t aThreadCount = 0 );
+
 #endif // BAKED_MODEL_HPP_7D7BFF3A_1743_43DF_8D4F_D67D80FD8282
 
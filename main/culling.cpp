@@ -0,0 +1,152 @@
+#include "culling.hpp"
+
+#include <bit>
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define CULLING_SSE_ 1
+#	include <emmintrin.h>
+#endif
+
+MeshBounds make_mesh_bounds(const std::vector<glm::vec3>& aMin, const std::vector<glm::vec3>& aMax) {
+	assert(aMin.size() == aMax.size());
+
+	MeshBounds ret;
+	ret.count = aMin.size();
+
+	const std::size_t padded = (ret.count + MeshBounds::kCullBatchSize - 1) / MeshBounds::kCullBatchSize * MeshBounds::kCullBatchSize;
+	for (auto* array : { &ret.centerX, &ret.centerY, &ret.centerZ, &ret.extentX, &ret.extentY, &ret.extentZ })
+		array->resize(padded, 0.0f);
+
+	for (std::size_t i = 0; i < ret.count; ++i) {
+		const glm::vec3 center = 0.5f * (aMin[i] + aMax[i]);
+		const glm::vec3 extent = 0.5f * (aMax[i] - aMin[i]);
+
+		ret.centerX[i] = center.x;
+		ret.centerY[i] = center.y;
+		ret.centerZ[i] = center.z;
+		ret.extentX[i] = extent.x;
+		ret.extentY[i] = extent.y;
+		ret.extentZ[i] = extent.z;
+	}
+
+	return ret;
+}
+
+Frustum make_frustum(const glm::mat4& aProjView) {
+	// Rows of the matrix (glm is column major)
+	const glm::vec4 row0(aProjView[0][0], aProjView[1][0], aProjView[2][0], aProjView[3][0]);
+	const glm::vec4 row1(aProjView[0][1], aProjView[1][1], aProjView[2][1], aProjView[3][1]);
+	const glm::vec4 row2(aProjView[0][2], aProjView[1][2], aProjView[2][2], aProjView[3][2]);
+	const glm::vec4 row3(aProjView[0][3], aProjView[1][3], aProjView[2][3], aProjView[3][3]);
+
+	Frustum ret;
+	ret.planes[0] = row3 + row0; // left
+	ret.planes[1] = row3 - row0; // right
+	ret.planes[2] = row3 + row1; // bottom (top, with a flipped y axis)
+	ret.planes[3] = row3 - row1; // top
+	ret.planes[4] = row2;        // near, z >= 0
+	ret.planes[5] = row3 - row2; // far
+	return ret;
+}
+
+void cull_frustum(const MeshBounds& aBounds, const Frustum& aFrustum, std::vector<std::uint32_t>& aVisible) {
+	// A box is outside if it is entirely behind any of the planes, i.e., if
+	//   dot(n, center) + w + dot(abs(n), extent) < 0
+	const std::size_t padded = aBounds.centerX.size();
+
+#	if CULLING_SSE_
+	__m128 nx[6], ny[6], nz[6], nw[6], ax[6], ay[6], az[6];
+	for (std::size_t p = 0; p < 6; ++p) {
+		const auto& plane = aFrustum.planes[p];
+		nx[p] = _mm_set1_ps(plane.x);
+		ny[p] = _mm_set1_ps(plane.y);
+		nz[p] = _mm_set1_ps(plane.z);
+		nw[p] = _mm_set1_ps(plane.w);
+		ax[p] = _mm_set1_ps(std::abs(plane.x));
+		ay[p] = _mm_set1_ps(std::abs(plane.y));
+		az[p] = _mm_set1_ps(std::abs(plane.z));
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+
+	static_assert(MeshBounds::kCullBatchSize == 4, "SSE kernel tests four boxes at a time");
+	for (std::size_t i = 0; i < padded; i += 4) {
+		const __m128 cx = _mm_loadu_ps(aBounds.centerX.data() + i);
+		const __m128 cy = _mm_loadu_ps(aBounds.centerY.data() + i);
+		const __m128 cz = _mm_loadu_ps(aBounds.centerZ.data() + i);
+		const __m128 ex = _mm_loadu_ps(aBounds.extentX.data() + i);
+		const __m128 ey = _mm_loadu_ps(aBounds.extentY.data() + i);
+		const __m128 ez = _mm_loadu_ps(aBounds.extentZ.data() + i);
+
+		__m128 outside = zero;
+		for (std::size_t p = 0; p < 6; ++p) {
+			const __m128 dist = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)),
+				_mm_add_ps(_mm_mul_ps(nz[p], cz), nw[p])
+			);
+			const __m128 radius = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)),
+				_mm_mul_ps(az[p], ez)
+			);
+
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(dist, radius), zero));
+		}
+
+		for (unsigned visible = ~unsigned(_mm_movemask_ps(outside)) & 0xfu; visible; visible &= visible - 1) {
+			const std::size_t index = i + std::countr_zero(visible);
+			if (index < aBounds.count)
+				aVisible.emplace_back(std::uint32_t(index));
+		}
+	}
+#	else // !CULLING_SSE_
+	for (std::size_t i = 0; i < padded && i < aBounds.count; ++i) {
+		bool outside = false;
+		for (const auto& plane : aFrustum.planes) {
+			const float dist = plane.x * aBounds.centerX[i] + plane.y * aBounds.centerY[i] + plane.z * aBounds.centerZ[i] + plane.w;
+			const float radius = std::abs(plane.x) * aBounds.extentX[i] + std::abs(plane.y) * aBounds.extentY[i] + std::abs(plane.z) * aBounds.extentZ[i];
+
+			outside = outside || dist + radius < 0.0f;
+		}
+
+		if (!outside)
+			aVisible.emplace_back(std::uint32_t(i));
+	}
+#	endif // ~ CULLING_SSE_
+}
+
+void cull_shadow_casters(const MeshBounds& aBounds, const Frustum& aReceivers, const glm::vec3& aLightPos, float aRange, std::vector<std::uint32_t>& aCasters) {
+	const auto outside = [](const glm::vec4& aPlane, const glm::vec3& aCenter, const glm::vec3& aExtent) {
+		return glm::dot(glm::vec3(aPlane), aCenter) + aPlane.w + glm::dot(glm::abs(glm::vec3(aPlane)), aExtent) < 0.0f;
+	};
+
+	const auto end = std::remove_if(aCasters.begin(), aCasters.end(), [&](std::uint32_t aIndex) {
+		const glm::vec3 center(aBounds.centerX[aIndex], aBounds.centerY[aIndex], aBounds.centerZ[aIndex]);
+		const glm::vec3 extent(aBounds.extentX[aIndex], aBounds.extentY[aIndex], aBounds.extentZ[aIndex]);
+
+		const glm::vec3 toBox = center - aLightPos;
+		const float distance = glm::length(toBox);
+		if (distance <= glm::length(extent))
+			return false;
+
+		// The shadow of a point q in the box reaches at most this far from
+		// the light, so it lies within L + t*(q - L) for t up to reach over
+		// |q - L|. The closest point of the box is at least distance -
+		// |extent| away, so this scale bounds the shadow of the whole box.
+		const float reach = aRange * kShadowReachFactor;
+		const float scale = std::max(reach / std::max(distance - glm::length(extent), 1e-4f), 1.0f);
+		const glm::vec3 farCenter = aLightPos + toBox * scale;
+		const glm::vec3 farExtent = extent * scale;
+
+		for (const auto& plane : aReceivers.planes) {
+			if (outside(plane, center, extent) && outside(plane, farCenter, farExtent))
+				return true;
+		}
+
+		return false;
+	});
+
+	aCasters.erase(end, aCasters.end());
+}
@@ -0,0 +1,57 @@
+#ifndef CULLING_HPP_9E3A1C57_4B2D_4F80_A6C4_1D7E5B0F2C93
+#define CULLING_HPP_9E3A1C57_4B2D_4F80_A6C4_1D7E5B0F2C93
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// Axis aligned bounding boxes of all meshes, stored as centre and half extent
+// in structure of arrays layout. The arrays are padded to a multiple of
+// kCullBatchSize boxes, so that the culling kernel only deals with full
+// batches. Padding boxes are never reported as visible.
+struct MeshBounds {
+	static constexpr std::size_t kCullBatchSize = 4;
+
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+	std::size_t count = 0;
+};
+
+MeshBounds make_mesh_bounds(const std::vector<glm::vec3>& aMin, const std::vector<glm::vec3>& aMax);
+
+// Frustum planes (xyz: inward facing normal, w: offset), extracted from a
+// projection * view matrix with Vulkan's 0 <= z <= w clip space. The planes
+// are not normalised; the tests below don't need them to be.
+struct Frustum {
+	glm::vec4 planes[6];
+};
+
+Frustum make_frustum(const glm::mat4& aProjView);
+
+// Append the indices of all meshes whose box intersects the frustum to
+// aVisible, in increasing order. The test is conservative: boxes that are
+// outside the frustum but straddle two planes near a corner are kept.
+//
+// Uses SSE when available (four boxes per iteration), scalar code otherwise.
+void cull_frustum(const MeshBounds&, const Frustum&, std::vector<std::uint32_t>& aVisible);
+
+// Farthest reach of the shadow map frustum from the light, per unit of its far
+// plane distance. The frustum is a square 90 degree perspective, so its far
+// corners are at far * sqrt(1 + 2*tan^2(45 deg)) = far * sqrt(3). Keep in
+// sync with kShadowReachFactor in cull.comp.
+constexpr float kShadowReachFactor = 1.7320508f;
+
+// Remove the shadow casters from aCasters whose shadow cannot reach the
+// receiver frustum, for a light at aLightPos whose shadow map frustum has its
+// far plane at aRange (so shadows reach up to kShadowReachFactor * aRange
+// away). A caster's shadow lies within the hull of its box and the box scaled
+// about the light until the box's nearest point reaches that distance; the
+// hull is outside the frustum if both boxes are outside the same plane.
+// Casters whose box may contain the light are kept. Same test as
+// shadow_outside_camera() in cull.comp.
+void cull_shadow_casters(const MeshBounds&, const Frustum& aReceivers, const glm::vec3& aLightPos, float aRange, std::vector<std::uint32_t>& aCasters);
+
+#endif // CULLING_HPP_9E3A1C57_4B2D_4F80_A6C4_1D7E5B0F2C93
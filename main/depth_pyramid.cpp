@@ -0,0 +1,182 @@
+#include "depth_pyramid.hpp"
+
+#include <algorithm>
+
+#include <cstdint>
+
+#include "../utils/error.hpp"
+#include "../utils/vkutil.hpp"
+#include "../utils/to_string.hpp"
+namespace lut = labutils;
+
+namespace {
+	// Matches local_size in depthPyramid.comp
+	constexpr std::uint32_t kGroupSize = 8;
+
+	std::uint32_t level_size(std::uint32_t aBaseSize, std::uint32_t aLevel) {
+		return std::max(aBaseSize >> aLevel, 1u);
+	}
+}
+
+lut::DescriptorSetLayout create_depth_pyramid_descriptor_layout(const lut::VulkanContext& aContext) {
+	VkDescriptorSetLayoutBinding bindings[2]{};
+	bindings[0].binding = 0;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[0].descriptorCount = 1;
+	bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	bindings[1].binding = 1;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	bindings[1].descriptorCount = 1;
+	bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = sizeof(bindings) / sizeof(bindings[0]);
+	layoutInfo.pBindings = bindings;
+
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	if (const auto res = vkCreateDescriptorSetLayout(aContext.device, &layoutInfo, nullptr, &layout); VK_SUCCESS != res)
+		throw lut::Error("Unable to create descriptor set layout\n vkCreateDescriptorSetLayout() returned %s", lut::to_string(res).c_str());
+
+	return lut::DescriptorSetLayout(aContext.device, layout);
+}
+
+DepthPyramid create_depth_pyramid(
+	const lut::VulkanContext& aContext,
+	const lut::Allocator& aAllocator,
+	VkExtent2D aDepthExtent,
+	VkImageView aDepthView,
+	VkSampler aPointSampler,
+	VkDescriptorPool aPool,
+	VkDescriptorSetLayout aLayout
+) {
+	DepthPyramid ret;
+	ret.extent.width = std::max(aDepthExtent.width / 2, 1u);
+	ret.extent.height = std::max(aDepthExtent.height / 2, 1u);
+
+	const auto levels = lut::compute_mip_level_count(ret.extent.width, ret.extent.height);
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = kDepthPyramidFormat;
+	imageInfo.extent.width = ret.extent.width;
+	imageInfo.extent.height = ret.extent.height;
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = levels;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	VmaAllocationCreateInfo allocInfo{};
+	allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+	VkImage image = VK_NULL_HANDLE;
+	VmaAllocation allocation = VK_NULL_HANDLE;
+
+	if (const auto res = vmaCreateImage(aAllocator.allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr); VK_SUCCESS != res)
+		throw lut::Error("Unable to allocate depth pyramid image.\n vmaCreateImage() returned %s", lut::to_string(res).c_str());
+
+	ret.image = lut::Image(aAllocator.allocator, image, allocation);
+
+	const auto create_view = [&](std::uint32_t aBaseLevel, std::uint32_t aLevelCount) {
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = ret.image.image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = kDepthPyramidFormat;
+		viewInfo.components = VkComponentMapping{};
+		viewInfo.subresourceRange = VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, aBaseLevel, aLevelCount, 0, 1 };
+
+		VkImageView view = VK_NULL_HANDLE;
+		if (const auto res = vkCreateImageView(aContext.device, &viewInfo, nullptr, &view); VK_SUCCESS != res)
+			throw lut::Error("Unable to create image view.\n vkCreateImageView() returned %s", lut::to_string(res).c_str());
+
+		return lut::ImageView(aContext.device, view);
+	};
+
+	ret.view = create_view(0, levels);
+
+	for (std::uint32_t level = 0; level < levels; ++level) {
+		ret.levelViews.emplace_back(create_view(level, 1));
+
+		VkDescriptorSet descriptor = lut::alloc_desc_set(aContext, aPool, aLayout);
+		{
+			VkWriteDescriptorSet desc[2]{};
+
+			VkDescriptorImageInfo sourceInfo{};
+			sourceInfo.sampler = aPointSampler;
+			sourceInfo.imageView = 0 == level ? aDepthView : ret.levelViews[level - 1].handle;
+			sourceInfo.imageLayout = 0 == level ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+
+			desc[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			desc[0].dstSet = descriptor;
+			desc[0].dstBinding = 0;
+			desc[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			desc[0].descriptorCount = 1;
+			desc[0].pImageInfo = &sourceInfo;
+
+			VkDescriptorImageInfo levelInfo{};
+			levelInfo.imageView = ret.levelViews[level].handle;
+			levelInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+			desc[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			desc[1].dstSet = descriptor;
+			desc[1].dstBinding = 1;
+			desc[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			desc[1].descriptorCount = 1;
+			desc[1].pImageInfo = &levelInfo;
+
+			constexpr auto numSets = sizeof(desc) / sizeof(desc[0]);
+			vkUpdateDescriptorSets(aContext.device, numSets, desc, 0, nullptr);
+		}
+
+		ret.levelDescriptors.emplace_back(descriptor);
+	}
+
+	return ret;
+}
+
+void record_depth_pyramid(VkCommandBuffer aCmdBuff, const DepthPyramid& aPyramid, VkPipeline aPipeline, VkPipelineLayout aPipelineLayout) {
+	const auto levels = std::uint32_t(aPyramid.levelViews.size());
+
+	// The previous contents are not needed
+	lut::image_barrier(
+		aCmdBuff,
+		aPyramid.image.image,
+		VK_ACCESS_SHADER_READ_BIT,
+		VK_ACCESS_SHADER_WRITE_BIT,
+		VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_GENERAL,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, levels, 0, 1 }
+	);
+
+	vkCmdBindPipeline(aCmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, aPipeline);
+
+	for (std::uint32_t level = 0; level < levels; ++level) {
+		vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, aPipelineLayout, 0, 1, &aPyramid.levelDescriptors[level], 0, nullptr);
+
+		const auto width = level_size(aPyramid.extent.width, level);
+		const auto height = level_size(aPyramid.extent.height, level);
+		vkCmdDispatch(aCmdBuff, (width + kGroupSize - 1) / kGroupSize, (height + kGroupSize - 1) / kGroupSize, 1);
+
+		// Each level is read by the next one, and all of them by the culling
+		lut::image_barrier(
+			aCmdBuff,
+			aPyramid.image.image,
+			VK_ACCESS_SHADER_WRITE_BIT,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 }
+		);
+	}
+}
@@ -0,0 +1,52 @@
+#ifndef DEPTH_PYRAMID_HPP_5C1F8A3E_7D24_4B69_9E0A_2F6B3D8C1E47
+#define DEPTH_PYRAMID_HPP_5C1F8A3E_7D24_4B69_9E0A_2F6B3D8C1E47
+
+#include <vector>
+
+#include <volk/volk.h>
+
+#include "../utils/vkimage.hpp"
+#include "../utils/vkobject.hpp"
+#include "../utils/allocator.hpp"
+#include "../utils/vulkan_context.hpp"
+
+// Hierarchical depth buffer for occlusion culling. Level 0 has half the
+// resolution of the depth buffer, and each level halves the previous one
+// (rounding down). A texel holds the farthest depth of the texels it covers
+// in the level above (the depth buffer for level 0). The last texel of each
+// row and column also covers the texel left over by rounding down, so depth
+// pixel d maps to texel min(d >> (level+1), size-1) of a level.
+struct DepthPyramid {
+	labutils::Image image;
+	labutils::ImageView view; // All levels, for sampling
+
+	// Per level views (sampled and storage), and the descriptor sets that
+	// reduce level i-1 (the depth buffer for level 0) into level i
+	std::vector<labutils::ImageView> levelViews;
+	std::vector<VkDescriptorSet> levelDescriptors;
+
+	VkExtent2D extent; // Of level 0
+};
+
+constexpr VkFormat kDepthPyramidFormat = VK_FORMAT_R32_SFLOAT;
+
+// Binding 0: source (sampler), 1: destination level (storage image)
+labutils::DescriptorSetLayout create_depth_pyramid_descriptor_layout(const labutils::VulkanContext&);
+
+DepthPyramid create_depth_pyramid(
+	const labutils::VulkanContext&,
+	const labutils::Allocator&,
+	VkExtent2D aDepthExtent,
+	VkImageView aDepthView,
+	VkSampler aPointSampler,
+	VkDescriptorPool,
+	VkDescriptorSetLayout
+);
+
+// Record the reduction of the depth buffer into all levels. The depth buffer
+// must be in VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, with its writes
+// made visible to compute shaders. Leaves the pyramid in VK_IMAGE_LAYOUT_GENERAL,
+// readable by compute shaders.
+void record_depth_pyramid(VkCommandBuffer, const DepthPyramid&, VkPipeline, VkPipelineLayout);
+
+#endif // DEPTH_PYRAMID_HPP_5C1F8A3E_7D24_4B69_9E0A_2F6B3D8C1E47
@@ -1,10 +1,14 @@
 #include <tuple>
+#include <thread>
 #include <chrono>
 #include <limits>
 #include <vector>
+#include <numeric>
+#include <optional>
 #include <stdexcept>
 #include <iostream>
 
+#include <cmath>
 #include <cstdio>
 #include <cassert>
 #include <cstddef>
@@ -13,6 +17,11 @@
 
 #include <algorithm>
 
+#if !defined(_WIN32)
+#	include <fcntl.h>
+#	include <unistd.h>
+#endif
+
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 
@@ -40,6 +49,9 @@ using namespace labutils::literals;
 namespace lut = labutils;
 
 #include "baked_model.hpp"
+#include "culling.hpp"
+#include "depth_pyramid.hpp"
+#include "upload_batch.hpp"
 
 // Anonymous namespace
 namespace
@@ -71,6 +83,8 @@ namespace
 		constexpr const char* kDefShadingFragShaderPath = "assets/main/shaders/deferredShading.frag.spv";
 		constexpr const char* kShadowOffscreenVertShaderPath = "assets/main/shaders/shadowOffscreen.vert.spv";
 		constexpr const char* kShadowOffscreenFragShaderPath = "assets/main/shaders/shadowOffscreen.frag.spv";
+		constexpr const char* kCullCompShaderPath = "assets/main/shaders/cull.comp.spv";
+		constexpr const char* kDepthPyramidCompShaderPath = "assets/main/shaders/depthPyramid.comp.spv";
 
 		constexpr float kCameraNear = 0.1f;
 		constexpr float kCameraFar = 100.f;
@@ -84,6 +98,15 @@ namespace
 		constexpr float kCameraMouseSensitivity = 0.01f;
 
 		constexpr VkFormat kDepthFormat = VK_FORMAT_D32_SFLOAT_S8_UINT;
+
+		// Largest simplification error (in pixels) that is acceptable when picking a mesh's level of detail
+		constexpr float kLodPixelError = 1.0f;
+
+		// Timestamps per frame: start, culling done, end
+		constexpr std::uint32_t kTimestampsPerFrame = 3;
+
+		// Interval between the culling statistics printed to stdout
+		constexpr float kStatsInterval = 1.0f;
 	}
 
 	using Clock_ = std::chrono::steady_clock;
@@ -118,6 +141,11 @@ namespace
 		bool mosaicEffect = false;
 		bool deferredShading = false;
 		bool shadows = false;
+		bool frustumCulling = true;
+		bool gpuCulling = true;
+		bool occlusionCulling = true;
+		bool shadowCasterCulling = true; // Against the light's frustum
+		bool shadowReceiverCulling = false; // Drop casters whose shadow cannot reach the camera's frustum
 
 		bool wasMousing = false;
 
@@ -125,15 +153,121 @@ namespace
 	};
 
 	// Structures to more easily pass them to record commands function
+
+	// Vertex and index data of all meshes. There is one buffer per vertex attribute stream,
+	// so that passes which only need positions (shadows, overdraw) can keep binding just that.
+	// Meshes with 16-bit and 32-bit indices share the index buffer; a mesh's firstIndex is in
+	// units of its own index type.
+	struct SceneGeometry {
+		lut::Buffer positions;
+		lut::Buffer texcoords;
+		lut::Buffer tangents;
+		lut::Buffer indices;
+
+		// Per mesh data (glsl::MeshInstance), read by the vertex shaders with gl_InstanceIndex
+		lut::Buffer meshes;
+	};
+
 	struct MeshData {
-		lut::Buffer positionBuffer;
-		lut::Buffer texCoordBuffer;
-		lut::Buffer normalsBuffer;
-		lut::Buffer tangentsBuffer;
-		lut::Buffer indicesBuffer;
-		std::size_t indicesCount;
+		// Range in SceneGeometry
+		std::uint32_t firstIndex;
+		std::int32_t vertexOffset;
+		std::uint32_t indexCount;
+		VkIndexType indexType;
+		std::vector<BakedMeshLod> lods;
 		std::uint32_t materialId;
 		bool hasAlphaMask;
+
+		// Dequantisation of the 16-bit positions, see BakedMeshData
+		glm::vec3 positionScale;
+		glm::vec3 positionBias;
+
+		// Bounding sphere, used to estimate the distance for level of detail selection
+		glm::vec3 boundsCenter;
+		float boundsRadius;
+	};
+
+	// Meshes are sorted by (alpha mask, index type, material), so that the meshes drawn by a
+	// pipeline form a few contiguous ranges. Each batch is drawn by one vkCmdDrawIndexedIndirect().
+	// Materials are bindless, so they don't split batches; they are only sorted for locality.
+	struct DrawBatch {
+		bool hasAlphaMask;
+		VkIndexType indexType;
+		std::uint32_t firstMesh;
+		std::uint32_t meshCount;
+	};
+
+	// Range of indirect draw commands
+	struct DrawRange {
+		std::uint32_t firstCommand;
+		std::uint32_t commandCount;
+	};
+
+	// Culling results of the last recorded frame. With GPU culling, the counts are read back
+	// from an earlier frame, and no CPU time is spent on culling. culled includes occluded.
+	struct CullStats {
+		std::uint32_t visible;
+		std::uint32_t culled;
+		std::uint32_t occluded; // Of the culled meshes, those culled by occlusion (GPU only)
+		std::uint32_t shadowCasters; // Meshes in the shadow view, when the shadow map was last drawn
+		float cullMicroseconds;
+		bool onGpu;
+	};
+
+	// The shadow map only depends on the light and the (static) scene, so it is rendered once and
+	// reused until the light (or with receiver culling, the camera) moves or the swapchain is recreated
+	struct ShadowCache {
+		bool valid = false;
+		glm::mat4 depthMVP{}; // Light view-projection of the cached shadow map
+
+		// With receiver culling, the casters depend on the camera as well
+		bool receiverCulling = false;
+		glm::mat4 projCam{};
+	};
+
+	// Indirect draw state of the frame being recorded. The indirect buffers hold up to one command
+	// per mesh for each view (see EDrawView), compacted to the meshes visible in that view. Each
+	// command's firstInstance is the mesh index.
+	//
+	// With CPU culling, the commands are written to the mapped indirectBuffer. With GPU culling, 
+	// the cull compute shader writes them to culledCommandBuffer and counts the commands of each
+	// batch in drawCountBuffer (view * batches.size() + batch). The occluder view holds last frame's
+	// visible meshes, which are drawn into the depth buffer for occlusion culling (GPU only).
+	enum EDrawView : std::uint32_t {
+		kDrawViewCamera,
+		kDrawViewShadow,
+		kDrawViewOccluders,
+		kDrawViewCount
+	};
+
+	// Variants of the cull compute shader (kPhase in cull.comp)
+	enum ECullPhase : std::uint32_t {
+		kCullPhaseSingle,
+		kCullPhaseEarly,
+		kCullPhaseLate
+	};
+
+	struct SceneDraws {
+		const std::vector<DrawBatch>& batches;
+		const MeshBounds& bounds;
+		VkBuffer indirectBuffer;
+		VmaAllocation indirectAllocation;
+		VkDrawIndexedIndirectCommand* commands; // Persistently mapped indirectBuffer
+		VmaAllocator allocator;
+		CullStats* stats;
+
+		VkBuffer culledCommandBuffer;
+		VkBuffer drawCountBuffer;
+		VmaAllocation drawCountAllocation;
+		const std::uint32_t* drawCounts; // Persistently mapped drawCountBuffer
+
+		// Occlusion culling, see cull.comp
+		const DepthPyramid& depthPyramid;
+		VkImage depthImage; // DdepthBuffer, which the pyramid is built from
+
+		// Timestamps of this frame (cfg::kTimestampsPerFrame from firstTimestamp), if supported
+		VkQueryPool timestamps;
+		std::uint32_t firstTimestamp;
 	};
 
 	struct RenderPasses {
@@ -143,6 +277,7 @@ namespace
 		VkRenderPass overVisualisationsRenderPass;
 		VkRenderPass deferredShadingRenderPass;
 		VkRenderPass shadowOffscreenRenderPass;
+		VkRenderPass depthPrepassRenderPass;
 	};
 
 	struct Framebuffers {
@@ -152,6 +287,7 @@ namespace
 		VkFramebuffer overVisualisationFramebuffer;
 		VkFramebuffer deferredShadingFramebuffer;
 		VkFramebuffer shadowOffscreenFramebuffer;
+		VkFramebuffer depthPrepassFramebuffer;
 	};
 
 	struct Pipelines {
@@ -166,6 +302,11 @@ namespace
 		VkPipeline gBufWritePipline;
 		VkPipeline deferredShadingPipeline;
 		VkPipeline shadowOffscreenPipeline;
+		VkPipeline cullPipeline;
+		VkPipeline cullEarlyPipeline;
+		VkPipeline cullLatePipeline;
+		VkPipeline depthPrepassPipeline;
+		VkPipeline depthPyramidPipeline;
 	};
 
 	struct UBOs {
@@ -174,6 +315,7 @@ namespace
 		VkBuffer debugUBO;
 		VkBuffer multipleLightsUBO;
 		VkBuffer depthMVPUBO;
+		VkBuffer cullUBO;
 	};
 
 	struct PipelineLayouts {
@@ -184,10 +326,12 @@ namespace
 		VkPipelineLayout gBufWritePipelineLayout;
 		VkPipelineLayout deferredShadingPipelineLayout;
 		VkPipelineLayout shadowOffscreenPipelineLayout;
+		VkPipelineLayout cullPipelineLayout;
+		VkPipelineLayout depthPyramidPipelineLayout;
 	};
 
 	struct DescriptorSets {
-		std::vector<VkDescriptorSet>& materialDescriptors;
+		VkDescriptorSet materialDescriptor;
 		VkDescriptorSet sceneDescriptors;
 		VkDescriptorSet lightDescriptor;
 		VkDescriptorSet debugDescriptor;
@@ -197,6 +341,7 @@ namespace
 		VkDescriptorSet multipleLightsDescriptor;
 		VkDescriptorSet depthMVPDescriptor;
 		VkDescriptorSet shadowMapDescriptor;
+		VkDescriptorSet cullDescriptor; // Of the current frame in flight
 	};
 
 	// Uniform data
@@ -226,9 +371,58 @@ namespace
 			glm::mat4 depthMVP;
 		};
 
+		// Per mesh data for all pipelines that draw the model (std430)
+		struct MeshInstance {
+			glm::vec4 positionScale;
+			glm::vec4 positionBias;
+			std::uint32_t materialId;
+			std::uint32_t pad_[3];
+		};
+
+		// Per material indices into the bindless texture array (std430)
+		struct MaterialInfo {
+			std::uint32_t baseColour;
+			std::uint32_t metalness;
+			std::uint32_t roughness;
+			std::uint32_t alphaMask;
+			std::uint32_t normalMap;
+		};
+
+		// Per frame data of the cull compute shader (std140)
+		struct CullUniform {
+			glm::mat4 projCam;
+			glm::vec4 planes[kDrawViewCount * 6];
+			glm::vec4 cameraPos;
+			glm::vec4 lightPos; // w: shadow map far plane, 0 without receiver culling
+			glm::vec2 depthSize;
+			float pixelsPerUnit;
+			float lodPixelError;
+			float cameraNear;
+			std::uint32_t meshCount;
+			std::uint32_t batchCount;
+			std::uint32_t cullMask;
+		};
+
+		// Static per mesh data of the cull compute shader (std430)
+		struct CullMesh {
+			glm::vec4 boundsCenter;
+			glm::vec4 boundsExtent;
+			glm::vec4 sphere;
+			std::uint32_t firstIndex;
+			std::int32_t vertexOffset;
+			std::uint32_t firstLod;
+			std::uint32_t lodCount;
+			std::uint32_t batch;
+			std::uint32_t batchFirstMesh;
+			std::uint32_t pad_[2];
+		};
+
 		static_assert(sizeof(SceneUniform) <= 65536, "SceneUniform must be less than 65536 bytes for vkCmdUpdateBuffer");
 		static_assert(sizeof(SceneUniform) % 4 == 0, "SceneUniform size must be a multiple of 4 bytes");
 		static_assert(sizeof(LightUniform) % 4 == 0, "LightUniform size must be a multiple of 4 bytes");
+		static_assert(sizeof(MeshInstance) % 16 == 0, "MeshInstance must match the std430 array stride");
+		static_assert(sizeof(CullUniform) <= 65536, "CullUniform must be less than 65536 bytes for vkCmdUpdateBuffer");
+		static_assert(sizeof(CullMesh) % 16 == 0, "CullMesh must match the std430 array stride");
 	}
 
 	struct Uniforms {
@@ -248,16 +442,18 @@ namespace
 	lut::RenderPass create_over_visualisations_render_pass(const lut::VulkanWindow&);
 	lut::RenderPass create_deferred_shading_render_pass(const lut::VulkanWindow&);
 	lut::RenderPass create_offscreen_shadow_render_pass(const lut::VulkanWindow&);
+	lut::RenderPass create_depth_prepass_render_pass(const lut::VulkanWindow&);
 
 	// Descriptor Set Layouts
 	lut::DescriptorSetLayout create_scene_descriptor_layout(const lut::VulkanWindow&);
-	lut::DescriptorSetLayout create_material_descriptor_layout(const lut::VulkanWindow&);
+	lut::DescriptorSetLayout create_material_descriptor_layout(const lut::VulkanWindow&, std::uint32_t);
 	lut::DescriptorSetLayout create_fragment_ubo_descriptor_layout(const lut::VulkanWindow&);
 	lut::DescriptorSetLayout create_vertex_ubo_descriptor_layout(const lut::VulkanWindow&);
 	lut::DescriptorSetLayout create_post_process_descriptor_layout(const lut::VulkanWindow&);
 	lut::DescriptorSetLayout create_over_visualisations_descriptor_layout(const lut::VulkanWindow&);
 	lut::DescriptorSetLayout create_deferred_shading_descriptor_layout(const lut::VulkanWindow&);
 	lut::DescriptorSetLayout create_fragment_image_layout(const lut::VulkanWindow&);
+	lut::DescriptorSetLayout create_cull_descriptor_layout(const lut::VulkanWindow&);
 
 	// Pipeline Layouts
 	lut::PipelineLayout create_pipeline_layout(const lut::VulkanWindow&, std::vector<VkDescriptorSetLayout>&);
@@ -270,6 +466,9 @@ namespace
 	std::tuple<lut::Pipeline, lut::Pipeline> create_over_visualisations_pipeline(const lut::VulkanWindow&, VkRenderPass, VkPipelineLayout, VkPipelineLayout);
 	std::tuple<lut::Pipeline, lut::Pipeline> create_deferred_shading_pipeline(const lut::VulkanWindow&, VkRenderPass, VkPipelineLayout, VkPipelineLayout);
 	lut::Pipeline create_shadow_pipeline(const lut::VulkanWindow&, VkRenderPass, VkPipelineLayout);
+	lut::Pipeline create_depth_prepass_pipeline(const lut::VulkanWindow&, VkRenderPass, VkPipelineLayout);
+	lut::Pipeline create_cull_pipeline(const lut::VulkanWindow&, VkPipelineLayout, std::uint32_t);
+	lut::Pipeline create_depth_pyramid_pipeline(const lut::VulkanWindow&, VkPipelineLayout);
 
 	// Buffers
 	std::tuple<lut::Image, lut::ImageView> create_depth_buffer(const lut::VulkanWindow&, const lut::Allocator&, VkImageAspectFlagBits);
@@ -286,6 +485,7 @@ namespace
 	void create_over_visualisation_framebuffers(const lut::VulkanWindow&, VkRenderPass, std::vector<lut::Framebuffer>&, VkImageView, VkImageView);
 	void create_deferred_shading_framebuffers(const lut::VulkanWindow&, VkRenderPass, std::vector<lut::Framebuffer>&, VkImageView, VkImageView, VkImageView);
 	void create_shadow_offscreen_framebuffers(const lut::VulkanWindow&, VkRenderPass, std::vector<lut::Framebuffer>&, VkImageView);
+	lut::Framebuffer create_depth_prepass_framebuffer(const lut::VulkanWindow&, VkRenderPass, VkImageView);
 
 	lut::ImageView load_mesh_texture(const lut::VulkanWindow&, VkCommandPool, const lut::Allocator&, BakedTextureInfo);
 	lut::ImageView get_dummy_texture(const lut::VulkanWindow&, VkCommandPool, const lut::Allocator&);
@@ -295,25 +495,39 @@ namespace
 	void update_debug_uniforms(glsl::DebugUniform&, const UserState&);
 	void update_depth_mvp_uniforms(glsl::DepthMVP&, std::uint32_t, std::uint32_t, glm::vec4);
 
+	const BakedMeshLod& select_lod(const MeshData&, const glm::vec3&, float);
+
 	void record_commands(
 		VkCommandBuffer aCmdBuff,
 		RenderPasses aRenderPasses,
 		Framebuffers aFramebuffers,
 		Pipelines aPipelines,
 		const VkExtent2D& aExtent,
+		const SceneGeometry& aGeometry,
+		const SceneDraws& aDraws,
 		std::vector<MeshData>& aMeshData,
 		UBOs aUBOs,
 		Uniforms aUniforms,
 		PipelineLayouts aPipelineLayouts,
 		DescriptorSets aDescriptorSets,
-		const UserState& aState
+		const UserState& aState,
+		ShadowCache& aShadowCache
 	);
 
 	void submit_commands(const lut::VulkanWindow&, VkCommandBuffer, VkFence, VkSemaphore, VkSemaphore);
+
+	void benchmark_model_loading(const char*);
+	bool evict_from_page_cache(const char*);
 }
 
-int main() try
+int main(int aArgc, char* aArgv[]) try
 {
+	// Loader benchmark only; doesn't need a window or device
+	if (aArgc > 1 && 0 == std::strcmp(aArgv[1], "--bench-load")) {
+		benchmark_model_loading(cfg::kModelPath);
+		return 0;
+	}
+
 	// Create Vulkan window
 	lut::VulkanWindow window = lut::make_vulkan_window();
 
@@ -329,6 +543,11 @@ int main() try
 	// Create VMA allocator
 	lut::Allocator allocator = lut::create_allocator(window);
 
+	// Load baked model. The file is memory mapped; mesh data is copied from
+	// the mapping straight into the staging buffers below. Loaded up front,
+	// since the material descriptor layout depends on the number of textures.
+	MappedBakedModel bakedModel = load_baked_model_mapped(cfg::kModelPath);
+
 	// Create render passes
 	lut::RenderPass renderPass = create_render_pass(window);
 	lut::RenderPass offscreenRenderPass = create_offscreen_render_pass(window);
@@ -336,6 +555,7 @@ int main() try
 	lut::RenderPass overVisualisationsRenderPass = create_over_visualisations_render_pass(window);
 	lut::RenderPass deferredShadingRenderPass = create_deferred_shading_render_pass(window);
 	lut::RenderPass shadowOffscreenRenderPass = create_offscreen_shadow_render_pass(window);
+	lut::RenderPass depthPrepassRenderPass = create_depth_prepass_render_pass(window);
 
 	RenderPasses renderPasses{};
 	renderPasses.regularRenderPass = renderPass.handle;
@@ -344,16 +564,19 @@ int main() try
 	renderPasses.overVisualisationsRenderPass = overVisualisationsRenderPass.handle;
 	renderPasses.deferredShadingRenderPass = deferredShadingRenderPass.handle;
 	renderPasses.shadowOffscreenRenderPass = shadowOffscreenRenderPass.handle;
+	renderPasses.depthPrepassRenderPass = depthPrepassRenderPass.handle;
 
 	// Create descriptor set layouts
 	lut::DescriptorSetLayout sceneLayout = create_scene_descriptor_layout(window);
-	lut::DescriptorSetLayout materialLayout = create_material_descriptor_layout(window);
+	lut::DescriptorSetLayout materialLayout = create_material_descriptor_layout(window, std::uint32_t(bakedModel.textures.size()));
 	lut::DescriptorSetLayout uboLayout = create_fragment_ubo_descriptor_layout(window);
 	lut::DescriptorSetLayout uboLayoutVert = create_vertex_ubo_descriptor_layout(window);
 	lut::DescriptorSetLayout postProcessDescriptorLayout = create_post_process_descriptor_layout(window);
 	lut::DescriptorSetLayout overVisualisationDescriptorLayout = create_over_visualisations_descriptor_layout(window);
 	lut::DescriptorSetLayout deferredShadingDescriptorLayout = create_deferred_shading_descriptor_layout(window);
 	lut::DescriptorSetLayout fragImageLayout = create_fragment_image_layout(window);
+	lut::DescriptorSetLayout cullLayout = create_cull_descriptor_layout(window);
+	lut::DescriptorSetLayout depthPyramidLayout = create_depth_pyramid_descriptor_layout(window);
 
 	std::vector<VkDescriptorSetLayout> sceneDescriptorSetLayouts;
 	sceneDescriptorSetLayouts.emplace_back(sceneLayout.handle);
@@ -381,6 +604,13 @@ int main() try
 
 	std::vector<VkDescriptorSetLayout> shadowOffscreenDescriptorSetLayouts;
 	shadowOffscreenDescriptorSetLayouts.emplace_back(uboLayoutVert.handle);
+	shadowOffscreenDescriptorSetLayouts.emplace_back(sceneLayout.handle);
+
+	std::vector<VkDescriptorSetLayout> cullDescriptorSetLayouts;
+	cullDescriptorSetLayouts.emplace_back(cullLayout.handle);
+
+	std::vector<VkDescriptorSetLayout> depthPyramidDescriptorSetLayouts;
+	depthPyramidDescriptorSetLayouts.emplace_back(depthPyramidLayout.handle);
 
 	// Create pipeline layouts
 	lut::PipelineLayout pipeLayout = create_pipeline_layout(window, sceneDescriptorSetLayouts);
@@ -391,6 +621,8 @@ int main() try
 	lut::PipelineLayout gBufWriteLayout = create_pipeline_layout(window, sceneDescriptorSetLayouts);
 	lut::PipelineLayout deferredShadingLayout = create_pipeline_layout(window, deferredShadingDescriptorSetLayouts);
 	lut::PipelineLayout shadowOffscreenLayout = create_pipeline_layout(window, shadowOffscreenDescriptorSetLayouts);
+	lut::PipelineLayout cullLayoutPipe = create_pipeline_layout(window, cullDescriptorSetLayouts);
+	lut::PipelineLayout depthPyramidLayoutPipe = create_pipeline_layout(window, depthPyramidDescriptorSetLayouts);
 
 	PipelineLayouts pipelineLayouts{};
 	pipelineLayouts.regularPipelineLayout = pipeLayout.handle;
@@ -400,6 +632,8 @@ int main() try
 	pipelineLayouts.gBufWritePipelineLayout = gBufWriteLayout.handle;
 	pipelineLayouts.deferredShadingPipelineLayout = deferredShadingLayout.handle;
 	pipelineLayouts.shadowOffscreenPipelineLayout = shadowOffscreenLayout.handle;
+	pipelineLayouts.cullPipelineLayout = cullLayoutPipe.handle;
+	pipelineLayouts.depthPyramidPipelineLayout = depthPyramidLayoutPipe.handle;
 
 	// Create pipelines
 	lut::Pipeline pipeline = create_pipeline(window, renderPass.handle, pipeLayout.handle);
@@ -411,6 +645,11 @@ int main() try
 	auto [overVisWritePipe, overVisReadPipe] = create_over_visualisations_pipeline(window, overVisualisationsRenderPass.handle, overVisWriteLayout.handle, overVisReadLayout.handle);
 	auto [gBufWritePipe, deferredShadingPipe] = create_deferred_shading_pipeline(window, deferredShadingRenderPass.handle, gBufWriteLayout.handle, deferredShadingLayout.handle);
 	lut::Pipeline shadowOffscreenPipeline = create_shadow_pipeline(window, shadowOffscreenRenderPass.handle, shadowOffscreenLayout.handle);
+	lut::Pipeline cullPipeline = create_cull_pipeline(window, cullLayoutPipe.handle, kCullPhaseSingle);
+	lut::Pipeline cullEarlyPipeline = create_cull_pipeline(window, cullLayoutPipe.handle, kCullPhaseEarly);
+	lut::Pipeline cullLatePipeline = create_cull_pipeline(window, cullLayoutPipe.handle, kCullPhaseLate);
+	lut::Pipeline depthPrepassPipeline = create_depth_prepass_pipeline(window, depthPrepassRenderPass.handle, overVisWriteLayout.handle);
+	lut::Pipeline depthPyramidPipeline = create_depth_pyramid_pipeline(window, depthPyramidLayoutPipe.handle);
 
 	Pipelines pipelines{};
 	pipelines.regularPipeline = pipeline.handle;
@@ -424,6 +663,11 @@ int main() try
 	pipelines.gBufWritePipline = gBufWritePipe.handle;
 	pipelines.deferredShadingPipeline = deferredShadingPipe.handle;
 	pipelines.shadowOffscreenPipeline = shadowOffscreenPipeline.handle;
+	pipelines.cullPipeline = cullPipeline.handle;
+	pipelines.cullEarlyPipeline = cullEarlyPipeline.handle;
+	pipelines.cullLatePipeline = cullLatePipeline.handle;
+	pipelines.depthPrepassPipeline = depthPrepassPipeline.handle;
+	pipelines.depthPyramidPipeline = depthPyramidPipeline.handle;
 
 	// Create depth specific depth buffer
 	auto [DdepthBuffer, DdepthBufferView] = create_depth_buffer(window, allocator, VK_IMAGE_ASPECT_DEPTH_BIT);
@@ -455,9 +699,12 @@ int main() try
 	// Create shadow offscreen framebuffers
 	std::vector<lut::Framebuffer> shadowFramebuffers;
 	create_shadow_offscreen_framebuffers(window, shadowOffscreenRenderPass.handle, shadowFramebuffers, shadowDepthBufferView.handle);
+	// Create framebuffer for the occlusion culling depth prepass
+	lut::Framebuffer depthPrepassFramebuffer = create_depth_prepass_framebuffer(window, depthPrepassRenderPass.handle, DdepthBufferView.handle);
 
 	Framebuffers aFramebuffers{};
 	aFramebuffers.offscreenFramebuffer = offscreenFramebuffer.handle;
+	aFramebuffers.depthPrepassFramebuffer = depthPrepassFramebuffer.handle;
 
 	// Create command pool
 	lut::CommandPool cpool = lut::create_command_pool(window, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
@@ -522,12 +769,22 @@ int main() try
 		VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
 	);
 
+	// Create Cull Buffer
+	lut::Buffer cullUBO = lut::create_buffer(
+		allocator,
+		sizeof(glsl::CullUniform),
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		0,
+		VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
+	);
+
 	UBOs ubos{};
 	ubos.sceneUBO = sceneUBO.buffer;
 	ubos.lightUBO = lightUBO.buffer;
 	ubos.debugUBO = debugUBO.buffer;
 	ubos.multipleLightsUBO = multipleLightsUBO.buffer;
 	ubos.depthMVPUBO = depthMVPUBO.buffer;
+	ubos.cullUBO = cullUBO.buffer;
 
 #pragma endregion
 
@@ -537,6 +794,10 @@ int main() try
 	// Create sampler
 	lut::Sampler sampler = lut::create_default_sampler(window);
 	lut::Sampler shadowSampler = lut::create_shadow_sampler(window);
+	lut::Sampler pointSampler = lut::create_point_sampler(window);
+
+	// Create depth pyramid for occlusion culling
+	DepthPyramid depthPyramid = create_depth_pyramid(window, allocator, window.swapchainExtent, DdepthBufferView.handle, pointSampler.handle, dpool.handle, depthPyramidLayout.handle);
 
 #pragma region DescriptorSets
 
@@ -747,10 +1008,6 @@ int main() try
 
 #pragma endregion
 
-	// Load mesh data
-	// Load baked model
-	BakedModel bakedModel = load_baked_model(cfg::kModelPath);
-	
 	// Load all texture images and image views
 	// std::vector<lut::Image> textures;
 	std::vector<lut::ImageView> textureViews;
@@ -761,98 +1018,75 @@ int main() try
 
 #pragma region MaterialDescriptorSets
 
-	// Vector of dummy texture image views outside of the loop so they don't get destructed
-	// when control goes out of loop
-	std::vector<lut::ImageView> dummyTextures;
+	// Texture indices of each material. Materials without an alpha mask use the base colour
+	// texture instead.
+	std::vector<glsl::MaterialInfo> materialInfos;
+	for (const auto& material : bakedModel.materials) {
+		materialInfos.emplace_back(glsl::MaterialInfo{
+			material.baseColorTextureId,
+			material.metalnessTextureId,
+			material.roughnessTextureId,
+			material.alphaMaskTextureId == 0xffffffff ? material.baseColorTextureId : material.alphaMaskTextureId,
+			material.normalMapTextureId
+		});
+	}
+
+	lut::Buffer materialBuffer = lut::create_buffer(
+		allocator,
+		std::max<VkDeviceSize>(materialInfos.size() * sizeof(glsl::MaterialInfo), 1),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		0,
+		VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
+	);
+
+	{
+		UploadBatch materialUpload(allocator);
+		materialUpload.upload(materialBuffer.buffer, 0, materialInfos.data(), materialInfos.size() * sizeof(glsl::MaterialInfo));
+		materialUpload.flush(window, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+	}
+
+	// A single descriptor set holds all textures and the material buffer; it's bound once per pass
+	VkDescriptorSet materialDescriptor = lut::alloc_desc_set(window, dpool.handle, materialLayout.handle);
+	{
+		VkWriteDescriptorSet desc[2]{};
 
-	// Create Descriptor Sets for each material
-	std::vector<VkDescriptorSet> materialDescriptors;
-	for (std::size_t i = 0; i < bakedModel.materials.size(); i++) {
-		VkDescriptorSet materialDescriptor = lut::alloc_desc_set(window, dpool.handle, materialLayout.handle);
-		VkWriteDescriptorSet desc[5]{};
+		std::vector<VkDescriptorImageInfo> textureInfos;
+		for (const auto& view : textureViews) {
+			VkDescriptorImageInfo textureInfo{};
+			textureInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			textureInfo.imageView = view.handle;
+			textureInfo.sampler = sampler.handle;
 
-		VkDescriptorImageInfo baseColourInfo{};
-		baseColourInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		baseColourInfo.imageView = textureViews[bakedModel.materials[i].baseColorTextureId].handle;
-		baseColourInfo.sampler = sampler.handle;
+			textureInfos.emplace_back(textureInfo);
+		}
 
 		desc[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 		desc[0].dstSet = materialDescriptor;
 		desc[0].dstBinding = 0;
 		desc[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		desc[0].descriptorCount = 1;
-		desc[0].pImageInfo = &baseColourInfo;
+		desc[0].descriptorCount = std::uint32_t(textureInfos.size());
+		desc[0].pImageInfo = textureInfos.data();
 
-		VkDescriptorImageInfo metalnessInfo{};
-		metalnessInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		metalnessInfo.imageView = textureViews[bakedModel.materials[i].metalnessTextureId].handle;
-		metalnessInfo.sampler = sampler.handle;
+		VkDescriptorBufferInfo materialsInfo{};
+		materialsInfo.buffer = materialBuffer.buffer;
+		materialsInfo.range = VK_WHOLE_SIZE;
 
 		desc[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 		desc[1].dstSet = materialDescriptor;
 		desc[1].dstBinding = 1;
-		desc[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		desc[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 		desc[1].descriptorCount = 1;
-		desc[1].pImageInfo = &metalnessInfo;
-
-		VkDescriptorImageInfo roughnessInfo{};
-		roughnessInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		roughnessInfo.imageView = textureViews[bakedModel.materials[i].roughnessTextureId].handle;
-		roughnessInfo.sampler = sampler.handle;
+		desc[1].pBufferInfo = &materialsInfo;
 
-		desc[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		desc[2].dstSet = materialDescriptor;
-		desc[2].dstBinding = 2;
-		desc[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		desc[2].descriptorCount = 1;
-		desc[2].pImageInfo = &roughnessInfo;
-
-		// Check if the material has a valid alphaMaskTextureId, otherwise set its
-		// imageView handle to the base colour texture
-		VkImageView alphaMaskImageView = VK_NULL_HANDLE;
-		if (bakedModel.materials[i].alphaMaskTextureId == 0xffffffff) {
-			alphaMaskImageView = textureViews[bakedModel.materials[i].baseColorTextureId].handle;
-		} else {
-			alphaMaskImageView = textureViews[bakedModel.materials[i].alphaMaskTextureId].handle;
-		}
-
-		VkDescriptorImageInfo alphaMaskInfo{};
-		alphaMaskInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		alphaMaskInfo.imageView = alphaMaskImageView;
-		alphaMaskInfo.sampler = sampler.handle;
-
-		desc[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		desc[3].dstSet = materialDescriptor;
-		desc[3].dstBinding = 3;
-		desc[3].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		desc[3].descriptorCount = 1;
-		desc[3].pImageInfo = &alphaMaskInfo;
-
-		VkDescriptorImageInfo normalMapInfo{};
-		normalMapInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		normalMapInfo.imageView = textureViews[bakedModel.materials[i].normalMapTextureId].handle;
-		normalMapInfo.sampler = sampler.handle;
-
-		desc[4].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		desc[4].dstSet = materialDescriptor;
-		desc[4].dstBinding = 4;
-		desc[4].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		desc[4].descriptorCount = 1;
-		desc[4].pImageInfo = &normalMapInfo;
-			
-		constexpr auto numSets = sizeof(desc) / sizeof(desc[0]);
-		vkUpdateDescriptorSets(window.device, numSets, desc, 0, nullptr);
-		materialDescriptors.emplace_back(materialDescriptor);
+		// Skip the texture array if there are no textures at all
+		const std::uint32_t numSets = textureInfos.empty() ? 1 : 2;
+		vkUpdateDescriptorSets(window.device, numSets, textureInfos.empty() ? desc + 1 : desc, 0, nullptr);
 	}
 
-	//for (std::size_t i = 0; i < bakedModel.materials.size(); i++) {
-	//	std::cout << "i: " << i << "textureViews[" << bakedModel.materials[i].normalMapTextureId << "]: " << textureViews[bakedModel.materials[i].normalMapTextureId].handle << std::endl;
-	//}
-
 #pragma endregion
 
 	DescriptorSets descriptorSets{
-		materialDescriptors,
+		materialDescriptor,
 		sceneDescriptors,
 		lightDescriptor,
 		debugDescriptor,
@@ -861,244 +1095,323 @@ int main() try
 		deferredShadingDescriptor,
 		mutlipleLightsDescriptor,
 		depthMVPDescriptor,
-		shadowMapDescriptor
+		shadowMapDescriptor,
+		VK_NULL_HANDLE
 	};
 
 #pragma region MeshData
 
-	// Mesh Data
-	std::vector<MeshData> meshData;
-	for (std::size_t i = 0; i < bakedModel.meshes.size(); i++) {
-		lut::Buffer vertexPosGPU = lut::create_buffer(
-			allocator,
-			bakedModel.meshes[i].positions.size() * sizeof(glm::vec3),
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			0,
-			VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
-		);
+	// Mesh Data. Meshes are packed into shared buffers (see SceneGeometry) and uploaded with
+	// a single submission, see UploadBatch.
+	const auto uploadStart = Clock_::now();
 
-		lut::Buffer vertexTexGPU = lut::create_buffer(
-			allocator,
-			bakedModel.meshes[i].texcoords.size() * sizeof(glm::vec2),
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			0,
-			VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
-		);
+	VkDeviceSize positionBytes = 0, texcoordBytes = 0, tangentBytes = 0, indexBytes = 0;
+	for (const auto& mesh : bakedModel.meshes) {
+		positionBytes += mesh.positions.size();
+		texcoordBytes += mesh.texcoords.size();
+		tangentBytes += mesh.tangentsComp.size();
 
-		// Even though we pass the TBN frame, this is kept in to allow me to compare and get the
-		// screenshots to compare against the TBN normal mapping
-		lut::Buffer vertexNormGPU = lut::create_buffer(
-			allocator,
-			bakedModel.meshes[i].normals.size() * sizeof(glm::vec3),
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			0,
-			VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
-		);
+		// Each mesh's indices start at a multiple of its index size
+		indexBytes = (indexBytes + mesh.indexSize - 1) / mesh.indexSize * mesh.indexSize + mesh.indices.size();
+	}
 
-		lut::Buffer vertexTangGPU = lut::create_buffer(
+	const auto create_geometry_buffer = [&](VkDeviceSize aSize, VkBufferUsageFlags aUsage) {
+		return lut::create_buffer(
 			allocator,
-			bakedModel.meshes[i].tangentsComp.size() * sizeof(std::uint32_t),
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			std::max<VkDeviceSize>(aSize, 1),
+			aUsage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 			0,
 			VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
 		);
+	};
 
-		lut::Buffer vertexIndexGPU = lut::create_buffer(
-			allocator,
-			bakedModel.meshes[i].indices.size() * sizeof(std::uint32_t),
-			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			0,
-			VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
-		);
+	SceneGeometry sceneGeometry{
+		create_geometry_buffer(positionBytes, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT),
+		create_geometry_buffer(texcoordBytes, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT),
+		create_geometry_buffer(tangentBytes, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT),
+		create_geometry_buffer(indexBytes, VK_BUFFER_USAGE_INDEX_BUFFER_BIT),
+		create_geometry_buffer(bakedModel.meshes.size() * sizeof(glsl::MeshInstance), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
+	};
 
-		lut::Buffer posStaging = lut::create_buffer(
-			allocator,
-			bakedModel.meshes[i].positions.size() * sizeof(glm::vec3),
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT
-		);
+	UploadBatch uploads(allocator);
 
-		lut::Buffer texStaging = lut::create_buffer(
-			allocator,
-			bakedModel.meshes[i].texcoords.size() * sizeof(glm::vec2),
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT
-		);
+	// Meshes are stored in draw order, see DrawBatch
+	const auto has_alpha_mask = [&](std::size_t aMesh) {
+		return bakedModel.materials[bakedModel.meshes[aMesh].materialId].alphaMaskTextureId != 0xffffffff;
+	};
 
-		lut::Buffer normStaging = lut::create_buffer(
-			allocator,
-			bakedModel.meshes[i].normals.size() * sizeof(glm::vec3),
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT
-		);
+	std::vector<std::size_t> drawOrder(bakedModel.meshes.size());
+	std::iota(drawOrder.begin(), drawOrder.end(), std::size_t(0));
+	std::stable_sort(drawOrder.begin(), drawOrder.end(), [&](std::size_t aA, std::size_t aB) {
+		const auto& a = bakedModel.meshes[aA];
+		const auto& b = bakedModel.meshes[aB];
+		return std::make_tuple(has_alpha_mask(aA), a.indexSize, a.materialId) < std::make_tuple(has_alpha_mask(aB), b.indexSize, b.materialId);
+	});
 
-		lut::Buffer tangStaging = lut::create_buffer(
-			allocator,
-			bakedModel.meshes[i].tangentsComp.size() * sizeof(std::uint32_t),
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT
-		);
+	std::vector<MeshData> meshData;
+	std::uint32_t vertexCount = 0;
+	VkDeviceSize indexOffset = 0;
+	for (const std::size_t i : drawOrder) {
+		const auto& mesh = bakedModel.meshes[i];
 
-		lut::Buffer indexStaging = lut::create_buffer(
-			allocator,
-			bakedModel.meshes[i].indices.size() * sizeof(std::uint32_t),
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT
-		);
+		// Small meshes are baked with 16-bit indices
+		const bool shortIndices = sizeof(std::uint16_t) == mesh.indexSize;
+		indexOffset = (indexOffset + mesh.indexSize - 1) / mesh.indexSize * mesh.indexSize;
+
+		// Attribute streams have a fixed size per vertex, so offsets in all of them follow from
+		// the vertex offset
+		uploads.upload(sceneGeometry.positions.buffer, VkDeviceSize(vertexCount) * sizeof(glm::u16vec4), mesh.positions.data(), mesh.positions.size());
+		uploads.upload(sceneGeometry.texcoords.buffer, VkDeviceSize(vertexCount) * sizeof(glm::u16vec2), mesh.texcoords.data(), mesh.texcoords.size());
+		uploads.upload(sceneGeometry.tangents.buffer, VkDeviceSize(vertexCount) * sizeof(std::uint32_t), mesh.tangentsComp.data(), mesh.tangentsComp.size());
+		uploads.upload(sceneGeometry.indices.buffer, indexOffset, mesh.indices.data(), mesh.indices.size());
 
-		void* posPtr = nullptr;
-		if (const auto res = vmaMapMemory(allocator.allocator, posStaging.allocation, &posPtr); VK_SUCCESS != res)
-			throw lut::Error("Mapping memory for writing\n vmaMapMemory() returned %s", lut::to_string(res).c_str());
+		const auto firstIndex = std::uint32_t(indexOffset / mesh.indexSize);
+		const auto meshVertexOffset = std::int32_t(vertexCount);
 
-		std::memcpy(posPtr, bakedModel.meshes[i].positions.data(), bakedModel.meshes[i].positions.size() * sizeof(glm::vec3));
-		vmaUnmapMemory(allocator.allocator, posStaging.allocation);
+		vertexCount += mesh.vertexCount;
+		indexOffset += mesh.indices.size();
 
-		void* texPtr = nullptr;
-		if (const auto res = vmaMapMemory(allocator.allocator, texStaging.allocation, &texPtr); VK_SUCCESS != res)
-			throw lut::Error("Mapping memory for writing\n vmaMapMemory() returned %s", lut::to_string(res).c_str());
+		const bool hasAlphaMask = has_alpha_mask(i);
 
-		std::memcpy(texPtr, bakedModel.meshes[i].texcoords.data(), bakedModel.meshes[i].texcoords.size() * sizeof(glm::vec2));
-		vmaUnmapMemory(allocator.allocator, texStaging.allocation);
+		// Bounding sphere around the AABB, which is exactly the quantisation range of the positions
+		const glm::vec3 positionScale = bakedModel.meshes[i].positionScale;
+		const glm::vec3 positionBias = bakedModel.meshes[i].positionBias;
 
-		void* normPtr = nullptr;
-		if (const auto res = vmaMapMemory(allocator.allocator, normStaging.allocation, &normPtr); VK_SUCCESS != res)
-			throw lut::Error("Mapping memory for writing\n vmaMapMemory() returned %s", lut::to_string(res).c_str());
+		const glm::vec3 boundsCenter = positionBias + 0.5f * positionScale;
+		const float boundsRadius = 0.5f * glm::length(positionScale);
 
-		std::memcpy(normPtr, bakedModel.meshes[i].normals.data(), bakedModel.meshes[i].normals.size() * sizeof(glm::vec3));
-		vmaUnmapMemory(allocator.allocator, normStaging.allocation);
+		meshData.emplace_back(
+			MeshData {
+				firstIndex,
+				meshVertexOffset,
+				mesh.indexCount,
+				shortIndices ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32,
+				bakedModel.meshes[i].lods,
+				bakedModel.meshes[i].materialId,
+				hasAlphaMask,
+				positionScale,
+				positionBias,
+				boundsCenter,
+				boundsRadius
+			});
+	}
 
-		void* tangPtr = nullptr;
-		if (const auto res = vmaMapMemory(allocator.allocator, tangStaging.allocation, &tangPtr); VK_SUCCESS != res)
-			throw lut::Error("Mapping memory for writing\n vmaMapMemory() returned %s", lut::to_string(res).c_str());
+	// Split the draw order into batches of meshes with the same alpha mask state and index type
+	std::vector<DrawBatch> drawBatches;
+	for (std::uint32_t i = 0; i < meshData.size(); i++) {
+		const auto& mesh = meshData[i];
+		if (drawBatches.empty() || drawBatches.back().hasAlphaMask != mesh.hasAlphaMask || drawBatches.back().indexType != mesh.indexType)
+			drawBatches.emplace_back(DrawBatch{ mesh.hasAlphaMask, mesh.indexType, i, 0 });
 
-		std::memcpy(tangPtr, bakedModel.meshes[i].tangentsComp.data(), bakedModel.meshes[i].tangentsComp.size() * sizeof(std::uint32_t));
-		vmaUnmapMemory(allocator.allocator, tangStaging.allocation);
+		++drawBatches.back().meshCount;
+	}
 
-		void* indexPtr = nullptr;
-		if (const auto res = vmaMapMemory(allocator.allocator, indexStaging.allocation, &indexPtr); VK_SUCCESS != res)
-			throw lut::Error("Mapping memory for writing\n vmaMapMemory() returned %s", lut::to_string(res).c_str());
+	std::printf("%zu draw batches\n", drawBatches.size());
+
+	std::vector<glsl::MeshInstance> meshInstances;
+	for (const auto& mesh : meshData)
+		meshInstances.emplace_back(glsl::MeshInstance{ glm::vec4(mesh.positionScale, 0.0f), glm::vec4(mesh.positionBias, 0.0f), mesh.materialId, {} });
+
+	uploads.upload(sceneGeometry.meshes.buffer, 0, meshInstances.data(), meshInstances.size() * sizeof(glsl::MeshInstance));
+
+	// Static inputs of the cull compute shader: bounds, index ranges and levels of detail per mesh
+	std::vector<glsl::CullMesh> cullMeshes;
+	std::vector<BakedMeshLod> cullLods;
+	for (std::uint32_t b = 0; b < drawBatches.size(); b++) {
+		for (std::uint32_t i = drawBatches[b].firstMesh; i < drawBatches[b].firstMesh + drawBatches[b].meshCount; i++) {
+			const auto& mesh = meshData[i];
+
+			glsl::CullMesh cullMesh{};
+			cullMesh.boundsCenter = glm::vec4(mesh.positionBias + 0.5f * mesh.positionScale, 0.0f);
+			cullMesh.boundsExtent = glm::vec4(0.5f * mesh.positionScale, 0.0f);
+			cullMesh.sphere = glm::vec4(mesh.boundsCenter, mesh.boundsRadius);
+			cullMesh.firstIndex = mesh.firstIndex;
+			cullMesh.vertexOffset = mesh.vertexOffset;
+			cullMesh.firstLod = std::uint32_t(cullLods.size());
+			cullMesh.lodCount = std::uint32_t(mesh.lods.size());
+			cullMesh.batch = b;
+			cullMesh.batchFirstMesh = drawBatches[b].firstMesh;
+
+			cullMeshes.emplace_back(cullMesh);
+			cullLods.insert(cullLods.end(), mesh.lods.begin(), mesh.lods.end());
+		}
+	}
 
-		std::memcpy(indexPtr, bakedModel.meshes[i].indices.data(), bakedModel.meshes[i].indices.size() * sizeof(std::uint32_t));
-		vmaUnmapMemory(allocator.allocator, indexStaging.allocation);
+	lut::Buffer cullMeshBuffer = create_geometry_buffer(cullMeshes.size() * sizeof(glsl::CullMesh), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	lut::Buffer cullLodBuffer = create_geometry_buffer(cullLods.size() * sizeof(BakedMeshLod), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
 
-		lut::Fence uploadComplete = create_fence(window);
+	uploads.upload(cullMeshBuffer.buffer, 0, cullMeshes.data(), cullMeshes.size() * sizeof(glsl::CullMesh));
+	uploads.upload(cullLodBuffer.buffer, 0, cullLods.data(), cullLods.size() * sizeof(BakedMeshLod));
 
-		lut::CommandPool uploadPool = create_command_pool(window);
-		VkCommandBuffer uploadCmd = alloc_command_buffer(window, uploadPool.handle);
-		VkCommandBufferBeginInfo beginInfo{};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = 0;
-		beginInfo.pInheritanceInfo = nullptr;
+	// Occlusion culling starts out with all meshes as occluders
+	const std::vector<std::uint32_t> initialVisibility(meshData.size(), 1);
+	lut::Buffer meshVisibilityBuffer = create_geometry_buffer(initialVisibility.size() * sizeof(std::uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
 
-		if (const auto res = vkBeginCommandBuffer(uploadCmd, &beginInfo); VK_SUCCESS != res)
-		throw lut::Error("Unable to begin command buffer\n vkBeginCommandBuffer() returned %s", lut::to_string(res).c_str());
+	uploads.upload(meshVisibilityBuffer.buffer, 0, initialVisibility.data(), initialVisibility.size() * sizeof(std::uint32_t));
 
-		VkBufferCopy pcopy{};
-		pcopy.size = bakedModel.meshes[i].positions.size() * sizeof(glm::vec3);
+	const auto uploadBytes = uploads.queued_bytes();
+	const auto uploadCopies = uploads.queued_copies();
+	const auto uploadBlocks = uploads.staging_blocks();
 
-		vkCmdCopyBuffer(uploadCmd, posStaging.buffer, vertexPosGPU.buffer, 1, &pcopy);
+	uploads.flush(
+		window,
+		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+	);
 
-		lut::buffer_barrier(
-			uploadCmd,
-			vertexPosGPU.buffer,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
-		);
+	std::printf("Uploaded %zu meshes (%.1f MB, %zu copies, %zu staging buffers) in %.1f ms\n", meshData.size(), uploadBytes / (1024. * 1024.), uploadCopies, uploadBlocks, std::chrono::duration<double, std::milli>(Clock_::now() - uploadStart).count());
 
-		VkBufferCopy tcopy{};
-		tcopy.size = bakedModel.meshes[i].texcoords.size() * sizeof(glm::vec2);
+	// Per mesh data goes into the scene descriptor set
+	{
+		VkWriteDescriptorSet desc[1]{};
 
-		vkCmdCopyBuffer(uploadCmd, texStaging.buffer, vertexTexGPU.buffer, 1, &tcopy);
+		VkDescriptorBufferInfo meshesInfo{};
+		meshesInfo.buffer = sceneGeometry.meshes.buffer;
+		meshesInfo.range = VK_WHOLE_SIZE;
 
-		lut::buffer_barrier(
-			uploadCmd,
-			vertexTexGPU.buffer,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
-		);
+		desc[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		desc[0].dstSet = sceneDescriptors;
+		desc[0].dstBinding = 1;
+		desc[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		desc[0].descriptorCount = 1;
+		desc[0].pBufferInfo = &meshesInfo;
 
-		VkBufferCopy ncopy{};
-		ncopy.size = bakedModel.meshes[i].normals.size() * sizeof(glm::vec3);
+		constexpr auto numSets = sizeof(desc) / sizeof(desc[0]);
+		vkUpdateDescriptorSets(window.device, numSets, desc, 0, nullptr);
+	}
 
-		vkCmdCopyBuffer(uploadCmd, normStaging.buffer, vertexNormGPU.buffer, 1, &ncopy);
+	// Bounds for culling. The positions are quantised relative to each mesh's AABB, so the
+	// dequantisation range is the box.
+	std::vector<glm::vec3> boundsMin, boundsMax;
+	for (const auto& mesh : meshData) {
+		boundsMin.emplace_back(mesh.positionBias);
+		boundsMax.emplace_back(mesh.positionBias + mesh.positionScale);
+	}
 
-		lut::buffer_barrier(
-			uploadCmd,
-			vertexNormGPU.buffer,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
-		);
+	const MeshBounds meshBounds = make_mesh_bounds(boundsMin, boundsMax);
 
-		VkBufferCopy tangcopy{};
-		tangcopy.size = bakedModel.meshes[i].tangentsComp.size() * sizeof(std::uint32_t);
+	// Indirect draw commands are rewritten by the CPU every frame (level of detail selection), 
+	// so each frame in flight gets its own host visible buffer
+	std::vector<lut::Buffer> indirectBuffers;
+	std::vector<VkDrawIndexedIndirectCommand*> indirectCommands;
+	for (std::size_t i = 0; i < cbuffers.size(); ++i) {
+		indirectBuffers.emplace_back(lut::create_buffer(
+			allocator,
+			std::max<VkDeviceSize>(meshData.size(), 1) * kDrawViewCount * sizeof(VkDrawIndexedIndirectCommand),
+			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT
+		));
+
+		VmaAllocationInfo allocInfo{};
+		vmaGetAllocationInfo(allocator.allocator, indirectBuffers.back().allocation, &allocInfo);
+		indirectCommands.emplace_back(static_cast<VkDrawIndexedIndirectCommand*>(allocInfo.pMappedData));
+	}
 
-		vkCmdCopyBuffer(uploadCmd, tangStaging.buffer, vertexTangGPU.buffer, 1, &tangcopy);
+	// With GPU culling, the commands are written by the cull compute shader instead. The draw
+	// counts are also read by the host for the culling statistics.
+	std::vector<lut::Buffer> culledCommandBuffers, drawCountBuffers;
+	std::vector<const std::uint32_t*> drawCounts;
+	std::vector<VkDescriptorSet> cullDescriptors;
+	for (std::size_t i = 0; i < cbuffers.size(); ++i) {
+		culledCommandBuffers.emplace_back(lut::create_buffer(
+			allocator,
+			std::max<VkDeviceSize>(meshData.size(), 1) * kDrawViewCount * sizeof(VkDrawIndexedIndirectCommand),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			0,
+			VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
+		));
 
-		lut::buffer_barrier(
-			uploadCmd,
-			vertexTangGPU.buffer,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
-		);
+		drawCountBuffers.emplace_back(lut::create_buffer(
+			allocator,
+			(drawBatches.size() * kDrawViewCount + 1) * sizeof(std::uint32_t),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT
+		));
 
-		VkBufferCopy icopy{};
-		icopy.size = bakedModel.meshes[i].indices.size() * sizeof(std::uint32_t);
+		VmaAllocationInfo allocInfo{};
+		vmaGetAllocationInfo(allocator.allocator, drawCountBuffers.back().allocation, &allocInfo);
+		std::memset(allocInfo.pMappedData, 0, allocInfo.size);
+		drawCounts.emplace_back(static_cast<const std::uint32_t*>(allocInfo.pMappedData));
 
-		vkCmdCopyBuffer(uploadCmd, indexStaging.buffer, vertexIndexGPU.buffer, 1, &icopy);
+		VkDescriptorSet cullDescriptor = lut::alloc_desc_set(window, dpool.handle, cullLayout.handle);
+		{
+			VkWriteDescriptorSet desc[7]{};
+
+			VkDescriptorBufferInfo cullUboInfo{};
+			cullUboInfo.buffer = cullUBO.buffer;
+			cullUboInfo.range = VK_WHOLE_SIZE;
+
+			desc[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			desc[0].dstSet = cullDescriptor;
+			desc[0].dstBinding = 0;
+			desc[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			desc[0].descriptorCount = 1;
+			desc[0].pBufferInfo = &cullUboInfo;
+
+			const VkBuffer storageBuffers[5] = { cullMeshBuffer.buffer, cullLodBuffer.buffer, culledCommandBuffers.back().buffer, drawCountBuffers.back().buffer, meshVisibilityBuffer.buffer };
+			VkDescriptorBufferInfo storageInfos[5]{};
+			for (std::uint32_t j = 0; j < 5; j++) {
+				storageInfos[j].buffer = storageBuffers[j];
+				storageInfos[j].range = VK_WHOLE_SIZE;
+
+				desc[j + 1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				desc[j + 1].dstSet = cullDescriptor;
+				desc[j + 1].dstBinding = j + 1;
+				desc[j + 1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				desc[j + 1].descriptorCount = 1;
+				desc[j + 1].pBufferInfo = &storageInfos[j];
+			}
 
-		lut::buffer_barrier(
-			uploadCmd,
-			vertexIndexGPU.buffer,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
-		);
+			VkDescriptorImageInfo pyramidInfo{};
+			pyramidInfo.sampler = pointSampler.handle;
+			pyramidInfo.imageView = depthPyramid.view.handle;
+			pyramidInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
 
-		if (const auto res = vkEndCommandBuffer(uploadCmd); VK_SUCCESS != res)
-		throw lut::Error("Unable to end command buffer\n vkEndCommandBuffer() returned %s", lut::to_string(res).c_str());
+			desc[6].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			desc[6].dstSet = cullDescriptor;
+			desc[6].dstBinding = 6;
+			desc[6].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			desc[6].descriptorCount = 1;
+			desc[6].pImageInfo = &pyramidInfo;
 
-		VkSubmitInfo submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &uploadCmd;
+			constexpr auto numSets = sizeof(desc) / sizeof(desc[0]);
+			vkUpdateDescriptorSets(window.device, numSets, desc, 0, nullptr);
+		}
 
-		if (const auto res =  vkQueueSubmit(window.graphicsQueue, 1, &submitInfo, uploadComplete.handle); VK_SUCCESS != res)
-			throw lut::Error("Unable to submit commands\n vkQueueSubmit() returned %s", lut::to_string(res).c_str());
+		cullDescriptors.emplace_back(cullDescriptor);
+	}
 
-		if (const auto res = vkWaitForFences(window.device, 1, &uploadComplete.handle, VK_TRUE, std::numeric_limits<std::uint64_t>::max()) ; VK_SUCCESS != res)
-			throw lut::Error("Unable to wait for fences\n vkWaitForFences() returned %s", lut::to_string(res).c_str());
+	// GPU timestamps, if the graphics queue supports them
+	VkPhysicalDeviceProperties deviceProps{};
+	vkGetPhysicalDeviceProperties(window.physicalDevice, &deviceProps);
 
-		bool hasAlphaMask = false;
-		if (bakedModel.materials[bakedModel.meshes[i].materialId].alphaMaskTextureId != 0xffffffff) hasAlphaMask = true;
+	lut::QueryPool timestampPool;
+	if (deviceProps.limits.timestampComputeAndGraphics) {
+		VkQueryPoolCreateInfo queryInfo{};
+		queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryInfo.queryCount = std::uint32_t(cbuffers.size()) * cfg::kTimestampsPerFrame;
 
-		meshData.emplace_back(
-			MeshData {
-				std::move(vertexPosGPU), 
-				std::move(vertexTexGPU),
-				std::move(vertexNormGPU), // Even though we pass the TBN frame, this is kept in to allow me to compare and get the
-										  // screenshots to compare against the TBN normal mapping
-				std::move(vertexTangGPU),
-				std::move(vertexIndexGPU), 
-				bakedModel.meshes[i].indices.size(),
-				bakedModel.meshes[i].materialId,
-				hasAlphaMask
-			});
+		VkQueryPool pool = VK_NULL_HANDLE;
+		if (const auto res = vkCreateQueryPool(window.device, &queryInfo, nullptr, &pool); VK_SUCCESS != res)
+			throw lut::Error("Unable to create query pool\n vkCreateQueryPool() returned %s", lut::to_string(res).c_str());
+
+		timestampPool = lut::QueryPool(window.device, pool);
 	}
 
+	std::vector<bool> timestampsWritten(cbuffers.size(), false);
+
 #pragma endregion
 
 	// Application main loop
 	bool recreateSwapchain = false;
 
+	CullStats cullStats{};
+	ShadowCache shadowCache{};
+	float statsTime = 0.0f, statsCullMicroseconds = 0.0f;
+	double statsGpuFrameMilliseconds = 0.0, statsGpuCullMilliseconds = 0.0;
+	std::uint32_t statsFrames = 0, statsGpuFrames = 0;
+
 	auto previousClock = Clock_::now();
 	while (!glfwWindowShouldClose(window.window)) {
 		glfwPollEvents();
@@ -1115,6 +1428,7 @@ int main() try
 				overVisualisationsRenderPass = create_over_visualisations_render_pass(window);
 				deferredShadingRenderPass = create_deferred_shading_render_pass(window);
 				shadowOffscreenRenderPass = create_offscreen_shadow_render_pass(window);
+				depthPrepassRenderPass = create_depth_prepass_render_pass(window);
 
 				renderPasses.regularRenderPass = renderPass.handle;
 				renderPasses.offscreenRenderPass = offscreenRenderPass.handle;
@@ -1122,6 +1436,7 @@ int main() try
 				renderPasses.overVisualisationsRenderPass = overVisualisationsRenderPass.handle;
 				renderPasses.deferredShadingRenderPass = deferredShadingRenderPass.handle;
 				renderPasses.shadowOffscreenRenderPass = shadowOffscreenRenderPass.handle;
+				renderPasses.depthPrepassRenderPass = depthPrepassRenderPass.handle;
 			}
 				
 			if (changes.changedSize) {
@@ -1130,6 +1445,28 @@ int main() try
 				std::tie(SdepthBuffer, SdepthBufferView) = create_depth_buffer(window, allocator, VK_IMAGE_ASPECT_STENCIL_BIT);
 				std::tie(normalsBuffer, normalsBufferView) = create_normals_buffer(window, allocator);
 				std::tie(albedoBuffer, albedoBufferView) = create_albedo_buffer(window, allocator);
+
+				// The depth pyramid follows the depth buffer
+				depthPyramid = create_depth_pyramid(window, allocator, window.swapchainExtent, DdepthBufferView.handle, pointSampler.handle, dpool.handle, depthPyramidLayout.handle);
+
+				for (const auto cullDescriptor : cullDescriptors) {
+					VkWriteDescriptorSet desc[1]{};
+
+					VkDescriptorImageInfo pyramidInfo{};
+					pyramidInfo.sampler = pointSampler.handle;
+					pyramidInfo.imageView = depthPyramid.view.handle;
+					pyramidInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+					desc[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+					desc[0].dstSet = cullDescriptor;
+					desc[0].dstBinding = 6;
+					desc[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+					desc[0].descriptorCount = 1;
+					desc[0].pImageInfo = &pyramidInfo;
+
+					constexpr auto numSets = sizeof(desc) / sizeof(desc[0]);
+					vkUpdateDescriptorSets(window.device, numSets, desc, 0, nullptr);
+				}
 			}
 			
 			offscreenFramebuffer = create_offscreen_framebuffer(window, offscreenRenderPass.handle, colourBufferView.handle, DdepthBufferView.handle);
@@ -1144,6 +1481,8 @@ int main() try
 			create_deferred_shading_framebuffers(window, deferredShadingRenderPass.handle, deferredShadingFramebuffers, DdepthBufferView.handle, normalsBufferView.handle, albedoBufferView.handle);
 			shadowFramebuffers.clear();
 			create_shadow_offscreen_framebuffers(window, shadowOffscreenRenderPass.handle, shadowFramebuffers, shadowDepthBufferView.handle);
+			depthPrepassFramebuffer = create_depth_prepass_framebuffer(window, depthPrepassRenderPass.handle, DdepthBufferView.handle);
+			aFramebuffers.depthPrepassFramebuffer = depthPrepassFramebuffer.handle;
 
 			if (changes.changedSize) {
 				pipeline = create_pipeline(window, renderPass.handle, pipeLayout.handle);
@@ -1154,6 +1493,7 @@ int main() try
 				postProcessPipeline = create_post_process_pipeline(window, postProcessRenderPass.handle, postProcessLayout.handle);
 				std::tie(overVisWritePipe, overVisReadPipe) = create_over_visualisations_pipeline(window, overVisualisationsRenderPass.handle, overVisWriteLayout.handle, overVisReadLayout.handle);
 				std::tie(gBufWritePipe, deferredShadingPipe) = create_deferred_shading_pipeline(window, deferredShadingRenderPass.handle, gBufWriteLayout.handle, deferredShadingLayout.handle);
+				depthPrepassPipeline = create_depth_prepass_pipeline(window, depthPrepassRenderPass.handle, overVisWriteLayout.handle);
 
 				pipelines.regularPipeline = pipeline.handle;
 				pipelines.alphaPipeline = alphaPipeline.handle;
@@ -1165,6 +1505,7 @@ int main() try
 				pipelines.overVisReadPipeline = overVisReadPipe.handle;
 				pipelines.gBufWritePipline = gBufWritePipe.handle;
 				pipelines.deferredShadingPipeline = deferredShadingPipe.handle;
+				pipelines.depthPrepassPipeline = depthPrepassPipeline.handle;
 			}
 
 			// Recreate post process descriptor since it relies on colour buffer
@@ -1256,6 +1597,9 @@ int main() try
 			descriptorSets.overVisualisationDescriptor = overVisualisationDescriptor;
 			descriptorSets.deferredShadingDescriptor = deferredShadingDescriptor;
 
+			// The shadow map's render pass and framebuffers may have been replaced
+			shadowCache.valid = false;
+
 			recreateSwapchain = false;
 			continue;
 		}
@@ -1268,6 +1612,18 @@ int main() try
 		if (const auto res = vkWaitForFences(window.device, 1, &frameDone[frameIndex].handle, VK_TRUE, std::numeric_limits<std::uint64_t>::max()); VK_SUCCESS != res)
 			throw lut::Error("Unable to wait for frame fence %u\n vkWaitForFences() returned %s", frameIndex, lut::to_string(res).c_str());
 
+		// GPU time of the previous use of this frame's command buffer
+		if (timestampsWritten[frameIndex]) {
+			std::uint64_t ticks[cfg::kTimestampsPerFrame]{};
+			const auto res = vkGetQueryPoolResults(window.device, timestampPool.handle, std::uint32_t(frameIndex) * cfg::kTimestampsPerFrame, cfg::kTimestampsPerFrame, sizeof(ticks), ticks, sizeof(std::uint64_t), VK_QUERY_RESULT_64_BIT);
+
+			if (VK_SUCCESS == res) {
+				statsGpuFrameMilliseconds += (ticks[2] - ticks[0]) * deviceProps.limits.timestampPeriod * 1e-6;
+				statsGpuCullMilliseconds += (ticks[1] - ticks[0]) * deviceProps.limits.timestampPeriod * 1e-6;
+				++statsGpuFrames;
+			}
+		}
+
 		assert(frameIndex < imageAvailable.size());
 
 		std::uint32_t imageIndex = 0;
@@ -1364,20 +1720,70 @@ int main() try
 		aFramebuffers.deferredShadingFramebuffer = deferredShadingFramebuffers[imageIndex].handle;
 		aFramebuffers.shadowOffscreenFramebuffer = shadowFramebuffers[imageIndex].handle;
 
+		SceneDraws sceneDraws{
+			drawBatches,
+			meshBounds,
+			indirectBuffers[frameIndex].buffer,
+			indirectBuffers[frameIndex].allocation,
+			indirectCommands[frameIndex],
+			allocator.allocator,
+			&cullStats,
+			culledCommandBuffers[frameIndex].buffer,
+			drawCountBuffers[frameIndex].buffer,
+			drawCountBuffers[frameIndex].allocation,
+			drawCounts[frameIndex],
+			depthPyramid,
+			DdepthBuffer.image,
+			timestampPool.handle,
+			std::uint32_t(frameIndex) * cfg::kTimestampsPerFrame
+		};
+
+		timestampsWritten[frameIndex] = VK_NULL_HANDLE != timestampPool.handle;
+
+		descriptorSets.cullDescriptor = cullDescriptors[frameIndex];
+
 		record_commands(
 			cbuffers[frameIndex],
 			renderPasses,
 			aFramebuffers,
 			pipelines,
 			window.swapchainExtent,
+			sceneGeometry,
+			sceneDraws,
 			meshData,
 			ubos,
 			uniforms,
 			pipelineLayouts,
 			descriptorSets,
-			state
+			state,
+			shadowCache
 		);
 
+		// Print the culling results every now and then
+		statsTime += dt;
+		statsCullMicroseconds += cullStats.cullMicroseconds;
+		++statsFrames;
+
+		if (statsTime >= cfg::kStatsInterval) {
+			if (cullStats.onGpu)
+				std::printf("GPU culling: %u meshes visible, %u culled (%u by occlusion)\n", cullStats.visible, cullStats.culled, cullStats.occluded);
+			else
+				std::printf("Culling: %u meshes visible, %u culled (%.1f us/frame)\n", cullStats.visible, cullStats.culled, statsCullMicroseconds / statsFrames);
+
+			std::printf("Shadow casters: %u of %zu meshes\n", cullStats.shadowCasters, meshData.size());
+
+			// Culling includes the depth prepass and the depth pyramid when occlusion culling is on
+			if (statsGpuFrames > 0)
+				std::printf("GPU time: %.2f ms/frame (%.2f ms culling)\n", statsGpuFrameMilliseconds / statsGpuFrames, statsGpuCullMilliseconds / statsGpuFrames);
+
+			statsTime = 0.0f;
+			statsCullMicroseconds = 0.0f;
+			statsFrames = 0;
+			statsGpuFrameMilliseconds = 0.0;
+			statsGpuCullMilliseconds = 0.0;
+			statsGpuFrames = 0;
+		}
+
 		assert(std::size_t(frameIndex) < renderFinished.size());
 		
 		submit_commands(
@@ -1473,6 +1879,31 @@ namespace {
 					// Toggle shadows
 					state->shadows = !state->shadows;
 					break;
+				case GLFW_KEY_C:
+					// Toggle frustum culling
+					state->frustumCulling = !state->frustumCulling;
+					std::printf("Frustum culling %s\n", state->frustumCulling ? "on" : "off");
+					break;
+				case GLFW_KEY_G:
+					// Toggle between culling on the GPU and on the CPU
+					state->gpuCulling = !state->gpuCulling;
+					std::printf("Culling on the %s\n", state->gpuCulling ? "GPU" : "CPU");
+					break;
+				case GLFW_KEY_O:
+					// Toggle occlusion culling (GPU culling only)
+					state->occlusionCulling = !state->occlusionCulling;
+					std::printf("Occlusion culling %s\n", state->occlusionCulling ? "on" : "off");
+					break;
+				case GLFW_KEY_L:
+					// Toggle culling of shadow casters against the light's frustum
+					state->shadowCasterCulling = !state->shadowCasterCulling;
+					std::printf("Shadow caster culling %s\n", state->shadowCasterCulling ? "on" : "off");
+					break;
+				case GLFW_KEY_R:
+					// Toggle culling of shadow casters against the camera's frustum (receivers)
+					state->shadowReceiverCulling = !state->shadowReceiverCulling;
+					std::printf("Shadow receiver culling %s\n", state->shadowReceiverCulling ? "on" : "off");
+					break;
 				default:
 				;
 			}
@@ -2016,13 +2447,72 @@ namespace {
 		return lut::RenderPass(aWindow.device, rpass);
 	}
 
+	lut::RenderPass create_depth_prepass_render_pass(const lut::VulkanWindow& aWindow) {
+		// Depth only; the depth buffer is left for the depth pyramid, and cleared again by the main passes
+		VkAttachmentDescription attachments[1]{};
+		attachments[0].format = cfg::kDepthFormat;
+		attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+		attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		attachments[0].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+		VkAttachmentReference depthAttachment{};
+		depthAttachment.attachment = 0;
+		depthAttachment.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+		VkSubpassDescription subpasses[1]{};
+		subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpasses[0].colorAttachmentCount = 0;
+		subpasses[0].pDepthStencilAttachment = &depthAttachment;
+
+		VkSubpassDependency deps[2]{};
+		deps[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+		deps[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		deps[0].srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		deps[0].dstSubpass = 0;
+		deps[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		deps[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+		deps[1].srcSubpass = 0;
+		deps[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		deps[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		deps[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+		deps[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		deps[1].dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+		VkRenderPassCreateInfo passInfo{};
+		passInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		passInfo.attachmentCount = 1;
+		passInfo.pAttachments = attachments;
+		passInfo.subpassCount = 1;
+		passInfo.pSubpasses = subpasses;
+		passInfo.dependencyCount = 2;
+		passInfo.pDependencies = deps;
+
+		VkRenderPass rpass = VK_NULL_HANDLE;
+		if (const auto res = vkCreateRenderPass(aWindow.device, &passInfo, nullptr, &rpass); VK_SUCCESS != res) {
+			throw lut::Error("Unable to create render pass\n vkCreateRenderPass() returned %s\n", lut::to_string(res).c_str());
+		}
+
+		return lut::RenderPass(aWindow.device, rpass);
+	}
+
 	lut::DescriptorSetLayout create_scene_descriptor_layout(const lut::VulkanWindow& aWindow) {
-		VkDescriptorSetLayoutBinding bindings[1]{};
+		VkDescriptorSetLayoutBinding bindings[2]{};
 		bindings[0].binding = 0;
 		bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 		bindings[0].descriptorCount = 1;
 		bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 
+		// Per mesh data, see SceneGeometry::meshes
+		bindings[1].binding = 1;
+		bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[1].descriptorCount = 1;
+		bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
 		VkDescriptorSetLayoutCreateInfo layoutInfo{};
 		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
 		layoutInfo.bindingCount = sizeof(bindings) / sizeof(bindings[0]);
@@ -2035,33 +2525,26 @@ namespace {
 		return lut::DescriptorSetLayout(aWindow.device, layout);
 	}
 
-	lut::DescriptorSetLayout create_material_descriptor_layout(const lut::VulkanWindow& aWindow) {
-		VkDescriptorSetLayoutBinding bindings[5]{};
+	lut::DescriptorSetLayout create_material_descriptor_layout(const lut::VulkanWindow& aWindow, std::uint32_t aTextureCount) {
+		// Bindless materials: all textures of the model in one array, indexed through the
+		// material buffer (glsl::MaterialInfo)
+		VkPhysicalDeviceProperties props;
+		vkGetPhysicalDeviceProperties(aWindow.physicalDevice, &props);
+
+		if (aTextureCount > props.limits.maxPerStageDescriptorSamplers || aTextureCount > props.limits.maxPerStageDescriptorSampledImages || aTextureCount > props.limits.maxDescriptorSetSamplers)
+			throw lut::Error("Model has %u textures, which exceeds the device's per stage/set sampler limits", aTextureCount);
+
+		VkDescriptorSetLayoutBinding bindings[2]{};
 		bindings[0].binding = 0;
 		bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		bindings[0].descriptorCount = 1;
+		bindings[0].descriptorCount = std::max(aTextureCount, 1u);
 		bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
 		bindings[1].binding = 1;
-		bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 		bindings[1].descriptorCount = 1;
 		bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-		bindings[2].binding = 2;
-		bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		bindings[2].descriptorCount = 1;
-		bindings[2].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-		bindings[3].binding = 3;
-		bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		bindings[3].descriptorCount = 1;
-		bindings[3].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-		bindings[4].binding = 4;
-		bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		bindings[4].descriptorCount = 1;
-		bindings[4].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
 		VkDescriptorSetLayoutCreateInfo layoutInfo{};
 		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
 		layoutInfo.bindingCount = sizeof(bindings) / sizeof(bindings[0]);
@@ -2199,13 +2682,39 @@ namespace {
 		return lut::DescriptorSetLayout(aWindow.device, layout);
 	}
 
-	lut::PipelineLayout create_pipeline_layout(const lut::VulkanWindow& aWindow, std::vector<VkDescriptorSetLayout>& aDescriptorSetLayouts) {
-		VkPipelineLayoutCreateInfo layoutInfo{};
-		layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		layoutInfo.setLayoutCount = aDescriptorSetLayouts.size();
-		layoutInfo.pSetLayouts = aDescriptorSetLayouts.data();
-		layoutInfo.pushConstantRangeCount = 0;
-		layoutInfo.pPushConstantRanges = nullptr;
+	lut::DescriptorSetLayout create_cull_descriptor_layout(const lut::VulkanWindow& aWindow) {
+		// Binding 0: per frame data (glsl::CullUniform), 1: per mesh bounds and index ranges, 
+		// 2: levels of detail, 3: draw commands (output), 4: draw counts (output), 5: per mesh
+		// visibility for occlusion culling, 6: depth pyramid
+		VkDescriptorSetLayoutBinding bindings[7]{};
+		for (std::uint32_t i = 0; i < 7; i++) {
+			bindings[i].binding = i;
+			bindings[i].descriptorType = 0 == i ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindings[i].descriptorCount = 1;
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+
+		bindings[6].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = sizeof(bindings) / sizeof(bindings[0]);
+		layoutInfo.pBindings = bindings;
+
+		VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+		if (const auto res = vkCreateDescriptorSetLayout(aWindow.device, &layoutInfo, nullptr, &layout); VK_SUCCESS != res)
+			throw lut::Error("Unable to create descriptor set layout\n vkCreateDescriptorSetLayout() returned %s", lut::to_string(res).c_str());
+
+		return lut::DescriptorSetLayout(aWindow.device, layout);
+	}
+
+	lut::PipelineLayout create_pipeline_layout(const lut::VulkanWindow& aWindow, std::vector<VkDescriptorSetLayout>& aDescriptorSetLayouts) {
+		VkPipelineLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		layoutInfo.setLayoutCount = aDescriptorSetLayouts.size();
+		layoutInfo.pSetLayouts = aDescriptorSetLayouts.data();
+		layoutInfo.pushConstantRangeCount = 0;
+		layoutInfo.pPushConstantRanges = nullptr;
 
 		VkPipelineLayout layout = VK_NULL_HANDLE;
 		if (const auto res = vkCreatePipelineLayout(aWindow.device, &layoutInfo, nullptr, &layout); VK_SUCCESS != res) {
@@ -2230,45 +2739,37 @@ namespace {
 		stages[1].module = frag.handle;
 		stages[1].pName = "main";
 
-		// Even though we pass the TBN frame, normals are kept in to allow me to compare and get the
-		// screenshots to compare against the TBN normal mapping for the report
-		VkVertexInputBindingDescription vertexInputs[4]{};
+		// The packed TBN quaternion is the only tangent frame data, normals are derived from it
+		VkVertexInputBindingDescription vertexInputs[3]{};
 		vertexInputs[0].binding = 0;
-		vertexInputs[0].stride = sizeof(float) * 3;
+		vertexInputs[0].stride = sizeof(std::uint16_t) * 4;
 		vertexInputs[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 		vertexInputs[1].binding = 1;
-		vertexInputs[1].stride = sizeof(float) * 2;
+		vertexInputs[1].stride = sizeof(std::uint16_t) * 2;
 		vertexInputs[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 		vertexInputs[2].binding = 2;
-		vertexInputs[2].stride = sizeof(float) * 3;
+		vertexInputs[2].stride = sizeof(std::uint32_t) * 1;
 		vertexInputs[2].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-		vertexInputs[3].binding = 3;
-		vertexInputs[3].stride = sizeof(std::uint32_t) * 1;
-		vertexInputs[3].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-		VkVertexInputAttributeDescription vertexAttributes[4]{};
+		VkVertexInputAttributeDescription vertexAttributes[3]{};
 		vertexAttributes[0].binding = 0;
 		vertexAttributes[0].location = 0;
-		vertexAttributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+		vertexAttributes[0].format = VK_FORMAT_R16G16B16A16_UNORM;
 		vertexAttributes[0].offset = 0;
 		vertexAttributes[1].binding = 1;
 		vertexAttributes[1].location = 1;
-		vertexAttributes[1].format = VK_FORMAT_R32G32_SFLOAT;
+		vertexAttributes[1].format = VK_FORMAT_R16G16_SFLOAT;
 		vertexAttributes[1].offset = 0;
 		vertexAttributes[2].binding = 2;
 		vertexAttributes[2].location = 2;
-		vertexAttributes[2].format = VK_FORMAT_R32G32B32_SFLOAT;
+		vertexAttributes[2].format = VK_FORMAT_A2R10G10B10_UNORM_PACK32;
 		vertexAttributes[2].offset = 0;
-		vertexAttributes[3].binding = 3;
-		vertexAttributes[3].location = 3;
-		vertexAttributes[3].format = VK_FORMAT_A2R10G10B10_UNORM_PACK32;
-		vertexAttributes[3].offset = 0;
 
 		VkPipelineVertexInputStateCreateInfo inputInfo{};
 		inputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-		inputInfo.vertexBindingDescriptionCount = 4;
+		inputInfo.vertexBindingDescriptionCount = 3;
 		inputInfo.pVertexBindingDescriptions = vertexInputs;
-		inputInfo.vertexAttributeDescriptionCount = 4;
+		inputInfo.vertexAttributeDescriptionCount = 3;
 		inputInfo.pVertexAttributeDescriptions = vertexAttributes;
 
 		VkPipelineInputAssemblyStateCreateInfo assemblyInfo{};
@@ -2367,45 +2868,37 @@ namespace {
 		stages[1].module = frag.handle;
 		stages[1].pName = "main";
 
-		// Even though we pass the TBN frame, normals are kept in to allow me to compare and get the
-		// screenshots to compare against the TBN normal mapping for the report
-		VkVertexInputBindingDescription vertexInputs[4]{};
+		// The packed TBN quaternion is the only tangent frame data, normals are derived from it
+		VkVertexInputBindingDescription vertexInputs[3]{};
 		vertexInputs[0].binding = 0;
-		vertexInputs[0].stride = sizeof(float) * 3;
+		vertexInputs[0].stride = sizeof(std::uint16_t) * 4;
 		vertexInputs[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 		vertexInputs[1].binding = 1;
-		vertexInputs[1].stride = sizeof(float) * 2;
+		vertexInputs[1].stride = sizeof(std::uint16_t) * 2;
 		vertexInputs[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 		vertexInputs[2].binding = 2;
-		vertexInputs[2].stride = sizeof(float) * 3;
+		vertexInputs[2].stride = sizeof(std::uint32_t) * 1;
 		vertexInputs[2].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-		vertexInputs[3].binding = 3;
-		vertexInputs[3].stride = sizeof(std::uint32_t) * 1;
-		vertexInputs[3].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-		VkVertexInputAttributeDescription vertexAttributes[4]{};
+		VkVertexInputAttributeDescription vertexAttributes[3]{};
 		vertexAttributes[0].binding = 0;
 		vertexAttributes[0].location = 0;
-		vertexAttributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+		vertexAttributes[0].format = VK_FORMAT_R16G16B16A16_UNORM;
 		vertexAttributes[0].offset = 0;
 		vertexAttributes[1].binding = 1;
 		vertexAttributes[1].location = 1;
-		vertexAttributes[1].format = VK_FORMAT_R32G32_SFLOAT;
+		vertexAttributes[1].format = VK_FORMAT_R16G16_SFLOAT;
 		vertexAttributes[1].offset = 0;
 		vertexAttributes[2].binding = 2;
 		vertexAttributes[2].location = 2;
-		vertexAttributes[2].format = VK_FORMAT_R32G32B32_SFLOAT;
+		vertexAttributes[2].format = VK_FORMAT_A2R10G10B10_UNORM_PACK32;
 		vertexAttributes[2].offset = 0;
-		vertexAttributes[3].binding = 3;
-		vertexAttributes[3].location = 3;
-		vertexAttributes[3].format = VK_FORMAT_A2R10G10B10_UNORM_PACK32;
-		vertexAttributes[3].offset = 0;
 
 		VkPipelineVertexInputStateCreateInfo inputInfo{};
 		inputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-		inputInfo.vertexBindingDescriptionCount = 4;
+		inputInfo.vertexBindingDescriptionCount = 3;
 		inputInfo.pVertexBindingDescriptions = vertexInputs;
-		inputInfo.vertexAttributeDescriptionCount = 4;
+		inputInfo.vertexAttributeDescriptionCount = 3;
 		inputInfo.pVertexAttributeDescriptions = vertexAttributes;
 
 		VkPipelineInputAssemblyStateCreateInfo assemblyInfo{};
@@ -2505,20 +2998,20 @@ namespace {
 
 		VkVertexInputBindingDescription vertexInputs[2]{};
 		vertexInputs[0].binding = 0;
-		vertexInputs[0].stride = sizeof(float) * 3;
+		vertexInputs[0].stride = sizeof(std::uint16_t) * 4;
 		vertexInputs[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 		vertexInputs[1].binding = 1;
-		vertexInputs[1].stride = sizeof(float) * 2;
+		vertexInputs[1].stride = sizeof(std::uint16_t) * 2;
 		vertexInputs[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
 		VkVertexInputAttributeDescription vertexAttributes[2]{};
 		vertexAttributes[0].binding = 0;
 		vertexAttributes[0].location = 0;
-		vertexAttributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+		vertexAttributes[0].format = VK_FORMAT_R16G16B16A16_UNORM;
 		vertexAttributes[0].offset = 0;
 		vertexAttributes[1].binding = 1;
 		vertexAttributes[1].location = 1;
-		vertexAttributes[1].format = VK_FORMAT_R32G32_SFLOAT;
+		vertexAttributes[1].format = VK_FORMAT_R16G16_SFLOAT;
 		vertexAttributes[1].offset = 0;
 
 		VkPipelineVertexInputStateCreateInfo inputInfo{};
@@ -2715,13 +3208,13 @@ namespace {
 
 		VkVertexInputBindingDescription vertexInputs[1]{};
 		vertexInputs[0].binding = 0;
-		vertexInputs[0].stride = sizeof(float) * 3;
+		vertexInputs[0].stride = sizeof(std::uint16_t) * 4;
 		vertexInputs[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
 		VkVertexInputAttributeDescription vertexAttributes[1]{};
 		vertexAttributes[0].binding = 0;
 		vertexAttributes[0].location = 0;
-		vertexAttributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+		vertexAttributes[0].format = VK_FORMAT_R16G16B16A16_UNORM;
 		vertexAttributes[0].offset = 0;
 
 		VkPipelineVertexInputStateCreateInfo inputInfo{};
@@ -2874,45 +3367,37 @@ namespace {
 		stages[1].module = frag.handle;
 		stages[1].pName = "main";
 
-		// Even though we pass the TBN frame, normals are kept in to allow me to compare and get the
-		// screenshots to compare against the TBN normal mapping for the report
-		VkVertexInputBindingDescription vertexInputs[4]{};
+		// The packed TBN quaternion is the only tangent frame data, normals are derived from it
+		VkVertexInputBindingDescription vertexInputs[3]{};
 		vertexInputs[0].binding = 0;
-		vertexInputs[0].stride = sizeof(float) * 3;
+		vertexInputs[0].stride = sizeof(std::uint16_t) * 4;
 		vertexInputs[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 		vertexInputs[1].binding = 1;
-		vertexInputs[1].stride = sizeof(float) * 2;
+		vertexInputs[1].stride = sizeof(std::uint16_t) * 2;
 		vertexInputs[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 		vertexInputs[2].binding = 2;
-		vertexInputs[2].stride = sizeof(float) * 3;
+		vertexInputs[2].stride = sizeof(std::uint32_t) * 1;
 		vertexInputs[2].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-		vertexInputs[3].binding = 3;
-		vertexInputs[3].stride = sizeof(std::uint32_t) * 1;
-		vertexInputs[3].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-		VkVertexInputAttributeDescription vertexAttributes[4]{};
+		VkVertexInputAttributeDescription vertexAttributes[3]{};
 		vertexAttributes[0].binding = 0;
 		vertexAttributes[0].location = 0;
-		vertexAttributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+		vertexAttributes[0].format = VK_FORMAT_R16G16B16A16_UNORM;
 		vertexAttributes[0].offset = 0;
 		vertexAttributes[1].binding = 1;
 		vertexAttributes[1].location = 1;
-		vertexAttributes[1].format = VK_FORMAT_R32G32_SFLOAT;
+		vertexAttributes[1].format = VK_FORMAT_R16G16_SFLOAT;
 		vertexAttributes[1].offset = 0;
 		vertexAttributes[2].binding = 2;
 		vertexAttributes[2].location = 2;
-		vertexAttributes[2].format = VK_FORMAT_R32G32B32_SFLOAT;
+		vertexAttributes[2].format = VK_FORMAT_A2R10G10B10_UNORM_PACK32;
 		vertexAttributes[2].offset = 0;
-		vertexAttributes[3].binding = 3;
-		vertexAttributes[3].location = 3;
-		vertexAttributes[3].format = VK_FORMAT_A2R10G10B10_UNORM_PACK32;
-		vertexAttributes[3].offset = 0;
 
 		VkPipelineVertexInputStateCreateInfo inputInfo{};
 		inputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-		inputInfo.vertexBindingDescriptionCount = 4;
+		inputInfo.vertexBindingDescriptionCount = 3;
 		inputInfo.pVertexBindingDescriptions = vertexInputs;
-		inputInfo.vertexAttributeDescriptionCount = 4;
+		inputInfo.vertexAttributeDescriptionCount = 3;
 		inputInfo.pVertexAttributeDescriptions = vertexAttributes;
 
 		VkPipelineInputAssemblyStateCreateInfo assemblyInfo{};
@@ -3062,13 +3547,13 @@ namespace {
 
 		VkVertexInputBindingDescription vertexInputs[1]{};
 		vertexInputs[0].binding = 0;
-		vertexInputs[0].stride = sizeof(float) * 3;
+		vertexInputs[0].stride = sizeof(std::uint16_t) * 4;
 		vertexInputs[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
 		VkVertexInputAttributeDescription vertexAttributes[1]{};
 		vertexAttributes[0].binding = 0;
 		vertexAttributes[0].location = 0;
-		vertexAttributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+		vertexAttributes[0].format = VK_FORMAT_R16G16B16A16_UNORM;
 		vertexAttributes[0].offset = 0;
 
 		VkPipelineVertexInputStateCreateInfo inputInfo{};
@@ -3161,6 +3646,173 @@ namespace {
 		return lut::Pipeline(aWindow.device, pipe);
 	}
 
+	lut::Pipeline create_depth_prepass_pipeline(const lut::VulkanWindow& aWindow, VkRenderPass aRenderPass, VkPipelineLayout aPipelineLayout) {
+		// Positions only, and no fragment shader: occluders are opaque, so only depth is needed
+		lut::ShaderModule vert = lut::load_shader_module(aWindow, cfg::kOverVisWriteVertShaderPath);
+
+		VkPipelineShaderStageCreateInfo stages[1]{};
+		stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+		stages[0].module = vert.handle;
+		stages[0].pName = "main";
+
+		VkVertexInputBindingDescription vertexInputs[1]{};
+		vertexInputs[0].binding = 0;
+		vertexInputs[0].stride = sizeof(std::uint16_t) * 4;
+		vertexInputs[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		VkVertexInputAttributeDescription vertexAttributes[1]{};
+		vertexAttributes[0].binding = 0;
+		vertexAttributes[0].location = 0;
+		vertexAttributes[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+		vertexAttributes[0].offset = 0;
+
+		VkPipelineVertexInputStateCreateInfo inputInfo{};
+		inputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		inputInfo.vertexBindingDescriptionCount = 1;
+		inputInfo.pVertexBindingDescriptions = vertexInputs;
+		inputInfo.vertexAttributeDescriptionCount = 1;
+		inputInfo.pVertexAttributeDescriptions = vertexAttributes;
+
+		VkPipelineInputAssemblyStateCreateInfo assemblyInfo{};
+		assemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		assemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		assemblyInfo.primitiveRestartEnable = VK_FALSE;
+
+		VkViewport viewport{};
+		viewport.x = 0.0f;
+		viewport.y = 0.0f;
+		viewport.width = float(aWindow.swapchainExtent.width);
+		viewport.height = float(aWindow.swapchainExtent.height);
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+
+		VkRect2D scissor{};
+		scissor.offset = VkOffset2D{ 0, 0 };
+		scissor.extent = aWindow.swapchainExtent;
+
+		VkPipelineViewportStateCreateInfo viewportInfo{};
+		viewportInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		viewportInfo.viewportCount = 1;
+		viewportInfo.pViewports = &viewport;
+		viewportInfo.scissorCount = 1;
+		viewportInfo.pScissors = &scissor;
+
+		VkPipelineRasterizationStateCreateInfo rasterInfo{};
+		rasterInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		rasterInfo.depthClampEnable = VK_FALSE;
+		rasterInfo.rasterizerDiscardEnable = VK_FALSE;
+		rasterInfo.polygonMode = VK_POLYGON_MODE_FILL;
+		rasterInfo.cullMode = VK_CULL_MODE_BACK_BIT;
+		rasterInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+		rasterInfo.depthBiasEnable = VK_FALSE;
+		rasterInfo.lineWidth = 1.0f;
+
+		VkPipelineMultisampleStateCreateInfo samplingInfo{};
+		samplingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		samplingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+		VkPipelineColorBlendAttachmentState blendStates[1]{};
+		blendStates[0].blendEnable = VK_FALSE;
+		blendStates[0].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+		VkPipelineColorBlendStateCreateInfo blendInfo{};
+		blendInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		blendInfo.logicOpEnable = VK_FALSE;
+		blendInfo.attachmentCount = 0;
+		blendInfo.pAttachments = blendStates;
+
+		VkPipelineDepthStencilStateCreateInfo depthInfo{};
+		depthInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+		depthInfo.depthTestEnable = VK_TRUE;
+		depthInfo.depthWriteEnable = VK_TRUE;
+		depthInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+		depthInfo.minDepthBounds = 0.0f;
+		depthInfo.maxDepthBounds = 1.0f;
+
+		VkGraphicsPipelineCreateInfo pipeInfo{};
+		pipeInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipeInfo.stageCount = 1;
+		pipeInfo.pStages = stages;
+		pipeInfo.pVertexInputState = &inputInfo;
+		pipeInfo.pInputAssemblyState = &assemblyInfo;
+		pipeInfo.pTessellationState = nullptr;
+		pipeInfo.pViewportState = &viewportInfo;
+		pipeInfo.pRasterizationState = &rasterInfo;
+		pipeInfo.pMultisampleState = &samplingInfo;
+		pipeInfo.pDepthStencilState = &depthInfo;
+		pipeInfo.pColorBlendState = &blendInfo;
+		pipeInfo.pDynamicState = nullptr;
+		pipeInfo.layout = aPipelineLayout;
+		pipeInfo.renderPass = aRenderPass;
+		pipeInfo.subpass = 0;
+
+		VkPipeline pipe = VK_NULL_HANDLE;
+		if (const auto res = vkCreateGraphicsPipelines(aWindow.device, VK_NULL_HANDLE, 1, &pipeInfo, nullptr, &pipe); VK_SUCCESS != res) {
+			throw lut::Error("Unable to create graphics pipeline\n vkCreateGraphicsPipeline() returned %s", lut::to_string(res).c_str());
+		}
+
+		return lut::Pipeline(aWindow.device, pipe);
+	}
+
+	lut::Pipeline create_cull_pipeline(const lut::VulkanWindow& aWindow, VkPipelineLayout aPipelineLayout, std::uint32_t aPhase) {
+		lut::ShaderModule comp = lut::load_shader_module(aWindow, cfg::kCullCompShaderPath);
+
+		VkPipelineShaderStageCreateInfo stage{};
+		stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		stage.module = comp.handle;
+		stage.pName = "main";
+
+		// Selects the phase (kPhase in cull.comp)
+		VkSpecializationMapEntry phaseEntry{};
+		phaseEntry.constantID = 0;
+		phaseEntry.offset = 0;
+		phaseEntry.size = sizeof(std::uint32_t);
+
+		VkSpecializationInfo specInfo{};
+		specInfo.mapEntryCount = 1;
+		specInfo.pMapEntries = &phaseEntry;
+		specInfo.dataSize = sizeof(aPhase);
+		specInfo.pData = &aPhase;
+
+		stage.pSpecializationInfo = &specInfo;
+
+		VkComputePipelineCreateInfo pipeInfo{};
+		pipeInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipeInfo.stage = stage;
+		pipeInfo.layout = aPipelineLayout;
+
+		VkPipeline pipe = VK_NULL_HANDLE;
+		if (const auto res = vkCreateComputePipelines(aWindow.device, VK_NULL_HANDLE, 1, &pipeInfo, nullptr, &pipe); VK_SUCCESS != res) {
+			throw lut::Error("Unable to create compute pipeline\n vkCreateComputePipelines() returned %s", lut::to_string(res).c_str());
+		}
+
+		return lut::Pipeline(aWindow.device, pipe);
+	}
+
+	lut::Pipeline create_depth_pyramid_pipeline(const lut::VulkanWindow& aWindow, VkPipelineLayout aPipelineLayout) {
+		lut::ShaderModule comp = lut::load_shader_module(aWindow, cfg::kDepthPyramidCompShaderPath);
+
+		VkPipelineShaderStageCreateInfo stage{};
+		stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		stage.module = comp.handle;
+		stage.pName = "main";
+
+		VkComputePipelineCreateInfo pipeInfo{};
+		pipeInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipeInfo.stage = stage;
+		pipeInfo.layout = aPipelineLayout;
+
+		VkPipeline pipe = VK_NULL_HANDLE;
+		if (const auto res = vkCreateComputePipelines(aWindow.device, VK_NULL_HANDLE, 1, &pipeInfo, nullptr, &pipe); VK_SUCCESS != res) {
+			throw lut::Error("Unable to create compute pipeline\n vkCreateComputePipelines() returned %s", lut::to_string(res).c_str());
+		}
+
+		return lut::Pipeline(aWindow.device, pipe);
+	}
+
 	std::tuple<lut::Image, lut::ImageView> create_depth_buffer(const lut::VulkanWindow& aWindow, const lut::Allocator& aAllocator, VkImageAspectFlagBits aImageAspectFlagBits) {
 		VkImageCreateInfo imageInfo{};
 		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -3173,7 +3825,7 @@ namespace {
 		imageInfo.arrayLayers = 1;
 		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-		imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+		imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT; // Sampled: depth pyramid
 		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 
@@ -3618,6 +4270,26 @@ namespace {
 		assert(aWindow.swapViews.size() == aFramebuffers.size());
 	}
 
+	lut::Framebuffer create_depth_prepass_framebuffer(const lut::VulkanWindow& aWindow, VkRenderPass aRenderPass, VkImageView aDepthView) {
+		VkImageView attachments[1] = { aDepthView };
+
+		VkFramebufferCreateInfo fbInfo{};
+		fbInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		fbInfo.flags = 0;
+		fbInfo.renderPass = aRenderPass;
+		fbInfo.attachmentCount = 1;
+		fbInfo.pAttachments = attachments;
+		fbInfo.width = aWindow.swapchainExtent.width;
+		fbInfo.height = aWindow.swapchainExtent.height;
+		fbInfo.layers = 1;
+
+		VkFramebuffer fb = VK_NULL_HANDLE;
+		if (const auto res = vkCreateFramebuffer(aWindow.device, &fbInfo, nullptr, &fb); VK_SUCCESS != res)
+			throw lut::Error("Unable to create framebuffer\n vkCreateFramebuffer() returned %s", lut::to_string(res).c_str());
+
+		return lut::Framebuffer(aWindow.device, fb);
+	}
+
 	lut::ImageView load_mesh_texture(const lut::VulkanWindow& aWindow, VkCommandPool aCmdPool, const lut::Allocator& aAllocator, BakedTextureInfo aBakedTextureInfo) {
 		VkFormat format = aBakedTextureInfo.space == ETextureSpace::srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
 
@@ -3706,18 +4378,35 @@ namespace {
 		aDepthUniform.depthMVP = depthProjection * depthView;
 	}
 
+	const BakedMeshLod& select_lod(const MeshData& aMesh, const glm::vec3& aCameraPos, float aPixelsPerUnit) {
+		// Distance to the closest point of the bounding sphere. Clamping to the near plane keeps the 
+		// full detail mesh when the camera is inside the bounds.
+		const float distance = std::max(glm::length(aMesh.boundsCenter - aCameraPos) - aMesh.boundsRadius, cfg::kCameraNear);
+
+		// Levels are ordered by increasing error; pick the coarsest one that projects to at most
+		// cfg::kLodPixelError pixels
+		std::size_t lod = 0;
+		while (lod + 1 < aMesh.lods.size() && aMesh.lods[lod + 1].error * aPixelsPerUnit / distance <= cfg::kLodPixelError)
+			++lod;
+
+		return aMesh.lods[lod];
+	}
+
 	void record_commands(
 		VkCommandBuffer aCmdBuff,
 		RenderPasses aRenderPasses,
 		Framebuffers aFramebuffers,
 		Pipelines aPipelines,
 		const VkExtent2D& aExtent,
+		const SceneGeometry& aGeometry,
+		const SceneDraws& aDraws,
 		std::vector<MeshData>& aMeshData,
 		UBOs aUBOs,
 		Uniforms aUniforms,
 		PipelineLayouts aPipelineLayouts,
 		DescriptorSets aDescriptorSets,
-		const UserState& aState
+		const UserState& aState,
+		ShadowCache& aShadowCache
 	) {
 		VkCommandBufferBeginInfo begInfo{};
 		begInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -3728,6 +4417,155 @@ namespace {
 			throw lut::Error("Unable to begin recording command buffer\n vkBeginCommandBuffer() returned %s", lut::to_string(res).c_str());
 		}
 
+		// Timestamps: start of the frame, end of culling, end of the frame
+		if (VK_NULL_HANDLE != aDraws.timestamps) {
+			vkCmdResetQueryPool(aCmdBuff, aDraws.timestamps, aDraws.firstTimestamp, cfg::kTimestampsPerFrame);
+			vkCmdWriteTimestamp(aCmdBuff, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, aDraws.timestamps, aDraws.firstTimestamp);
+		}
+
+		// Select level of detail per mesh based on the projected simplification error. The same level 
+		// is used in all camera passes. The shadow pass always draws the full detail meshes, so that 
+		// the cached shadow map does not depend on the camera (see ShadowCache).
+		const float pixelsPerUnit = aExtent.height / (2.0f * std::tan(0.5f * lut::Radians(cfg::kCameraFov).value()));
+		const glm::vec3 cameraPos(aUniforms.sceneUniforms.camPos);
+
+		// The cached shadow map is out of date if the light has moved, or if the set of casters has changed
+		const bool renderShadowMap = !aShadowCache.valid 
+			|| aShadowCache.depthMVP != aUniforms.depthMVPUniform.depthMVP
+			|| aShadowCache.receiverCulling != aState.shadowReceiverCulling
+			|| (aState.shadowReceiverCulling && aShadowCache.projCam != aUniforms.sceneUniforms.projCam);
+
+		// Commands of each batch, per view (CPU culling only)
+		std::vector<DrawRange> drawRanges[kDrawViewCount];
+
+		if (aState.gpuCulling) {
+			// The counts written by the previous use of this frame's buffers (the frame's fence
+			// has been waited for), so the statistics lag a few frames behind
+			if (const auto res = vmaInvalidateAllocation(aDraws.allocator, aDraws.drawCountAllocation, 0, VK_WHOLE_SIZE); VK_SUCCESS != res)
+				throw lut::Error("Unable to invalidate draw counts\n vmaInvalidateAllocation() returned %s", lut::to_string(res).c_str());
+
+			std::uint32_t visible = 0;
+			for (std::size_t b = 0; b < aDraws.batches.size(); b++)
+				visible += aDraws.drawCounts[kDrawViewCamera * aDraws.batches.size() + b];
+
+			// Meshes culled by occlusion are counted after the per batch counts
+			const auto occluded = aDraws.drawCounts[kDrawViewCount * aDraws.batches.size()];
+
+			std::uint32_t shadowCasters = 0;
+			for (std::size_t b = 0; b < aDraws.batches.size(); b++)
+				shadowCasters += aDraws.drawCounts[kDrawViewShadow * aDraws.batches.size() + b];
+
+			*aDraws.stats = CullStats{ visible, std::uint32_t(aMeshData.size()) - std::min(visible, std::uint32_t(aMeshData.size())), occluded, shadowCasters, 0.0f, true };
+		}
+		else {
+			// Write the commands of the meshes in aVisible (sorted by mesh index) to the given view's
+			// part of the indirect buffer
+			const auto write_view = [&](EDrawView aView, const std::vector<std::uint32_t>& aVisible) {
+				auto& ranges = drawRanges[aView];
+				ranges.resize(aDraws.batches.size());
+
+				auto command = std::uint32_t(aView * aMeshData.size());
+				std::size_t next = 0;
+				for (std::size_t b = 0; b < aDraws.batches.size(); b++) {
+					const auto& batch = aDraws.batches[b];
+					ranges[b].firstCommand = command;
+
+					for (; next < aVisible.size() && aVisible[next] < batch.firstMesh + batch.meshCount; ++next, ++command) {
+						const auto i = aVisible[next];
+						const auto& mesh = aMeshData[i];
+						const auto& lod = kDrawViewShadow == aView ? mesh.lods.front() : select_lod(mesh, cameraPos, pixelsPerUnit);
+
+						auto& cmd = aDraws.commands[command];
+						cmd.indexCount = lod.indexCount;
+						cmd.instanceCount = 1;
+						cmd.firstIndex = mesh.firstIndex + lod.firstIndex;
+						cmd.vertexOffset = mesh.vertexOffset;
+						cmd.firstInstance = i;
+					}
+
+					ranges[b].commandCount = command - ranges[b].firstCommand;
+				}
+			};
+
+			std::vector<std::uint32_t> allMeshes(aMeshData.size());
+			std::iota(allMeshes.begin(), allMeshes.end(), 0u);
+
+			// Camera passes only draw the meshes in the view frustum
+			std::vector<std::uint32_t> cameraVisible;
+			const auto cullStart = Clock_::now();
+
+			if (aState.frustumCulling)
+				cull_frustum(aDraws.bounds, make_frustum(aUniforms.sceneUniforms.projCam), cameraVisible);
+			else
+				cameraVisible = allMeshes;
+
+			aDraws.stats->cullMicroseconds = std::chrono::duration<float, std::micro>(Clock_::now() - cullStart).count();
+			aDraws.stats->visible = std::uint32_t(cameraVisible.size());
+			aDraws.stats->culled = std::uint32_t(aMeshData.size() - cameraVisible.size());
+			aDraws.stats->occluded = 0;
+			aDraws.stats->onGpu = false;
+
+			write_view(kDrawViewCamera, cameraVisible);
+
+			// Shadow casters, against the light's frustum and optionally the camera's
+			if (renderShadowMap) {
+				std::vector<std::uint32_t> casters;
+
+				if (aState.shadowCasterCulling)
+					cull_frustum(aDraws.bounds, make_frustum(aUniforms.depthMVPUniform.depthMVP), casters);
+				else
+					casters = allMeshes;
+
+				if (aState.shadowReceiverCulling)
+					cull_shadow_casters(aDraws.bounds, make_frustum(aUniforms.sceneUniforms.projCam), glm::vec3(aUniforms.lightUniforms.lightPos), cfg::kCameraFar, casters);
+
+				aDraws.stats->shadowCasters = std::uint32_t(casters.size());
+				write_view(kDrawViewShadow, casters);
+			}
+
+			// Host writes are made visible to the device by the queue submission
+			if (const auto res = vmaFlushAllocation(aDraws.allocator, aDraws.indirectAllocation, 0, VK_WHOLE_SIZE); VK_SUCCESS != res)
+				throw lut::Error("Unable to flush indirect draw commands\n vmaFlushAllocation() returned %s", lut::to_string(res).c_str());
+		}
+
+		// All meshes live in the same buffers (see SceneGeometry), so each pass binds the vertex
+		// streams once. The index buffer is only rebound when the index type changes.
+		VkIndexType boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+		const auto bind_geometry = [&](std::uint32_t aStreamCount) {
+			const VkBuffer vbuffers[3] = { aGeometry.positions.buffer, aGeometry.texcoords.buffer, aGeometry.tangents.buffer };
+			const VkDeviceSize voffsets[3]{};
+
+			assert(aStreamCount <= 3);
+			vkCmdBindVertexBuffers(aCmdBuff, 0, aStreamCount, vbuffers, voffsets);
+			boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+		};
+
+		// Draw the batches with a matching alpha mask state (all batches if aAlphaMask is empty), using
+		// the commands of one view. That is one indirect draw per index type in use. Materials are
+		// bindless (set 1), and are selected in the shaders via the per mesh data.
+		const auto draw_batches = [&](std::optional<bool> aAlphaMask, EDrawView aView) {
+			for (std::size_t b = 0; b < aDraws.batches.size(); b++) {
+				const auto& batch = aDraws.batches[b];
+				if ((aAlphaMask && *aAlphaMask != batch.hasAlphaMask) || (!aState.gpuCulling && 0 == drawRanges[aView][b].commandCount))
+					continue;
+
+				if (batch.indexType != boundIndexType) {
+					vkCmdBindIndexBuffer(aCmdBuff, aGeometry.indices.buffer, 0, batch.indexType);
+					boundIndexType = batch.indexType;
+				}
+
+				if (aState.gpuCulling) {
+					const VkDeviceSize commandOffset = (VkDeviceSize(aView) * aMeshData.size() + batch.firstMesh) * sizeof(VkDrawIndexedIndirectCommand);
+					const VkDeviceSize countOffset = (VkDeviceSize(aView) * aDraws.batches.size() + b) * sizeof(std::uint32_t);
+					vkCmdDrawIndexedIndirectCount(aCmdBuff, aDraws.culledCommandBuffer, commandOffset, aDraws.drawCountBuffer, countOffset, batch.meshCount, sizeof(VkDrawIndexedIndirectCommand));
+				}
+				else {
+					const auto& range = drawRanges[aView][b];
+					vkCmdDrawIndexedIndirect(aCmdBuff, aDraws.indirectBuffer, VkDeviceSize(range.firstCommand) * sizeof(VkDrawIndexedIndirectCommand), range.commandCount, sizeof(VkDrawIndexedIndirectCommand));
+				}
+			}
+		};
+
 		// Scene UBO
 		lut::buffer_barrier(
 			aCmdBuff,
@@ -3832,6 +4670,123 @@ namespace {
 			VK_PIPELINE_STAGE_VERTEX_SHADER_BIT
 		);
 
+		if (aState.gpuCulling) {
+			// Culling, level of detail selection and command compaction in the cull compute shader
+			glsl::CullUniform cullUniform{};
+			cullUniform.projCam = aUniforms.sceneUniforms.projCam;
+			const Frustum cameraFrustum = make_frustum(aUniforms.sceneUniforms.projCam);
+			std::copy(std::begin(cameraFrustum.planes), std::end(cameraFrustum.planes), cullUniform.planes + kDrawViewCamera * 6);
+			cullUniform.cameraPos = aUniforms.sceneUniforms.camPos;
+			cullUniform.depthSize = glm::vec2(float(aExtent.width), float(aExtent.height));
+			cullUniform.pixelsPerUnit = pixelsPerUnit;
+			cullUniform.lodPixelError = cfg::kLodPixelError;
+			cullUniform.cameraNear = cfg::kCameraNear;
+			cullUniform.meshCount = std::uint32_t(aMeshData.size());
+			cullUniform.batchCount = std::uint32_t(aDraws.batches.size());
+			cullUniform.cullMask = aState.frustumCulling ? 1u << kDrawViewCamera : 0u;
+
+			// Shadow casters; the light's far plane (see update_depth_mvp_uniforms()) bounds the shadow range
+			const Frustum lightFrustum = make_frustum(aUniforms.depthMVPUniform.depthMVP);
+			std::copy(std::begin(lightFrustum.planes), std::end(lightFrustum.planes), cullUniform.planes + kDrawViewShadow * 6);
+			cullUniform.cullMask |= aState.shadowCasterCulling ? 1u << kDrawViewShadow : 0u;
+			cullUniform.lightPos = glm::vec4(glm::vec3(aUniforms.lightUniforms.lightPos), aState.shadowReceiverCulling ? cfg::kCameraFar : 0.0f);
+
+			lut::buffer_barrier(
+				aCmdBuff,
+				aUBOs.cullUBO,
+				VK_ACCESS_UNIFORM_READ_BIT,
+				VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_TRANSFER_BIT
+			);
+
+			vkCmdUpdateBuffer(aCmdBuff, aUBOs.cullUBO, 0, sizeof(glsl::CullUniform), &cullUniform);
+			vkCmdFillBuffer(aCmdBuff, aDraws.drawCountBuffer, 0, VK_WHOLE_SIZE, 0);
+
+			// Also orders the previous frame's visibility writes before this frame's reads
+			VkMemoryBarrier clearBarrier{};
+			clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			clearBarrier.dstAccessMask = VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+			vkCmdPipelineBarrier(aCmdBuff, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+			const auto dispatch_cull = [&](VkPipeline aPipeline) {
+				vkCmdBindPipeline(aCmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, aPipeline);
+				vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, aPipelineLayouts.cullPipelineLayout, 0, 1, &aDescriptorSets.cullDescriptor, 0, nullptr);
+				vkCmdDispatch(aCmdBuff, (std::uint32_t(aMeshData.size()) + 63) / 64, 1, 1);
+			};
+
+			if (aState.occlusionCulling) {
+				// Early phase: draw last frame's visible meshes into the depth buffer as occluders
+				dispatch_cull(aPipelines.cullEarlyPipeline);
+
+				VkMemoryBarrier earlyBarrier{};
+				earlyBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+				earlyBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+				earlyBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+
+				vkCmdPipelineBarrier(aCmdBuff, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &earlyBarrier, 0, nullptr, 0, nullptr);
+
+				VkClearValue clearValues[1]{};
+				clearValues[0].depthStencil.depth = 1.0f;
+
+				VkRenderPassBeginInfo passInfo{};
+				passInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+				passInfo.renderPass = aRenderPasses.depthPrepassRenderPass;
+				passInfo.framebuffer = aFramebuffers.depthPrepassFramebuffer;
+				passInfo.renderArea.offset = VkOffset2D{ 0, 0 };
+				passInfo.renderArea.extent = aExtent;
+				passInfo.clearValueCount = 1;
+				passInfo.pClearValues = clearValues;
+
+				vkCmdBeginRenderPass(aCmdBuff, &passInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+				vkCmdBindPipeline(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelines.depthPrepassPipeline);
+				bind_geometry(1);
+
+				vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelineLayouts.overVisWritePipelineLayout, 0, 1, &aDescriptorSets.sceneDescriptors, 0, nullptr);
+
+				// Alpha masked meshes have holes, so they do not occlude
+				draw_batches(false, kDrawViewOccluders);
+
+				vkCmdEndRenderPass(aCmdBuff);
+
+				record_depth_pyramid(aCmdBuff, aDraws.depthPyramid, aPipelines.depthPyramidPipeline, aPipelineLayouts.depthPyramidPipelineLayout);
+
+				// Late phase: test everything in the frustum against the pyramid, including meshes
+				// that were occluded last frame
+				dispatch_cull(aPipelines.cullLatePipeline);
+
+				// The main passes write the depth buffer again once the pyramid has been built
+				lut::image_barrier(
+					aCmdBuff,
+					aDraws.depthImage,
+					VK_ACCESS_SHADER_READ_BIT,
+					VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+					VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+					VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+					VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+					VkImageSubresourceRange{ VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT, 0, 1, 0, 1 }
+				);
+			}
+			else {
+				dispatch_cull(aPipelines.cullPipeline);
+			}
+
+			// Commands and counts are read by the indirect draws, and the counts by the host
+			VkMemoryBarrier cullBarrier{};
+			cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+
+			vkCmdPipelineBarrier(aCmdBuff, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+		}
+
+		if (VK_NULL_HANDLE != aDraws.timestamps)
+			vkCmdWriteTimestamp(aCmdBuff, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, aDraws.timestamps, aDraws.firstTimestamp + 1);
+
 		// Deferred shading
 		if (aState.deferredShading && !aState.mosaicEffect) {
 			VkClearValue clearValues[4]{};
@@ -3864,74 +4819,20 @@ namespace {
 			vkCmdBeginRenderPass(aCmdBuff, &passInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 			vkCmdBindPipeline(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelines.gBufWritePipline);
+			bind_geometry(3);
 
 			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelineLayouts.gBufWritePipelineLayout, 0, 1, &aDescriptorSets.sceneDescriptors, 0, nullptr);
+			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelineLayouts.gBufWritePipelineLayout, 1, 1, &aDescriptorSets.materialDescriptor, 0, nullptr);
 
 			vkCmdSetCullMode(aCmdBuff, VK_CULL_MODE_BACK_BIT);
 
 			// Draw all non alpha masked meshes
-			for (std::size_t i = 0; i < aMeshData.size(); i++) {
-				if (aMeshData[i].hasAlphaMask) continue;
-
-				vkCmdBindDescriptorSets(
-					aCmdBuff,
-					VK_PIPELINE_BIND_POINT_GRAPHICS,
-					aPipelineLayouts.gBufWritePipelineLayout,
-					1,
-					1,
-					&aDescriptorSets.materialDescriptors[aMeshData[i].materialId],
-					0,
-					nullptr
-				);
-
-				VkBuffer vbuffers[4] = {
-					aMeshData[i].positionBuffer.buffer,
-					aMeshData[i].texCoordBuffer.buffer,
-					aMeshData[i].normalsBuffer.buffer,
-					aMeshData[i].tangentsBuffer.buffer
-				};
-				VkBuffer ibuffer = aMeshData[i].indicesBuffer.buffer;
-				VkDeviceSize voffsets[4]{};
-				VkDeviceSize ioffset{};
-
-				vkCmdBindVertexBuffers(aCmdBuff, 0, 4, vbuffers, voffsets);
-				vkCmdBindIndexBuffer(aCmdBuff, ibuffer, ioffset, VK_INDEX_TYPE_UINT32);
-
-				vkCmdDrawIndexed(aCmdBuff, aMeshData[i].indicesCount, 1, 0, 0, 0);
-			}
+			draw_batches(false, kDrawViewCamera);
 
 			// We dont want to cull back faces for alpha masked meshes since those are the foliage and we want both sides of the mesh
 			vkCmdSetCullMode(aCmdBuff, VK_CULL_MODE_NONE);
 
-			for (std::size_t i = 0; i < aMeshData.size(); i++) {
-				if (!aMeshData[i].hasAlphaMask) continue;
-
-				vkCmdBindDescriptorSets(
-					aCmdBuff,
-					VK_PIPELINE_BIND_POINT_GRAPHICS,
-					aPipelineLayouts.gBufWritePipelineLayout,
-					1,
-					1,
-					&aDescriptorSets.materialDescriptors[aMeshData[i].materialId],
-					0,
-					nullptr
-				);
-
-				VkBuffer vbuffers[4] = {
-					aMeshData[i].positionBuffer.buffer,
-					aMeshData[i].texCoordBuffer.buffer,
-					aMeshData[i].normalsBuffer.buffer,
-					aMeshData[i].tangentsBuffer.buffer
-				};
-				VkBuffer ibuffer = aMeshData[i].indicesBuffer.buffer;
-				VkDeviceSize voffsets[4]{};
-				VkDeviceSize ioffset{};
-
-				vkCmdBindVertexBuffers(aCmdBuff, 0, 4, vbuffers, voffsets);
-				vkCmdBindIndexBuffer(aCmdBuff, ibuffer, ioffset, VK_INDEX_TYPE_UINT32);
-
-				vkCmdDrawIndexed(aCmdBuff, aMeshData[i].indicesCount, 1, 0, 0, 0);
-			}
+			draw_batches(true, kDrawViewCamera);
 
 			vkCmdNextSubpass(aCmdBuff, VK_SUBPASS_CONTENTS_INLINE);
 
@@ -3946,43 +4847,38 @@ namespace {
 		}
 		// Setup regular rendering (no debug, no mosaic)
 		else if (!aState.mosaicEffect && aState.debugVisualisation == 1) {
-			// Shadow pass
-			VkClearValue clearValuesS{};
-			clearValuesS.depthStencil.depth = 1.0f;
-
-			VkRenderPassBeginInfo passInfoS{};
-			passInfoS.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-			passInfoS.renderPass = aRenderPasses.shadowOffscreenRenderPass;
-			passInfoS.framebuffer = aFramebuffers.shadowOffscreenFramebuffer;
-			passInfoS.renderArea.offset = VkOffset2D{ 0, 0 };
-			passInfoS.renderArea.extent = VkExtent2D{ 2048, 2048 };
-			passInfoS.clearValueCount = 1;
-			passInfoS.pClearValues = &clearValuesS;
-
-			vkCmdBeginRenderPass(aCmdBuff, &passInfoS, VK_SUBPASS_CONTENTS_INLINE);
-
-			vkCmdBindPipeline(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelines.shadowOffscreenPipeline);
-			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelineLayouts.shadowOffscreenPipelineLayout, 0, 1, &aDescriptorSets.depthMVPDescriptor, 0, nullptr);
-
-			// Draw all non alpha masked meshes
-			for (std::size_t i = 0; i < aMeshData.size(); i++) {
-				if (aMeshData[i].hasAlphaMask) continue;
-
-				VkBuffer vbuffers[1] = {
-					aMeshData[i].positionBuffer.buffer
-				};
-				VkBuffer ibuffer = aMeshData[i].indicesBuffer.buffer;
-				VkDeviceSize voffsets[1]{};
-				VkDeviceSize ioffset{};
-
-				vkCmdBindVertexBuffers(aCmdBuff, 0, 1, vbuffers, voffsets);
-				vkCmdBindIndexBuffer(aCmdBuff, ibuffer, ioffset, VK_INDEX_TYPE_UINT32);
-
-				vkCmdDrawIndexed(aCmdBuff, aMeshData[i].indicesCount, 1, 0, 0, 0);
+			// Shadow pass, unless the cached shadow map is still valid
+			if (renderShadowMap) {
+				VkClearValue clearValuesS{};
+				clearValuesS.depthStencil.depth = 1.0f;
+
+				VkRenderPassBeginInfo passInfoS{};
+				passInfoS.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+				passInfoS.renderPass = aRenderPasses.shadowOffscreenRenderPass;
+				passInfoS.framebuffer = aFramebuffers.shadowOffscreenFramebuffer;
+				passInfoS.renderArea.offset = VkOffset2D{ 0, 0 };
+				passInfoS.renderArea.extent = VkExtent2D{ 2048, 2048 };
+				passInfoS.clearValueCount = 1;
+				passInfoS.pClearValues = &clearValuesS;
+
+				vkCmdBeginRenderPass(aCmdBuff, &passInfoS, VK_SUBPASS_CONTENTS_INLINE);
+
+				vkCmdBindPipeline(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelines.shadowOffscreenPipeline);
+				bind_geometry(1);
+				vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelineLayouts.shadowOffscreenPipelineLayout, 0, 1, &aDescriptorSets.depthMVPDescriptor, 0, nullptr);
+				vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelineLayouts.shadowOffscreenPipelineLayout, 1, 1, &aDescriptorSets.sceneDescriptors, 0, nullptr);
+
+				// Draw all non alpha masked meshes
+				draw_batches(false, kDrawViewShadow);
+
+				vkCmdEndRenderPass(aCmdBuff);
+
+				aShadowCache.valid = true;
+				aShadowCache.depthMVP = aUniforms.depthMVPUniform.depthMVP;
+				aShadowCache.receiverCulling = aState.shadowReceiverCulling;
+				aShadowCache.projCam = aUniforms.sceneUniforms.projCam;
 			}
 
-			vkCmdEndRenderPass(aCmdBuff);
-
 			// Default rendering
 			VkClearValue clearValues[2]{};
 			clearValues[0].color.float32[0] = 0.1f;
@@ -4004,75 +4900,21 @@ namespace {
 			vkCmdBeginRenderPass(aCmdBuff, &passInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 			vkCmdBindPipeline(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelines.regularPipeline);
+			bind_geometry(3);
 
 			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelineLayouts.regularPipelineLayout, 0, 1, &aDescriptorSets.sceneDescriptors, 0, nullptr);
+			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelineLayouts.regularPipelineLayout, 1, 1, &aDescriptorSets.materialDescriptor, 0, nullptr);
 			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelineLayouts.regularPipelineLayout, 2, 1, &aDescriptorSets.lightDescriptor, 0, nullptr);
 			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelineLayouts.regularPipelineLayout, 3, 1, &aDescriptorSets.depthMVPDescriptor, 0, nullptr);
 			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelineLayouts.regularPipelineLayout, 4, 1, &aDescriptorSets.shadowMapDescriptor, 0, nullptr);
 
 			// Draw all non alpha masked meshes
-			for (std::size_t i = 0; i < aMeshData.size(); i++) {
-				if (aMeshData[i].hasAlphaMask) continue;
-
-				vkCmdBindDescriptorSets(
-					aCmdBuff, 
-					VK_PIPELINE_BIND_POINT_GRAPHICS, 
-					aPipelineLayouts.regularPipelineLayout, 
-					1, 
-					1, 
-					&aDescriptorSets.materialDescriptors[aMeshData[i].materialId], 
-					0,
-					nullptr
-				);
-
-				VkBuffer vbuffers[4] = {
-					aMeshData[i].positionBuffer.buffer,
-					aMeshData[i].texCoordBuffer.buffer,
-					aMeshData[i].normalsBuffer.buffer,
-					aMeshData[i].tangentsBuffer.buffer
-				};
-				VkBuffer ibuffer = aMeshData[i].indicesBuffer.buffer;
-				VkDeviceSize voffsets[4]{};
-				VkDeviceSize ioffset{};
-
-				vkCmdBindVertexBuffers(aCmdBuff, 0, 4, vbuffers, voffsets);
-				vkCmdBindIndexBuffer(aCmdBuff, ibuffer, ioffset, VK_INDEX_TYPE_UINT32);
-
-				vkCmdDrawIndexed(aCmdBuff, aMeshData[i].indicesCount, 1, 0, 0, 0);
-			}
+			draw_batches(false, kDrawViewCamera);
 
 			// Draw all alpha masked meshes
 			vkCmdBindPipeline(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelines.alphaPipeline);
 
-			for (std::size_t i = 0; i < aMeshData.size(); i++) {
-				if (!aMeshData[i].hasAlphaMask) continue;
-
-				vkCmdBindDescriptorSets(
-					aCmdBuff, 
-					VK_PIPELINE_BIND_POINT_GRAPHICS, 
-					aPipelineLayouts.regularPipelineLayout, 
-					1, 
-					1, 
-					&aDescriptorSets.materialDescriptors[aMeshData[i].materialId], 
-					0,
-					nullptr
-				);
-
-				VkBuffer vbuffers[4] = {
-					aMeshData[i].positionBuffer.buffer,
-					aMeshData[i].texCoordBuffer.buffer,
-					aMeshData[i].normalsBuffer.buffer,
-					aMeshData[i].tangentsBuffer.buffer
-				};
-				VkBuffer ibuffer = aMeshData[i].indicesBuffer.buffer;
-				VkDeviceSize voffsets[4]{};
-				VkDeviceSize ioffset{};
-
-				vkCmdBindVertexBuffers(aCmdBuff, 0, 4, vbuffers, voffsets);
-				vkCmdBindIndexBuffer(aCmdBuff, ibuffer, ioffset, VK_INDEX_TYPE_UINT32);
-
-				vkCmdDrawIndexed(aCmdBuff, aMeshData[i].indicesCount, 1, 0, 0, 0);
-			}
+			draw_batches(true, kDrawViewCamera);
 
 			vkCmdEndRenderPass(aCmdBuff);
 
@@ -4104,26 +4946,17 @@ namespace {
 			vkCmdBeginRenderPass(aCmdBuff, &passInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 			vkCmdBindPipeline(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelines.overVisWritePipeline);
+			bind_geometry(1);
 
 			// 1st subpass only needs scene descriptors
 			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelineLayouts.overVisWritePipelineLayout, 0, 1, &aDescriptorSets.sceneDescriptors, 0, nullptr);
 
-			for (std::size_t i = 0; i < aMeshData.size(); i++) {
-				VkBuffer vbuffers[1] = { aMeshData[i].positionBuffer.buffer };
-				VkBuffer ibuffer = aMeshData[i].indicesBuffer.buffer;
-				VkDeviceSize voffsets[1]{};
-				VkDeviceSize ioffset{};
-
-				vkCmdBindVertexBuffers(aCmdBuff, 0, 1, vbuffers, voffsets);
-				vkCmdBindIndexBuffer(aCmdBuff, ibuffer, ioffset, VK_INDEX_TYPE_UINT32);
+			if (aState.debugVisualisation == 5) // Overdraw
+				vkCmdSetDepthTestEnable(aCmdBuff, VK_FALSE);
+			else if (aState.debugVisualisation == 6) // Overshading
+				vkCmdSetDepthTestEnable(aCmdBuff, VK_TRUE);
 
-				if (aState.debugVisualisation == 5) // Overdraw
-					vkCmdSetDepthTestEnable(aCmdBuff, VK_FALSE);
-				else if (aState.debugVisualisation == 6) // Overshading
-					vkCmdSetDepthTestEnable(aCmdBuff, VK_TRUE);
-
-				vkCmdDrawIndexed(aCmdBuff, aMeshData[i].indicesCount, 1, 0, 0, 0);
-			}
+			draw_batches(std::nullopt, kDrawViewCamera);
 
 			vkCmdNextSubpass(aCmdBuff, VK_SUBPASS_CONTENTS_INLINE);
 
@@ -4156,38 +4989,14 @@ namespace {
 			vkCmdBeginRenderPass(aCmdBuff, &passInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 			vkCmdBindPipeline(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelines.debugPipeline);
+			bind_geometry(3);
 
 			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelineLayouts.regularPipelineLayout, 0, 1, &aDescriptorSets.sceneDescriptors, 0, nullptr);
+			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelineLayouts.regularPipelineLayout, 1, 1, &aDescriptorSets.materialDescriptor, 0, nullptr);
 			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelineLayouts.regularPipelineLayout, 2, 1, &aDescriptorSets.debugDescriptor, 0, nullptr);
 		
 			// Draw all meshes
-			for (std::size_t i = 0; i < aMeshData.size(); i++) {
-				vkCmdBindDescriptorSets(
-					aCmdBuff, 
-					VK_PIPELINE_BIND_POINT_GRAPHICS, 
-					aPipelineLayouts.regularPipelineLayout, 
-					1, 
-					1, 
-					&aDescriptorSets.materialDescriptors[aMeshData[i].materialId], 
-					0,
-					nullptr
-				);
-
-				VkBuffer vbuffers[4] = {
-					aMeshData[i].positionBuffer.buffer,
-					aMeshData[i].texCoordBuffer.buffer,
-					aMeshData[i].normalsBuffer.buffer,
-					aMeshData[i].tangentsBuffer.buffer
-				};
-				VkBuffer ibuffer = aMeshData[i].indicesBuffer.buffer;
-				VkDeviceSize voffsets[4]{};
-				VkDeviceSize ioffset{};
-
-				vkCmdBindVertexBuffers(aCmdBuff, 0, 4, vbuffers, voffsets);
-				vkCmdBindIndexBuffer(aCmdBuff, ibuffer, ioffset, VK_INDEX_TYPE_UINT32);
-
-				vkCmdDrawIndexed(aCmdBuff, aMeshData[i].indicesCount, 1, 0, 0, 0);
-			}
+			draw_batches(std::nullopt, kDrawViewCamera);
 
 			vkCmdEndRenderPass(aCmdBuff);
 		} 
@@ -4213,72 +5022,19 @@ namespace {
 			vkCmdBeginRenderPass(aCmdBuff, &passInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 			vkCmdBindPipeline(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelines.offscreenPipeline);
+			bind_geometry(3);
 
 			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelineLayouts.regularPipelineLayout, 0, 1, &aDescriptorSets.sceneDescriptors, 0, nullptr);
+			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelineLayouts.regularPipelineLayout, 1, 1, &aDescriptorSets.materialDescriptor, 0, nullptr);
 			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelineLayouts.regularPipelineLayout, 2, 1, &aDescriptorSets.lightDescriptor, 0, nullptr);
 		
 			// Draw all non alpha masked meshes
-			for (std::size_t i = 0; i < aMeshData.size(); i++) {
-				if (aMeshData[i].hasAlphaMask) continue;
-
-				vkCmdBindDescriptorSets(
-					aCmdBuff, 
-					VK_PIPELINE_BIND_POINT_GRAPHICS, 
-					aPipelineLayouts.regularPipelineLayout, 
-					1, 
-					1, 
-					&aDescriptorSets.materialDescriptors[aMeshData[i].materialId], 
-					0,
-					nullptr
-				);
-
-				VkBuffer vbuffers[4] = {
-					aMeshData[i].positionBuffer.buffer,
-					aMeshData[i].texCoordBuffer.buffer,
-					aMeshData[i].normalsBuffer.buffer,
-					aMeshData[i].tangentsBuffer.buffer
-				};
-				VkBuffer ibuffer = aMeshData[i].indicesBuffer.buffer;
-				VkDeviceSize voffsets[4]{};
-				VkDeviceSize ioffset{};
-
-				vkCmdBindVertexBuffers(aCmdBuff, 0, 4, vbuffers, voffsets);
-				vkCmdBindIndexBuffer(aCmdBuff, ibuffer, ioffset, VK_INDEX_TYPE_UINT32);
-
-				vkCmdDrawIndexed(aCmdBuff, aMeshData[i].indicesCount, 1, 0, 0, 0);
-			}
+			draw_batches(false, kDrawViewCamera);
 
 			// Draw all alpha masked meshes
 			vkCmdBindPipeline(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelines.alphaOffscreenPipeline);
 
-			for (std::size_t i = 0; i < aMeshData.size(); i++) {
-				if (!aMeshData[i].hasAlphaMask) continue;
-
-				vkCmdBindDescriptorSets(
-					aCmdBuff, 
-					VK_PIPELINE_BIND_POINT_GRAPHICS, 
-					aPipelineLayouts.regularPipelineLayout, 
-					1, 
-					1, 
-					&aDescriptorSets.materialDescriptors[aMeshData[i].materialId], 
-					0,
-					nullptr
-				);
-
-				VkBuffer vbuffers[3] = {
-					aMeshData[i].positionBuffer.buffer,
-					aMeshData[i].texCoordBuffer.buffer,
-					aMeshData[i].normalsBuffer.buffer
-				};
-				VkBuffer ibuffer = aMeshData[i].indicesBuffer.buffer;
-				VkDeviceSize voffsets[3]{};
-				VkDeviceSize ioffset{};
-
-				vkCmdBindVertexBuffers(aCmdBuff, 0, 3, vbuffers, voffsets);
-				vkCmdBindIndexBuffer(aCmdBuff, ibuffer, ioffset, VK_INDEX_TYPE_UINT32);
-
-				vkCmdDrawIndexed(aCmdBuff, aMeshData[i].indicesCount, 1, 0, 0, 0);
-			}
+			draw_batches(true, kDrawViewCamera);
 
 			vkCmdEndRenderPass(aCmdBuff);
 
@@ -4319,6 +5075,9 @@ namespace {
 			vkCmdEndRenderPass(aCmdBuff);
 		}
 
+		if (VK_NULL_HANDLE != aDraws.timestamps)
+			vkCmdWriteTimestamp(aCmdBuff, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, aDraws.timestamps, aDraws.firstTimestamp + 2);
+
 		if (const auto res = vkEndCommandBuffer(aCmdBuff); VK_SUCCESS != res)
 			throw lut::Error("Unable to end recording command buffer\n vkEndCommandBuffer() returned %s", lut::to_string(res).c_str());
 	}
@@ -4340,6 +5099,96 @@ namespace {
 			throw lut::Error("Unable to submit command buffer to queue\n vkQueueSubmit() returned %s", lut::to_string(res).c_str());
 		}
 	}
+
+	void benchmark_model_loading(const char* aModelPath) {
+		using Clock = std::chrono::steady_clock;
+		constexpr int kWarmRuns = 5;
+
+		// Cold: page cache dropped before the (single) run. Warm: best of kWarmRuns
+		// after the file has been read once. Each loader touches all mesh data, so
+		// the mapped loader is timed including a pass over its views (the copy into
+		// staging memory that would follow).
+		const auto run = [&](const char* aName, auto&& aLoad) {
+			const auto time_once = [&] {
+				const auto start = Clock::now();
+				const std::size_t bytes = aLoad();
+				const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+				return std::pair{ seconds, bytes };
+			};
+
+			double cold = -1.0;
+			if (evict_from_page_cache(aModelPath))
+				cold = time_once().first;
+
+			double warm = std::numeric_limits<double>::max();
+			std::size_t bytes = 0;
+			for (int i = 0; i < kWarmRuns; ++i) {
+				const auto [seconds, loaded] = time_once();
+				warm = std::min(warm, seconds);
+				bytes = loaded;
+			}
+
+			if (cold >= 0.0)
+				std::printf(" - %-28s cold %8.2f ms, warm %8.2f ms (%zu MB/s warm)\n", aName, cold * 1e3, warm * 1e3, std::size_t(bytes / warm / (1024 * 1024)));
+			else
+				std::printf(" - %-28s cold      n/a, warm %8.2f ms (%zu MB/s warm)\n", aName, warm * 1e3, std::size_t(bytes / warm / (1024 * 1024)));
+		};
+
+		const auto owned_bytes = [](const BakedModel& aModel) {
+			std::size_t ret = 0;
+			for (const auto& mesh : aModel.meshes) {
+				ret += mesh.positions.size() * sizeof(glm::u16vec4) + mesh.texcoords.size() * sizeof(glm::u16vec2);
+				ret += mesh.tangentsComp.size() * sizeof(std::uint32_t);
+				ret += mesh.indices16.size() * sizeof(std::uint16_t) + mesh.indices.size() * sizeof(std::uint32_t);
+				ret += mesh.meshlets.size() * sizeof(BakedMeshlet) + mesh.meshletVertices.size() * sizeof(std::uint32_t) + mesh.meshletTriangles.size();
+			}
+			return ret;
+		};
+
+		std::printf("Loading '%s' (%u hardware threads):\n", aModelPath, std::thread::hardware_concurrency());
+
+		run("load_baked_model()", [&] {
+			return owned_bytes(load_baked_model(aModelPath));
+		});
+		run("load_baked_model_mapped()", [&] {
+			const MappedBakedModel model = load_baked_model_mapped(aModelPath);
+
+			// Stand-in for the copy into staging memory
+			std::vector<std::byte> staging;
+			std::size_t ret = 0;
+			for (const auto& mesh : model.meshes) {
+				for (const auto view : { mesh.positions, mesh.texcoords, mesh.tangentsComp, mesh.indices, mesh.meshlets, mesh.meshletVertices, mesh.meshletTriangles }) {
+					staging.resize(view.size());
+					if (!view.empty())
+						std::memcpy(staging.data(), view.data(), view.size());
+					ret += view.size();
+				}
+			}
+			return ret;
+		});
+		run("load_baked_model_parallel()", [&] {
+			return owned_bytes(load_baked_model_parallel(aModelPath));
+		});
+
+		if (!evict_from_page_cache(aModelPath))
+			std::printf("Note: cold runs need a way to drop the file from the page cache; not available on this platform\n");
+	}
+
+	bool evict_from_page_cache(const char* aPath) {
+#		if !defined(_WIN32)
+		const int fd = open(aPath, O_RDONLY);
+		if (-1 == fd)
+			return false;
+
+		// Only drops clean, unmapped pages, which is the case between runs
+		const bool ret = 0 == posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		close(fd);
+		return ret;
+#		else
+		(void)aPath;
+		return false;
+#		endif
+	}
 }
 
 
@@ -1,10 +1,29 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) in vec2 v2fTexCoord;
+layout(location = 1) flat in uint v2fMaterial;
 
-layout(set = 1, binding = 0) uniform sampler2D uTexColor;
-layout(set = 1, binding = 1) uniform sampler2D uMetalness;
-layout(set = 1, binding = 2) uniform sampler2D uRoughness;
+// Bindless materials: all textures of the model, indexed through the material buffer
+struct Material {
+    uint baseColour;
+    uint metalness;
+    uint roughness;
+    uint alphaMask;
+    uint normalMap;
+};
+
+layout(set = 1, binding = 0) uniform sampler2D uTextures[];
+layout(std430, set = 1, binding = 1) readonly buffer UMaterials {
+    Material materials[];
+} uMaterials;
+
+// Material of the current mesh, set at the start of main(). The index varies within a draw.
+Material material;
+
+vec4 sample_texture(uint aTexture) {
+    return texture(uTextures[nonuniformEXT(aTexture)], v2fTexCoord);
+}
 
 layout(set = 2, binding = 0) uniform Debug {
     int debug;
@@ -17,10 +36,12 @@ float linearise_depth(float d) {
 }
 
 void main() {
+    material = uMaterials.materials[v2fMaterial];
+
     // Mipmap Utilisation Visualisation
     switch(debug.debug) {
         case 2:
-            float mipmapLevel = textureQueryLod(uTexColor, v2fTexCoord).x;
+            float mipmapLevel = textureQueryLod(uTextures[nonuniformEXT(material.baseColour)], v2fTexCoord).x;
 
             // Colors for mipmaps
             // Colorblind friendly colors https://davidmathlogic.com/colorblind/
@@ -57,7 +78,7 @@ void main() {
         default:
             // Normal rendering (in this case the normal rendering pipeline should be used
             // but we put this here just in case something goes wrong somewhere)
-            oColor = texture(uTexColor, v2fTexCoord).rgba;
+            oColor = sample_texture(material.baseColour).rgba;
     }
 
 }
@@ -3,6 +3,18 @@
 layout(location = 0) in vec3 iPosition;
 layout(location = 1) in vec2 iTexCoord;
 
+// Per mesh data, selected by the firstInstance of each indirect draw.
+// Positions are 16-bit unorm relative to the mesh's AABB
+struct MeshInstance {
+    vec4 positionScale;
+    vec4 positionBias;
+    uint materialId; // Index into the bindless material buffer
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer UMeshes {
+    MeshInstance meshes[];
+} uMeshes;
+
 layout(set = 0, binding = 0) uniform UScene {
     mat4 camera;
     mat4 projection;
@@ -10,9 +22,14 @@ layout(set = 0, binding = 0) uniform UScene {
 } uScene;
 
 layout(location = 0) out vec2 v2fTexCoord;
+layout(location = 1) flat out uint v2fMaterial;
 
 void main(){
+    MeshInstance mesh = uMeshes.meshes[gl_InstanceIndex];
+    v2fMaterial = mesh.materialId;
+    vec3 position = mesh.positionBias.xyz + mesh.positionScale.xyz * iPosition;
+
     v2fTexCoord = iTexCoord;
 
-    gl_Position = uScene.projCam * vec4(iPosition, 1.0f);
+    gl_Position = uScene.projCam * vec4(position, 1.0f);
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 #define PI 3.14159265359
 
@@ -7,6 +8,7 @@ layout(location = 1) in vec3 v2fNormal;
 layout(location = 2) in vec3 v2fPosition; // World-coord position
 layout(location = 3) in vec4 v2fLightSpacePosition;
 layout(location = 4) in mat3 v2fTBN;
+layout(location = 7) flat in uint v2fMaterial;
 
 layout(set = 0, binding = 0) uniform UScene {
     mat4 camera;
@@ -15,11 +17,26 @@ layout(set = 0, binding = 0) uniform UScene {
     vec4 camPos;
 } uScene;
 
-layout(set = 1, binding = 0) uniform sampler2D uTexColor;
-layout(set = 1, binding = 1) uniform sampler2D uMetalness;
-layout(set = 1, binding = 2) uniform sampler2D uRoughness;
-layout(set = 1, binding = 3) uniform sampler2D uAlphaMask;
-layout(set = 1, binding = 4) uniform sampler2D uNormalMap;
+// Bindless materials: all textures of the model, indexed through the material buffer
+struct Material {
+    uint baseColour;
+    uint metalness;
+    uint roughness;
+    uint alphaMask;
+    uint normalMap;
+};
+
+layout(set = 1, binding = 0) uniform sampler2D uTextures[];
+layout(std430, set = 1, binding = 1) readonly buffer UMaterials {
+    Material materials[];
+} uMaterials;
+
+// Material of the current mesh, set at the start of main(). The index varies within a draw.
+Material material;
+
+vec4 sample_texture(uint aTexture) {
+    return texture(uTextures[nonuniformEXT(aTexture)], v2fTexCoord);
+}
 
 layout(set = 2, binding = 0) uniform Light {
     vec4 lightPos;
@@ -47,7 +64,7 @@ float DistributionFunction(vec3 normal, vec3 halfwayVector, float roughness) {
 vec3 Fresnel(float metalness, vec3 halfwayVector, vec3 viewDir) {
     // Fresnel
     // Specular base reflectivity
-    vec3 f0 = (1 - metalness) * vec3(0.04) + (metalness * texture(uTexColor, v2fTexCoord).rgb);
+    vec3 f0 = (1 - metalness) * vec3(0.04) + (metalness * sample_texture(material.baseColour).rgb);
     vec3 fresnel = f0 + (1 - f0) * pow((1 - dot(halfwayVector, viewDir)), 5.0);
     return fresnel;
 }
@@ -64,15 +81,15 @@ float GeometryFunction(vec3 normal, vec3 halfwayVector, vec3 viewDir, vec3 light
 vec3 brdf(vec3 lightDir, vec3 viewDir, vec3 normal) {
     vec3 halfwayVector = normalize(viewDir + lightDir);
 
-    float metalness = texture(uMetalness, v2fTexCoord).r;
-    float roughness_sqrt = texture(uRoughness, v2fTexCoord).r;
+    float metalness = sample_texture(material.metalness).r;
+    float roughness_sqrt = sample_texture(material.roughness).r;
     float roughness = roughness_sqrt * roughness_sqrt;
 
     float ndf = DistributionFunction(normal, halfwayVector, roughness);
     vec3 fresnel = Fresnel(metalness, halfwayVector, viewDir);
     float geometry = GeometryFunction(normal, halfwayVector, viewDir, lightDir);    
 
-    vec3 diffuse = (texture(uTexColor, v2fTexCoord).rgb / PI) * (vec3(1.0f) - fresnel) * (1 - metalness);
+    vec3 diffuse = (sample_texture(material.baseColour).rgb / PI) * (vec3(1.0f) - fresnel) * (1 - metalness);
 
     float brdf_denom = 4 * max(dot(normal, viewDir), 0.0) * max(dot(normal, lightDir), 0.0);
 
@@ -80,15 +97,17 @@ vec3 brdf(vec3 lightDir, vec3 viewDir, vec3 normal) {
 }
 
 void main() {
-    vec3 normal = v2fTBN * normalize(texture(uNormalMap, v2fTexCoord).rgb * 2.0f - 1.0f);
+    material = uMaterials.materials[v2fMaterial];
+
+    vec3 normal = v2fTBN * normalize(sample_texture(material.normalMap).rgb * 2.0f - 1.0f);
 
     vec3 lightDir = normalize(light.lightPos.rgb - v2fPosition);
     vec3 viewDir = normalize(uScene.camPos.rgb - v2fPosition);
     //vec3 normal = normalize(v2fNormal); // Regular normals (left in to test against normal mapping normals)
 
-    vec3 ambient = vec3(0.03f) * texture(uTexColor, v2fTexCoord).rgb;
+    vec3 ambient = vec3(0.03f) * sample_texture(material.baseColour).rgb;
 
-    float alphaValue = texture(uAlphaMask, v2fTexCoord).a;
+    float alphaValue = sample_texture(material.alphaMask).a;
     if (alphaValue < 0.5) discard;
     
     vec3 brdfVal = brdf(lightDir, viewDir, normal) * 100;
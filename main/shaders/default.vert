@@ -2,10 +2,20 @@
 
 layout(location = 0) in vec3 iPosition;
 layout(location = 1) in vec2 iTexCoord;
-// Even though we pass the TBN frame, normals are kept in to allow me to compare and get the
-// screenshots to compare against the TBN normal mapping for the report
-layout(location = 2) in vec3 iNormal;
-layout(location = 3) in vec4 iTangent;
+// Packed TBN quaternion; the normal is taken from the decoded frame
+layout(location = 2) in vec4 iTangent;
+
+// Per mesh data, selected by the firstInstance of each indirect draw.
+// Positions are 16-bit unorm relative to the mesh's AABB
+struct MeshInstance {
+    vec4 positionScale;
+    vec4 positionBias;
+    uint materialId; // Index into the bindless material buffer
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer UMeshes {
+    MeshInstance meshes[];
+} uMeshes;
 
 layout(set = 0, binding = 0) uniform UScene {
     mat4 camera;
@@ -23,6 +33,7 @@ layout(location = 1) out vec3 v2fNormal;
 layout(location = 2) out vec3 v2fPosition; // World-coord position
 layout(location = 3) out vec4 v2fLightSpacePosition;
 layout(location = 4) out mat3 v2fTBN;
+layout(location = 7) flat out uint v2fMaterial;
 
 // Taken from mat3_cast in glm/gtc/quaternion.inl
 mat3 quaternion_to_rot_matrix(vec4 q) {
@@ -50,9 +61,12 @@ const mat4 biasMat = mat4(
 	0.5, 0.5, 0.0, 1.0 );
 
 void main(){
+    MeshInstance mesh = uMeshes.meshes[gl_InstanceIndex];
+    v2fMaterial = mesh.materialId;
+    vec3 position = mesh.positionBias.xyz + mesh.positionScale.xyz * iPosition;
+
     v2fTexCoord = iTexCoord;
-    v2fNormal = iNormal;
-    v2fPosition = iPosition;
+    v2fPosition = position;
 
     // Decode TBN
 
@@ -79,8 +93,9 @@ void main(){
     }
 
     v2fTBN = quaternion_to_rot_matrix(quaternion);
+    v2fNormal = v2fTBN[2];
 
-    v2fLightSpacePosition = (biasMat * depth.depthMVP) * vec4(iPosition, 1.0f);
+    v2fLightSpacePosition = (biasMat * depth.depthMVP) * vec4(position, 1.0f);
 
-    gl_Position = uScene.projCam * vec4(iPosition, 1.0f);
+    gl_Position = uScene.projCam * vec4(position, 1.0f);
 }
\ No newline at end of file
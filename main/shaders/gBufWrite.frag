@@ -1,27 +1,46 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) in vec2 v2fTexCoord;
 layout(location = 1) in vec3 v2fNormal;
 layout(location = 2) in mat3 v2fTBN;
+layout(location = 5) flat in uint v2fMaterial;
 
-layout(set = 1, binding = 0) uniform sampler2D uTexColor;
-layout(set = 1, binding = 1) uniform sampler2D uMetalness;
-layout(set = 1, binding = 2) uniform sampler2D uRoughness;
-layout(set = 1, binding = 3) uniform sampler2D uAlphaMask;
-layout(set = 1, binding = 4) uniform sampler2D uNormalMap;
+// Bindless materials: all textures of the model, indexed through the material buffer
+struct Material {
+	uint baseColour;
+	uint metalness;
+	uint roughness;
+	uint alphaMask;
+	uint normalMap;
+};
+
+layout(set = 1, binding = 0) uniform sampler2D uTextures[];
+layout(std430, set = 1, binding = 1) readonly buffer UMaterials {
+	Material materials[];
+} uMaterials;
+
+// Material of the current mesh, set at the start of main(). The index varies within a draw.
+Material material;
+
+vec4 sample_texture(uint aTexture) {
+	return texture(uTextures[nonuniformEXT(aTexture)], v2fTexCoord);
+}
 
 layout(location = 0) out vec4 outNormals;
 layout(location = 1) out vec4 outAlbedo;
 
 void main() {
-	vec3 normal = v2fTBN * normalize(texture(uNormalMap, v2fTexCoord).rgb * 2.0f - 1.0f);
+	material = uMaterials.materials[v2fMaterial];
+
+	vec3 normal = v2fTBN * normalize(sample_texture(material.normalMap).rgb * 2.0f - 1.0f);
 
 	outNormals.rgb = normal;
-	outNormals.a   = texture(uMetalness, v2fTexCoord).r;
+	outNormals.a   = sample_texture(material.metalness).r;
 
-	float alphaValue = texture(uAlphaMask, v2fTexCoord).a;
+	float alphaValue = sample_texture(material.alphaMask).a;
     if (alphaValue < 0.5) discard;
 
-	outAlbedo.rgb = texture(uTexColor, v2fTexCoord).rgb;
-	outAlbedo.a   = texture(uRoughness, v2fTexCoord).r;
+	outAlbedo.rgb = sample_texture(material.baseColour).rgb;
+	outAlbedo.a   = sample_texture(material.roughness).r;
 }
\ No newline at end of file
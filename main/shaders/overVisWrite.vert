@@ -2,6 +2,18 @@
 
 layout(location = 0) in vec3 iPosition;
 
+// Per mesh data, selected by the firstInstance of each indirect draw.
+// Positions are 16-bit unorm relative to the mesh's AABB
+struct MeshInstance {
+    vec4 positionScale;
+    vec4 positionBias;
+    uint materialId; // Index into the bindless material buffer
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer UMeshes {
+    MeshInstance meshes[];
+} uMeshes;
+
 layout(set = 0, binding = 0) uniform UScene {
     mat4 camera;
     mat4 projection;
@@ -9,5 +21,8 @@ layout(set = 0, binding = 0) uniform UScene {
 } uScene;
 
 void main(){
-    gl_Position = uScene.projCam * vec4(iPosition, 1.0f);
+    MeshInstance mesh = uMeshes.meshes[gl_InstanceIndex];
+    vec3 position = mesh.positionBias.xyz + mesh.positionScale.xyz * iPosition;
+
+    gl_Position = uScene.projCam * vec4(position, 1.0f);
 }
\ No newline at end of file
@@ -2,10 +2,25 @@
 
 layout(location = 0) in vec3 iPosition;
 
+// Per mesh data, selected by the firstInstance of each indirect draw.
+// Positions are 16-bit unorm relative to the mesh's AABB
+struct MeshInstance {
+	vec4 positionScale;
+	vec4 positionBias;
+	uint materialId; // Index into the bindless material buffer
+};
+
+layout(std430, set = 1, binding = 1) readonly buffer UMeshes {
+	MeshInstance meshes[];
+} uMeshes;
+
 layout(set = 0, binding = 0) uniform UScene {
 	mat4 depthMVP;
 } uScene;
 
 void main() {
-	gl_Position = uScene.depthMVP * vec4(iPosition, 1.0f);
+	MeshInstance mesh = uMeshes.meshes[gl_InstanceIndex];
+	vec3 position = mesh.positionBias.xyz + mesh.positionScale.xyz * iPosition;
+
+	gl_Position = uScene.depthMVP * vec4(position, 1.0f);
 }
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include "upload_batch.hpp"
+
+#include <limits>
+#include <algorithm>
+
+#include <cstring>
+
+#include "../utils/error.hpp"
+#include "../utils/vkutil.hpp"
+#include "../utils/vkobject.hpp"
+#include "../utils/to_string.hpp"
+namespace lut = labutils;
+
+namespace {
+	// Staging offsets are kept aligned, so that the memcpy()s into the
+	// mapped memory start on a nice boundary.
+	constexpr VkDeviceSize kStagingAlignment = 16;
+}
+
+UploadBatch::UploadBatch(const lut::Allocator& aAllocator, VkDeviceSize aStagingBlockSize)
+	: mAllocator(aAllocator)
+	, mBlockSize(aStagingBlockSize)
+{}
+
+UploadBatch::~UploadBatch() {
+	release_blocks_();
+}
+
+void UploadBatch::upload(VkBuffer aDstBuffer, VkDeviceSize aDstOffset, const void* aData, VkDeviceSize aSize) {
+	if (0 == aSize)
+		return;
+
+	// Find room in the current block, or start a new one
+	if (mBlocks.empty() || mBlocks.back().size - mBlocks.back().used < aSize) {
+		const VkDeviceSize size = std::max(mBlockSize, aSize);
+
+		lut::Buffer staging = lut::create_buffer(
+			mAllocator,
+			size,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT
+		);
+
+		void* ptr = nullptr;
+		if (const auto res = vmaMapMemory(mAllocator.allocator, staging.allocation, &ptr); VK_SUCCESS != res)
+			throw lut::Error("Mapping memory for writing\n vmaMapMemory() returned %s", lut::to_string(res).c_str());
+
+		mBlocks.emplace_back(Block_{ std::move(staging), size, 0, static_cast<std::byte*>(ptr) });
+	}
+
+	auto& block = mBlocks.back();
+	std::memcpy(block.mapped + block.used, aData, aSize);
+
+	VkBufferCopy region{};
+	region.srcOffset = block.used;
+	region.dstOffset = aDstOffset;
+	region.size = aSize;
+
+	mCopies.emplace_back(Copy_{ aDstBuffer, mBlocks.size() - 1, region });
+
+	block.used = std::min(block.size, (block.used + aSize + kStagingAlignment - 1) / kStagingAlignment * kStagingAlignment);
+	mQueuedBytes += aSize;
+}
+
+void UploadBatch::flush(const lut::VulkanContext& aContext, VkAccessFlags aDstAccess, VkPipelineStageFlags aDstStages) {
+	if (mCopies.empty())
+		return;
+
+	// Make the staging writes visible (a no-op for host-coherent memory)
+	for (auto& block : mBlocks) {
+		if (const auto res = vmaFlushAllocation(mAllocator.allocator, block.buffer.allocation, 0, VK_WHOLE_SIZE); VK_SUCCESS != res)
+			throw lut::Error("Flushing staging memory\n vmaFlushAllocation() returned %s", lut::to_string(res).c_str());
+	}
+
+	lut::CommandPool uploadPool = lut::create_command_pool(aContext, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+	VkCommandBuffer uploadCmd = lut::alloc_command_buffer(aContext, uploadPool.handle);
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (const auto res = vkBeginCommandBuffer(uploadCmd, &beginInfo); VK_SUCCESS != res)
+		throw lut::Error("Unable to begin command buffer\n vkBeginCommandBuffer() returned %s", lut::to_string(res).c_str());
+
+	// One vkCmdCopyBuffer() per staging block and destination buffer
+	std::stable_sort(mCopies.begin(), mCopies.end(), [] (const Copy_& aA, const Copy_& aB) {
+		return aA.block != aB.block ? aA.block < aB.block : aA.dstBuffer < aB.dstBuffer;
+	});
+
+	std::vector<VkBufferCopy> regions;
+	for (std::size_t i = 0; i < mCopies.size(); ) {
+		const auto block = mCopies[i].block;
+		const auto dstBuffer = mCopies[i].dstBuffer;
+
+		regions.clear();
+		for (; i < mCopies.size() && mCopies[i].block == block && mCopies[i].dstBuffer == dstBuffer; ++i)
+			regions.emplace_back(mCopies[i].region);
+
+		vkCmdCopyBuffer(uploadCmd, mBlocks[block].buffer.buffer, dstBuffer, std::uint32_t(regions.size()), regions.data());
+	}
+
+	// A single global barrier covers all destination buffers
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = aDstAccess;
+
+	vkCmdPipelineBarrier(uploadCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, aDstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	if (const auto res = vkEndCommandBuffer(uploadCmd); VK_SUCCESS != res)
+		throw lut::Error("Unable to end command buffer\n vkEndCommandBuffer() returned %s", lut::to_string(res).c_str());
+
+	lut::Fence uploadComplete = lut::create_fence(aContext);
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &uploadCmd;
+
+	if (const auto res = vkQueueSubmit(aContext.graphicsQueue, 1, &submitInfo, uploadComplete.handle); VK_SUCCESS != res)
+		throw lut::Error("Unable to submit commands\n vkQueueSubmit() returned %s", lut::to_string(res).c_str());
+
+	if (const auto res = vkWaitForFences(aContext.device, 1, &uploadComplete.handle, VK_TRUE, std::numeric_limits<std::uint64_t>::max()); VK_SUCCESS != res)
+		throw lut::Error("Unable to wait for fences\n vkWaitForFences() returned %s", lut::to_string(res).c_str());
+
+	release_blocks_();
+}
+
+VkDeviceSize UploadBatch::queued_bytes() const noexcept {
+	return mQueuedBytes;
+}
+
+std::size_t UploadBatch::queued_copies() const noexcept {
+	return mCopies.size();
+}
+
+std::size_t UploadBatch::staging_blocks() const noexcept {
+	return mBlocks.size();
+}
+
+void UploadBatch::release_blocks_() noexcept {
+	for (auto& block : mBlocks)
+		vmaUnmapMemory(mAllocator.allocator, block.buffer.allocation);
+
+	mBlocks.clear();
+	mCopies.clear();
+	mQueuedBytes = 0;
+}
@@ -0,0 +1,70 @@
+#ifndef UPLOAD_BATCH_HPP_2B7D4E61_8C0A_4F3E_9D15_6A1E7C3B90F4
+#define UPLOAD_BATCH_HPP_2B7D4E61_8C0A_4F3E_9D15_6A1E7C3B90F4
+
+#include <vector>
+
+#include <cstddef>
+
+#include <volk/volk.h>
+
+#include "../utils/vkbuffer.hpp"
+#include "../utils/allocator.hpp"
+#include "../utils/vulkan_context.hpp"
+
+// Collects many buffer uploads into a few large staging buffers, and performs
+// all of the copies with a single command buffer, a single barrier and a
+// single fence wait.
+//
+// Uploads are packed into staging blocks of aStagingBlockSize bytes (larger
+// uploads get a block of their own).
+class UploadBatch
+{
+	public:
+		static constexpr VkDeviceSize kDefaultStagingBlockSize = 32 * 1024 * 1024;
+
+		explicit UploadBatch(const labutils::Allocator&, VkDeviceSize aStagingBlockSize = kDefaultStagingBlockSize);
+		~UploadBatch();
+
+		UploadBatch(const UploadBatch&) = delete;
+		UploadBatch& operator=(const UploadBatch&) = delete;
+
+		// Queue a copy of aSize bytes from aData to aDstBuffer (which needs
+		// VK_BUFFER_USAGE_TRANSFER_DST_BIT) at aDstOffset. The data is copied
+		// to staging memory right away, so aData may go away afterwards.
+		void upload(VkBuffer aDstBuffer, VkDeviceSize aDstOffset, const void* aData, VkDeviceSize aSize);
+
+		// Record all queued copies, make them visible to aDstAccess in
+		// aDstStages, submit to the graphics queue and wait for completion.
+		// Releases the staging memory; the batch can be reused afterwards.
+		void flush(const labutils::VulkanContext&, VkAccessFlags aDstAccess, VkPipelineStageFlags aDstStages);
+
+		// Totals of the queued uploads (reset by flush())
+		VkDeviceSize queued_bytes() const noexcept;
+		std::size_t queued_copies() const noexcept;
+		std::size_t staging_blocks() const noexcept;
+
+	private:
+		struct Block_ {
+			labutils::Buffer buffer;
+			VkDeviceSize size;
+			VkDeviceSize used;
+			std::byte* mapped;
+		};
+
+		struct Copy_ {
+			VkBuffer dstBuffer;
+			std::size_t block;
+			VkBufferCopy region;
+		};
+
+		void release_blocks_() noexcept;
+
+		const labutils::Allocator& mAllocator;
+		VkDeviceSize mBlockSize;
+
+		std::vector<Block_> mBlocks;
+		std::vector<Copy_> mCopies;
+		VkDeviceSize mQueuedBytes = 0;
+};
+
+#endif // UPLOAD_BATCH_HPP_2B7D4E61_8C0A_4F3E_9D15_6A1E7C3B90F4
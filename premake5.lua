@@ -85,6 +85,7 @@ project "main"
 	links "x-stb"
 	links "x-glfw"
 	links "x-vma"
+	links "x-zstd"
 
 	dependson "x-glm"
 
@@ -124,6 +125,21 @@ project "main-bake"
 	dependson "x-glm" 
 	dependson "x-rapidobj"
 
+project "main-bake-test"
+	local sources = { 
+		"main-bake-test/**.cpp",
+		"main-bake/optimize_mesh.cpp"
+	}
+
+	kind "ConsoleApp"
+	location "main-bake-test"
+
+	files( sources )
+
+	links "utils"
+
+	dependson "x-glm" 
+
 project "utils"
 	local sources = { 
 		"utils/**.cpp",
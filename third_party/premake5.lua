@@ -161,6 +161,7 @@ project( "x-zstd" )
 	location "."
 
 	files( "zstd/src/common/*.c" )
+	files( "zstd/src/compress/*.c" )
 	files( "zstd/src/decompress/*.c" )
 
 project()
@@ -108,6 +108,8 @@ namespace labutils
 
 	using ImageView = UniqueHandle< VkImageView, VkDevice, vkDestroyImageView >;
 	using Sampler = UniqueHandle< VkSampler, VkDevice, vkDestroySampler >;
+
+	using QueryPool = UniqueHandle< VkQueryPool, VkDevice, vkDestroyQueryPool >;
 }
 
 #include "vkobject.inl"
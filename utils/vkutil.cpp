@@ -146,7 +146,9 @@ namespace labutils
 	) {
 		const VkDescriptorPoolSize pools[] = {
 			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, aMaxDescriptors},
-			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, aMaxDescriptors}
+			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, aMaxDescriptors},
+			{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, aMaxDescriptors},
+			{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, aMaxDescriptors}
 		};
 
 		VkDescriptorPoolCreateInfo poolInfo{};
@@ -216,6 +218,26 @@ namespace labutils
 		return Sampler(aContext.device, sampler);
 	}
 
+	Sampler create_point_sampler(const VulkanContext& aContext) {
+		// Unfiltered reads of individual texels and mip levels
+		VkSamplerCreateInfo samplerInfo{};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = VK_FILTER_NEAREST;
+		samplerInfo.minFilter = VK_FILTER_NEAREST;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.minLod = 0.0f;
+		samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+		samplerInfo.mipLodBias = 0.0f;
+
+		VkSampler sampler = VK_NULL_HANDLE;
+		if (const auto res = vkCreateSampler(aContext.device, &samplerInfo, nullptr, &sampler); VK_SUCCESS != res)
+			throw Error("Unable to create sampler\n vkCreateSampler() returned %s", to_string(res).c_str());
+
+		return Sampler(aContext.device, sampler);
+	}
+
 	void buffer_barrier(
 		VkCommandBuffer aCmdBuff,
 		VkBuffer aBuffer,
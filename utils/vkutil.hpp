@@ -30,6 +30,7 @@ namespace labutils
 
 	Sampler create_default_sampler(VulkanContext const&);
 	Sampler create_shadow_sampler(VulkanContext const&);
+	Sampler create_point_sampler(VulkanContext const&);
 
 	void buffer_barrier(
 		VkCommandBuffer,
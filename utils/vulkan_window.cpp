@@ -516,11 +516,26 @@ namespace
 			queueInfo.pQueuePriorities  = queuePriorities;
 		}
 
+		// Scene meshes are drawn with vkCmdDrawIndexedIndirect(); the
+		// firstInstance of each command selects the per-mesh data.
 		VkPhysicalDeviceFeatures deviceFeatures{};
-		// No extra features for now.
+		deviceFeatures.multiDrawIndirect = VK_TRUE;
+		deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+
+		// Materials are bindless: one runtime sized texture array, indexed
+		// with a per-mesh (non-uniform) material index.
+		VkPhysicalDeviceVulkan12Features vulkan12Features{};
+		vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+		vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+
+		// Meshes are culled on the GPU, which also writes the number of
+		// draws (vkCmdDrawIndexedIndirectCount()).
+		vulkan12Features.drawIndirectCount = VK_TRUE;
 		
 		VkDeviceCreateInfo deviceInfo{};
 		deviceInfo.sType  = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		deviceInfo.pNext  = &vulkan12Features;
 
 		deviceInfo.queueCreateInfoCount     = std::uint32_t(queueInfos.size());
 		deviceInfo.pQueueCreateInfos        = queueInfos.data();
@@ -576,6 +591,32 @@ namespace
 			return -1.0f;
 		}
 
+		VkPhysicalDeviceFeatures features;
+		vkGetPhysicalDeviceFeatures(aPhysicalDev, &features);
+
+		if (!features.multiDrawIndirect || !features.drawIndirectFirstInstance) {
+			std::fprintf(stderr, "Info: Discarding device '%s': no multi draw indirect support\n", props.deviceName);
+			return -1.0f;
+		}
+
+		VkPhysicalDeviceVulkan12Features vulkan12Features{};
+		vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+		VkPhysicalDeviceFeatures2 features2{};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &vulkan12Features;
+		vkGetPhysicalDeviceFeatures2(aPhysicalDev, &features2);
+
+		if (!vulkan12Features.runtimeDescriptorArray || !vulkan12Features.shaderSampledImageArrayNonUniformIndexing) {
+			std::fprintf(stderr, "Info: Discarding device '%s': no descriptor indexing support\n", props.deviceName);
+			return -1.0f;
+		}
+
+		if (!vulkan12Features.drawIndirectCount) {
+			std::fprintf(stderr, "Info: Discarding device '%s': no indirect draw count support\n", props.deviceName);
+			return -1.0f;
+		}
+
 		// Discrete GPU > Integrated GPU > others
 		float score = 0.f;
 